@@ -185,6 +185,13 @@ class ChessBoard{
     return ffi_bindings.chessBoardIsInCheck(_handle) != 0;
   }
 
+  /// Check for a draw by the fifty move rule, threefold repetition or insufficient material
+  bool isDraw(){
+    _checkDisposed();
+
+    return ffi_bindings.chessBoardIsDraw(_handle) != 0;
+  }
+
   /// Make a move
   void makeMove(Move move){
     _checkDisposed();
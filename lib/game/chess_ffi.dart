@@ -138,6 +138,9 @@ typedef ChessBoardIsCheckmateDart= int Function(ChessEngineHandle, ChessBoardHan
 typedef ChessBoardIsStalemateeNative = ffi.Uint8 Function(ChessEngineHandle, ChessBoardHandle);
 typedef ChessBoardIsStalemateeDart= int Function(ChessEngineHandle, ChessBoardHandle);
 
+typedef ChessBoardIsDrawNative = ffi.Uint8 Function(ChessBoardHandle);
+typedef ChessBoardIsDrawDart = int Function(ChessBoardHandle);
+
 typedef ChessBoardMakeMoveNative = ffi.Void Function(
   ChessBoardHandle,
   ffi.Pointer<CMove>,
@@ -235,6 +238,11 @@ final chessBoardIsStalemate = _nativeLib
       'board_is_stalemate')
   .asFunction<ChessBoardIsStalemateeDart>();
 
+final chessBoardIsDraw = _nativeLib
+    .lookup<ffi.NativeFunction<ChessBoardIsDrawNative>>(
+        'board_is_draw')
+    .asFunction<ChessBoardIsDrawDart>();
+
 final chessBoardMakeMove = _nativeLib
     .lookup<ffi.NativeFunction<ChessBoardMakeMoveNative>>(
         'board_make_move')
@@ -125,6 +125,17 @@ class _MyHomePageState extends State<MyHomePage> {
             });
           }
         );
+    } else if (widget.board.isDraw()){
+        showGameOverDialog(
+          context, 
+          result: "Draw", 
+          reason: "Repetition, fifty move rule or insufficient material",
+          onNewGame: () {
+            setState(() {
+              widget.board.setFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+            });
+          }
+        );
     } else {
       //If its not game over have the engine make a move
       Move? engineMove = widget.engine.getRandomMove(widget.board);
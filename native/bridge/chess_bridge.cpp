@@ -1,8 +1,22 @@
 #include "chess_bridge.h"
 #include "board.h"
 #include "engine.h"
+#include "stats.h"
+#include "nnue.h"
+#include "book.h"
+#include "tablebase.h"
+#include "egtb.h"
+#include "mate.h"
 #include <iostream>
+#include <cstring>
 #include <random>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 static inline Board* handle_to_board(ChessBoardHandle handle){
     return static_cast<Board*>(handle);
@@ -211,6 +225,39 @@ uint64_t chess_perft(ChessEngineHandle engine_handle, ChessBoardHandle board_han
     return engine->perft(*board, depth);
 }
 
+uint8_t chess_load_network(const char *path)
+{
+    if(path == nullptr){
+        throw std::runtime_error("Path Cannot not be null in chess_load_network");
+    }
+
+    return nnue::load_network(path) ? 1 : 0;
+}
+
+void chess_unload_network(void)
+{
+    nnue::unload_network();
+}
+
+uint8_t chess_get_stats(CEngineStats *out)
+{
+    if(out == nullptr){
+        throw std::runtime_error("Stats Cannot not be null in chess_get_stats");
+    }
+
+    static_assert(sizeof(CEngineStats) == sizeof(SearchStats), "CEngineStats must match SearchStats");
+
+    SearchStats stats = get_search_stats();
+    std::memcpy(out, &stats, sizeof(CEngineStats));
+
+    return stats_enabled ? 1 : 0;
+}
+
+void chess_reset_stats(void)
+{
+    reset_search_stats();
+}
+
 int32_t engine_generate_legal_moves(ChessEngineHandle engine_handle, ChessBoardHandle board_handle, CMove* moves, int32_t max_moves){
     if(engine_handle == nullptr || board_handle == nullptr ){
         throw std::runtime_error("Handle Cannot not be null in engine_generate_legal_moves");
@@ -270,6 +317,181 @@ uint8_t engine_get_random_move(ChessEngineHandle engine, ChessBoardHandle board,
     return 1;  // Success
 }
 
+uint8_t engine_search(ChessEngineHandle engine, ChessBoardHandle board, int32_t depth, int32_t time_limit_ms, CSearchResult *out)
+{
+    if(engine == nullptr || board == nullptr || out == nullptr){
+        throw std::runtime_error("Handle or Result Cannot not be null in engine_search");
+    }
+
+    SearchResult result = handle_to_engine(engine)->search(*handle_to_board(board), depth, time_limit_ms);
+
+    cpp_move_to_c_move(result.best_move, &out->best_move);
+    out->score = result.score;
+    out->depth = result.depth;
+    out->nodes = result.nodes;
+
+    return result.best_move.piece == Piece::NONE ? 0 : 1;
+}
+
+namespace {
+
+    // Worker threads that live between batch calls, each with its own Engine and Board so the
+    // tables are allocated once. run() hands out item indices until the batch is exhausted.
+    class AnalysisPool {
+        public:
+            explicit AnalysisPool(int threads) {
+                for(int i = 0; i < threads; i++){
+                    workers.emplace_back([this]{ worker_loop(); });
+                }
+            }
+
+            ~AnalysisPool() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for(auto& worker : workers) worker.join();
+            }
+
+            int size() const { return static_cast<int>(workers.size()); }
+
+            void run(int count, std::function<void(int, Engine&, Board&)> task) {
+                std::unique_lock<std::mutex> lock(mutex);
+                job = std::move(task);
+                job_count = count;
+                next_index = 0;
+                busy_workers = size();
+                generation++;
+                wake.notify_all();
+                done.wait(lock, [this]{ return busy_workers == 0; });
+                job = nullptr;
+            }
+
+        private:
+            std::vector<std::thread> workers;
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable done;
+            std::function<void(int, Engine&, Board&)> job;
+            std::atomic<int> next_index{0};
+            int job_count = 0;
+            int busy_workers = 0;
+            uint64_t generation = 0;
+            bool stopping = false;
+
+            void worker_loop() {
+                auto engine = std::make_unique<Engine>();
+                auto board = std::make_unique<Board>();
+                uint64_t seen_generation = 0;
+
+                while(true){
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        wake.wait(lock, [&]{ return stopping || generation != seen_generation; });
+                        if(stopping) return;
+                        seen_generation = generation;
+                    }
+
+                    int index;
+                    while((index = next_index++) < job_count){
+                        job(index, *engine, *board);
+                    }
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(--busy_workers == 0) done.notify_one();
+                }
+            }
+    };
+
+    std::mutex batch_mutex;
+    std::unique_ptr<AnalysisPool> analysis_pool;
+
+    void analyze_one(Engine& engine, Board& board, int depth, int time_limit_ms, CAnalysisResult* out) {
+        Move moves[MAX_NUMBER_OF_MOVES];
+        out->legal_moves = engine.generate_legal_moves(board, moves);
+
+        if(depth <= 0){
+            out->score = engine.evaluate_position(board);
+        } else {
+            SearchResult result = engine.search(board, depth, time_limit_ms);
+            cpp_move_to_c_move(result.best_move, &out->best_move);
+            out->score = result.score;
+            out->depth = result.depth;
+        }
+        out->valid = 1;
+    }
+}
+
+int32_t chess_analyze_batch(const char* const* fens, const CPosition* positions, int32_t count,
+                            int32_t depth, int32_t time_limit_ms, int32_t threads, CAnalysisResult* results)
+{
+    if(results == nullptr || (fens == nullptr) == (positions == nullptr)){
+        throw std::runtime_error("Results and exactly one of fens or positions must be given in chess_analyze_batch");
+    }
+    if(count <= 0) return 0;
+
+    //The pool follows the requested size only, workers left without a position wait for the next batch
+    if(threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::lock_guard<std::mutex> lock(batch_mutex);
+    if(analysis_pool == nullptr || analysis_pool->size() != threads){
+        analysis_pool.reset();
+        analysis_pool = std::make_unique<AnalysisPool>(threads);
+    }
+
+    std::atomic<int32_t> analyzed{0};
+    analysis_pool->run(count, [&](int index, Engine& engine, Board& board){
+        CAnalysisResult* out = &results[index];
+        std::memset(out, 0, sizeof(CAnalysisResult));
+        cpp_move_to_c_move(Move{Piece::NONE, 0, 0, Piece::NONE, Piece::NONE, false, false}, &out->best_move);
+
+        if(fens != nullptr){
+            try {
+                board.set_position_fen(fens[index] == nullptr ? "" : fens[index]);
+            } catch(const std::exception&){
+                return;
+            }
+        } else {
+            Position position;
+            std::memcpy(&position, positions[index].data, sizeof(Position));
+            board.set_position(position);
+        }
+
+        analyze_one(engine, board, depth, time_limit_ms, out);
+        analyzed++;
+    });
+
+    return analyzed;
+}
+
+uint8_t chess_solve_mate(const char* fen, int32_t max_moves, uint64_t node_limit, CMateResult* out)
+{
+    if(fen == nullptr || out == nullptr){
+        throw std::runtime_error("Fen or Result Cannot not be null in chess_solve_mate");
+    }
+    std::memset(out, 0, sizeof(CMateResult));
+
+    Position position;
+    try {
+        position.set_position_fen(fen);
+    } catch(const std::exception&){
+        return 0;
+    }
+
+    thread_local mate::Solver solver;
+    mate::Result result = solver.solve(position, max_moves, node_limit);
+
+    out->status = result.status == mate::Status::MATE ? 1 : result.status == mate::Status::NO_MATE ? 0 : -1;
+    out->moves = result.moves;
+    out->line_length = static_cast<int32_t>(std::min<size_t>(result.line.size(), MAX_MATE_LINE));
+    for(int32_t i = 0; i < out->line_length; i++){
+        cpp_move_to_c_move(result.line[i], &out->line[i]);
+    }
+    out->nodes = result.nodes;
+    return 1;
+}
+
 void board_make_move(ChessBoardHandle handle, const CMove* move){
     if(handle == nullptr || move == nullptr){
         throw std::runtime_error("Handle or Move Cannot not be null in board_make_move");
@@ -364,4 +586,103 @@ uint8_t board_is_stalemate(ChessEngineHandle engine_handle, ChessBoardHandle boa
 
     return 0;
 }
- 
\ No newline at end of file
+ 
+static_assert(sizeof(Position) <= sizeof(CPosition::data), "CPosition is too small to hold a Position");
+
+void board_save_position(ChessBoardHandle handle, CPosition* out)
+{
+    if(handle == nullptr || out == nullptr){
+        throw std::runtime_error("Arguments Cannot be null in board_save_position");
+    }
+
+    std::memcpy(out->data, &handle_to_board(handle)->get_position(), sizeof(Position));
+}
+
+void board_restore_position(ChessBoardHandle handle, const CPosition* position)
+{
+    if(handle == nullptr || position == nullptr){
+        throw std::runtime_error("Arguments Cannot be null in board_restore_position");
+    }
+
+    Position restored;
+    std::memcpy(&restored, position->data, sizeof(Position));
+    handle_to_board(handle)->set_position(restored);
+}
+
+uint8_t board_is_draw(ChessBoardHandle handle)
+{
+    if(handle == nullptr){
+        throw std::runtime_error("Handle Cannot be null in board_is_draw");
+    }
+
+    return handle_to_board(handle)->is_draw() ? 1 : 0;
+}
+
+ChessBookHandle book_open(const char* path)
+{
+    if(path == nullptr){
+        return nullptr;
+    }
+
+    polyglot::Book* book = new (std::nothrow) polyglot::Book();
+    if(book == nullptr){
+        return nullptr;
+    }
+
+    if(!book->open(path)){
+        delete book;
+        return nullptr;
+    }
+
+    return static_cast<ChessBookHandle>(book);
+}
+
+void book_close(ChessBookHandle handle)
+{
+    delete static_cast<polyglot::Book*>(handle);
+}
+
+uint8_t book_pick_move(ChessBookHandle book, ChessEngineHandle engine, ChessBoardHandle board, CMove* out)
+{
+    if(book == nullptr || engine == nullptr || board == nullptr || out == nullptr){
+        throw std::runtime_error("Handle or Move Cannot not be null in book_pick_move");
+    }
+
+    Move move;
+    if(!static_cast<polyglot::Book*>(book)->pick(*handle_to_engine(engine), *handle_to_board(board), move)){
+        return 0;
+    }
+
+    cpp_move_to_c_move(move, out);
+    return 1;
+}
+
+uint64_t board_get_polyglot_key(ChessBoardHandle handle)
+{
+    if(handle == nullptr){
+        throw std::runtime_error("Handle Cannot be null in board_get_polyglot_key");
+    }
+
+    return polyglot::key(*handle_to_board(handle));
+}
+
+int32_t chess_load_generated_tablebases(const char* directory)
+{
+    if(directory == nullptr){
+        throw std::runtime_error("Directory Cannot not be null in chess_load_generated_tablebases");
+    }
+
+    auto tables = std::make_shared<egtb::GeneratedTables>();
+    int loaded = tables->load(directory);
+    if(loaded > 0) tablebase::add_source(tables);
+    return loaded;
+}
+
+void engine_set_tablebase_limit(ChessEngineHandle engine, int32_t pieces)
+{
+    if(engine == nullptr){
+        throw std::runtime_error("Handle Cannot not be null in engine_set_tablebase_limit");
+    }
+
+    handle_to_engine(engine)->tablebase_probe_limit = std::max(0, pieces);
+}
@@ -52,6 +52,14 @@ typedef void* ChessBoardHandle;
  */
 typedef void* ChessEngineHandle;
 
+/**
+ * Opaque handle to a memory mapped Polyglot opening book.
+ * 
+ * Thread-safety: Each handle should be used by only one thread. Handles
+ * opened on the same file share its pages.
+ */
+typedef void* ChessBookHandle;
+
 /*
  * =============================================================================
  * DATA STRUCTURES
@@ -74,6 +82,71 @@ typedef struct {
     uint8_t is_castling;     // 1 if castling move, 0 otherwise
 } CMove;
 
+/**
+ * Result of engine_search().
+ */
+typedef struct {
+    CMove best_move;  // Best move found, piece is PIECE_NONE if there are no legal moves
+    int32_t score;    // Centipawns from the side to move's perspective
+    int32_t depth;    // Last fully searched depth
+    uint64_t nodes;   // Nodes visited
+} CSearchResult;
+
+/**
+ * One entry of chess_analyze_batch()'s result array.
+ */
+typedef struct {
+    CMove best_move;      // Best move found, piece is PIECE_NONE without legal moves or with depth 0
+    int32_t score;        // Centipawns from the side to move's perspective
+    int32_t depth;        // Last fully searched depth, 0 for a static evaluation
+    int32_t legal_moves;  // Number of legal moves in the position
+    uint8_t valid;        // 0 if the input FEN could not be parsed, best_move.piece is then
+                          // PIECE_NONE and every other field is zero
+} CAnalysisResult;
+
+/* Longest mating line chess_solve_mate() returns */
+#define MAX_MATE_LINE 64
+
+/**
+ * Result of chess_solve_mate().
+ */
+typedef struct {
+    int32_t status;               // 1 mate found, 0 no mate within the limit, -1 node limit reached first
+    int32_t moves;                // Mate in this many moves of the side to move, 0 without a mate
+    int32_t line_length;          // Number of plies in line
+    CMove line[MAX_MATE_LINE];    // Attacker and defender moves ending in mate
+    uint64_t nodes;               // Nodes visited
+} CMateResult;
+
+/**
+ * Opaque snapshot of a position (see board_save_position()).
+ * Plain bytes, safe to copy, store in arrays or keep on the Dart side.
+ */
+typedef struct {
+    uint8_t data[384];
+} CPosition;
+
+/**
+ * Hot path counters for the calling thread (see chess_get_stats()).
+ * Layout matches the C++ SearchStats struct.
+ */
+typedef struct {
+    uint64_t make_move_calls;
+    uint64_t undo_move_calls;
+    uint64_t illegal_moves_rejected;  // Pseudo-legal moves rejected by legal move generation
+    uint64_t square_attacked_calls;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    uint64_t beta_cutoffs;
+    uint64_t first_move_cutoffs;      // Beta cutoffs caused by the first move searched
+    uint64_t pawn_table_probes;
+    uint64_t pawn_table_hits;
+    uint64_t eval_cache_probes;
+    uint64_t eval_cache_hits;
+    uint64_t tablebase_probes;
+    uint64_t tablebase_hits;
+} CEngineStats;
+
 /*
  * =============================================================================
  * CONSTANTS
@@ -161,6 +234,67 @@ int32_t engine_generate_legal_moves(ChessEngineHandle engine,
 
 uint8_t engine_get_random_move(ChessEngineHandle engine, ChessBoardHandle board, CMove* move);
 
+/**
+ * Searches the current position with iterative deepening.
+ * 
+ * @param engine Engine handle
+ * @param board Board handle (restored before returning)
+ * @param depth Maximum depth in plies
+ * @param time_limit_ms Time limit in milliseconds, 0 for none
+ * @param out Result to fill (caller owns)
+ * @return 1 if a move was found, 0 if the side to move has no legal moves
+ * 
+ * NOTE: Blocks the calling thread for up to time_limit_ms. Each engine
+ * keeps its own transposition table, use one engine per thread.
+ */
+uint8_t engine_search(ChessEngineHandle engine, ChessBoardHandle board, int32_t depth, int32_t time_limit_ms, CSearchResult* out);
+
+/**
+ * Analyzes many positions in one call on an internal thread pool.
+ * 
+ * Pass either fens or positions (see board_save_position()), the other must be NULL.
+ * Each pool thread keeps its own engine between calls, so transposition table
+ * contents carry over and scores can differ slightly from a fresh engine_search().
+ * Batches run one at a time, concurrent calls wait for each other.
+ * 
+ * @param fens Array of count FEN strings, or NULL
+ * @param positions Array of count position snapshots, or NULL
+ * @param count Number of positions
+ * @param depth Search depth per position, 0 for the static evaluation only
+ * @param time_limit_ms Time limit per position in milliseconds, 0 for none
+ * @param threads Pool size, 0 for one thread per hardware thread
+ * @param results Array of count results to fill (caller owns)
+ * @return Number of positions analyzed, invalid FENs are not counted
+ * 
+ * EXAMPLE:
+ *   const char* fens[2] = {fen_a, fen_b};
+ *   CAnalysisResult results[2];
+ *   chess_analyze_batch(fens, NULL, 2, 6, 0, 0, results);
+ */
+int32_t chess_analyze_batch(const char* const* fens, const CPosition* positions, int32_t count,
+                            int32_t depth, int32_t time_limit_ms, int32_t threads, CAnalysisResult* results);
+
+/**
+ * Looks for a forced mate by the side to move with a proof-number search.
+ * 
+ * Finds the shortest mate within max_moves moves, the defender's replies in
+ * the line are the ones that hold out longest. Each calling thread keeps its
+ * own solver and hash table, so independent positions can be solved from
+ * several threads at once.
+ * 
+ * @param fen Null-terminated FEN string
+ * @param max_moves Longest mate to look for, in moves of the side to move
+ * @param node_limit Stop after this many nodes, 0 for no limit
+ * @param out Result to fill (caller owns)
+ * @return 1 if the search ran, 0 if the FEN could not be parsed
+ * 
+ * EXAMPLE:
+ *   CMateResult result;
+ *   chess_solve_mate("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", 1, 0, &result);
+ *   // result.status == 1, result.line[0] is a1a8
+ */
+uint8_t chess_solve_mate(const char* fen, int32_t max_moves, uint64_t node_limit, CMateResult* out);
+
 /*
  * =============================================================================
  * BOARD LIFECYCLE
@@ -286,7 +420,8 @@ uint8_t board_get_side_to_move(ChessBoardHandle handle);
  * 
  * @param handle Board handle
  * @param color Color to query (COLOR_WHITE=1 or COLOR_BLACK=2)
- * @return PST score (material + position evaluation)
+ * @return PST score (material + position evaluation), blended between the
+ *         middlegame and endgame tables by the current game phase
  * 
  * USAGE: Useful for evaluating material advantage.
  *   int32_t white_score = board_get_pst_of_color(board, COLOR_WHITE);
@@ -312,6 +447,23 @@ int32_t board_get_pst_of_color(ChessBoardHandle handle, int color);
  */
 char* board_get_fen(ChessBoardHandle handle);
 
+/**
+ * Copies the current position into a snapshot, a cheap alternative to FEN round trips.
+ * 
+ * @param handle Board handle
+ * @param out Snapshot to fill
+ */
+void board_save_position(ChessBoardHandle handle, CPosition* out);
+
+/**
+ * Restores a snapshot taken with board_save_position().
+ * Move history is cleared, so undo and repetition detection start fresh.
+ * 
+ * @param handle Board handle
+ * @param position Snapshot to restore
+ */
+void board_restore_position(ChessBoardHandle handle, const CPosition* position);
+
 /*
  * =============================================================================
  * GAME STATE DETECTION
@@ -351,6 +503,19 @@ uint8_t board_is_checkmate(ChessEngineHandle engine_handle, ChessBoardHandle boa
  */
 uint8_t board_is_stalemate(ChessEngineHandle engine_handle, ChessBoardHandle board_handle);
 
+/**
+ * Checks for a draw by the fifty move rule, threefold repetition or
+ * insufficient material.
+ * 
+ * @param handle Board handle
+ * @return 1 if the game is drawn, 0 otherwise
+ * 
+ * NOTE: Repetitions are only seen for moves played with board_make_move()
+ * since the last board_set_fen(). Stalemate is reported by
+ * board_is_stalemate().
+ */
+uint8_t board_is_draw(ChessBoardHandle handle);
+
 /*
  * =============================================================================
  * UTILITY FUNCTIONS
@@ -412,6 +577,112 @@ void chess_free_string(char* str);
  */
 uint64_t chess_perft(ChessEngineHandle engine_handle, ChessBoardHandle board_handle, int32_t depth);
 
+/**
+ * Copies the hot path counters of the calling thread.
+ * 
+ * @param out Stats structure to fill (caller owns)
+ * @return 1 on success, 0 if the library was built without CHESS_STATS
+ *         (out is zeroed in that case)
+ * 
+ * NOTE: Counters are per thread, so call this from the same thread that
+ * ran the perft or search you want to measure.
+ * 
+ * EXAMPLE:
+ *   chess_reset_stats();
+ *   chess_perft(engine, board, 4);
+ *   CEngineStats stats;
+ *   if (chess_get_stats(&stats)) {
+ *       printf("make_move calls: %llu\n", stats.make_move_calls);
+ *   }
+ */
+uint8_t chess_get_stats(CEngineStats* out);
+
+/**
+ * Resets the hot path counters of the calling thread to zero.
+ * 
+ * SAFETY: No-op when the library was built without CHESS_STATS.
+ */
+void chess_reset_stats(void);
+
+/**
+ * Loads an NNUE network file used by every engine for evaluation.
+ * 
+ * @param path Null-terminated path to the network file
+ * @return 1 on success, 0 if the file is missing, truncated or has the wrong
+ *         magic/version (any previously loaded network stays active)
+ * 
+ * THREAD-SAFETY: The network is shared by all engines. Load it before
+ * searching, never while another thread is searching.
+ * 
+ * NOTE: Without a network engines use the PST evaluation.
+ */
+uint8_t chess_load_network(const char* path);
+
+/**
+ * Unloads the NNUE network, engines fall back to the PST evaluation.
+ */
+void chess_unload_network(void);
+
+/*
+ * =============================================================================
+ * OPENING BOOK
+ * =============================================================================
+ */
+
+/**
+ * Opens a Polyglot .bin book.
+ * 
+ * @return Book handle, or NULL if the file cannot be opened or is malformed
+ * 
+ * MEMORY: Caller MUST call book_close() when done.
+ */
+ChessBookHandle book_open(const char* path);
+
+/**
+ * Closes a book. Safe to call with NULL.
+ */
+void book_close(ChessBookHandle handle);
+
+/**
+ * Picks a book move for the position, weighted by the book's move weights.
+ * 
+ * @param book Book handle
+ * @param engine Engine handle, used to match book moves to legal moves
+ * @param board Board handle
+ * @param out Move to fill (caller owns)
+ * @return 1 if a book move was found, 0 if the position is not in the book
+ *         or none of its moves is legal
+ */
+uint8_t book_pick_move(ChessBookHandle book, ChessEngineHandle engine, ChessBoardHandle board, CMove* out);
+
+/**
+ * Gets the Polyglot key of the current position.
+ * 
+ * @return The key, 0x463B96181691FC9C for the start position
+ */
+uint64_t board_get_polyglot_key(ChessBoardHandle handle);
+
+/*
+ * =============================================================================
+ * ENDGAME TABLEBASES
+ * =============================================================================
+ */
+
+/**
+ * Maps the tables written by the tbgen tool (.dctb files) from a directory
+ * and lets every engine probe them.
+ * 
+ * @param directory Directory holding the tables
+ * @return Number of tables loaded, 0 if none were found
+ */
+int32_t chess_load_generated_tablebases(const char* directory);
+
+/**
+ * Sets the largest piece count (kings included) at which the engine probes
+ * tablebases, 0 disables probing. Defaults to 7.
+ */
+void engine_set_tablebase_limit(ChessEngineHandle engine, int32_t pieces);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include "chess_bridge.h"
 #include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
 
 /*
  * =============================================================================
@@ -313,7 +317,7 @@ TEST(BridgeFENTest, GetFenStartingPosition) {
     EXPECT_NE(strstr(fen, "KQkq"), nullptr) << "Missing castling rights";
     
     // Full starting FEN should match exactly
-    const char* expected = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 0"; //We dont use total_moves yet so leaver it at 0
+    const char* expected = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
     EXPECT_STREQ(fen, expected);
     
     chess_free_string(fen);
@@ -322,7 +326,7 @@ TEST(BridgeFENTest, GetFenStartingPosition) {
 
 TEST(BridgeFENTest, GetFenCustomPosition) {
     // Create from FEN, get it back, should match
-    const char* original_fen = "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq e6 0 3";
+    const char* original_fen = "r1bqkbnr/pppp1ppp/2n5/3Pp3/8/5N2/PPP2PPP/RNBQKB1R w KQkq e6 0 4";
     ChessBoardHandle board = board_create_from_fen(original_fen);
     ASSERT_NE(board, nullptr);
     
@@ -405,10 +409,10 @@ TEST(BridgeFENTest, SetFenValid) {
     
     EXPECT_EQ(success, 1);
     
-    // Verify it was actually set
+    // Verify it was actually set, the e6 square is dropped since no white pawn can capture there
     char* retrieved = board_get_fen(board);
     ASSERT_NE(retrieved, nullptr);
-    EXPECT_STREQ(retrieved, new_fen);
+    EXPECT_STREQ(retrieved, "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 3");
     
     chess_free_string(retrieved);
     board_destroy(board);
@@ -497,7 +501,7 @@ TEST(BridgeFENTest, RoundTripComplexPosition) {
 TEST(BridgeFENTest, RoundTripAfterSetFen) {
     ChessBoardHandle board = board_create();
     
-    const char* fen = "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq e6 0 4";
+    const char* fen = "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 0 4";
     
     ASSERT_EQ(board_set_fen(board, fen), 1);
     
@@ -1837,4 +1841,268 @@ TEST(BridgePSTTest, PstSymmetryInMirrorPosition) {
     EXPECT_EQ(white_pst, black_pst);
     
     board_destroy(board1);
-}
\ No newline at end of file
+}
+// =============================================================================
+// STATS TESTS
+// =============================================================================
+
+TEST(BridgeStatsTest, CountsMatchBuildOption) {
+    ChessEngineHandle engine = engine_create();
+    ChessBoardHandle board = board_create();
+
+    chess_reset_stats();
+    chess_perft(engine, board, 2);
+
+    CEngineStats stats;
+    uint8_t enabled = chess_get_stats(&stats);
+
+#ifdef CHESS_STATS
+    EXPECT_EQ(enabled, 1);
+    EXPECT_GT(stats.make_move_calls, 0u);
+    EXPECT_EQ(stats.make_move_calls, stats.undo_move_calls);
+#else
+    EXPECT_EQ(enabled, 0);
+    EXPECT_EQ(stats.make_move_calls, 0u);
+#endif
+
+    engine_destroy(engine);
+    board_destroy(board);
+}
+
+TEST(BridgeStatsTest, NullStatsThrows) {
+    EXPECT_THROW(chess_get_stats(nullptr), std::runtime_error);
+}
+
+TEST(BridgeSearchTest, FindsMateInOne) {
+    ChessEngineHandle engine = engine_create();
+    ChessBoardHandle board = board_create_from_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+
+    CSearchResult result;
+    EXPECT_EQ(engine_search(engine, board, 3, 0, &result), 1);
+    EXPECT_EQ(result.best_move.from_square, 0);
+    EXPECT_EQ(result.best_move.to_square, 56);
+    EXPECT_GT(result.nodes, 0u);
+
+    engine_destroy(engine);
+    board_destroy(board);
+}
+
+TEST(BridgeSearchTest, NoMoveInCheckmate) {
+    ChessEngineHandle engine = engine_create();
+    ChessBoardHandle board = board_create_from_fen("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1");
+
+    CSearchResult result;
+    EXPECT_EQ(engine_search(engine, board, 3, 0, &result), 0);
+    EXPECT_EQ(result.best_move.piece, PIECE_NONE);
+
+    engine_destroy(engine);
+    board_destroy(board);
+}
+
+TEST(BridgeSearchTest, NullResultThrows) {
+    ChessEngineHandle engine = engine_create();
+    ChessBoardHandle board = board_create();
+
+    EXPECT_THROW(engine_search(engine, board, 1, 0, nullptr), std::runtime_error);
+
+    engine_destroy(engine);
+    board_destroy(board);
+}
+
+TEST(BridgeDrawTest, DetectsRepetitionAndDeadPositions) {
+    ChessBoardHandle board = board_create_from_fen("4k3/8/8/8/8/8/4P3/4K1N1 w - - 0 1");
+    EXPECT_EQ(board_is_draw(board), 0);
+
+    CMove out = {PIECE_W_KNIGHT, 6, 21, PIECE_NONE, PIECE_NONE, 0, 0};
+    CMove back = {PIECE_W_KNIGHT, 21, 6, PIECE_NONE, PIECE_NONE, 0, 0};
+    CMove king_out = {PIECE_B_KING, 60, 59, PIECE_NONE, PIECE_NONE, 0, 0};
+    CMove king_back = {PIECE_B_KING, 59, 60, PIECE_NONE, PIECE_NONE, 0, 0};
+    for(int i = 0; i < 2; i++){
+        board_make_move(board, &out);
+        board_make_move(board, &king_out);
+        board_make_move(board, &back);
+        board_make_move(board, &king_back);
+    }
+    EXPECT_EQ(board_is_draw(board), 1);
+
+    board_set_fen(board, "4k3/8/8/8/8/8/8/4K1N1 w - - 0 1");
+    EXPECT_EQ(board_is_draw(board), 1);
+
+    board_destroy(board);
+}
+
+TEST(BridgeDrawTest, NullHandleThrows) {
+    EXPECT_THROW(board_is_draw(nullptr), std::runtime_error);
+}
+
+TEST(BridgePositionTest, SaveAndRestoreRoundTrip) {
+    ChessBoardHandle board = board_create_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    CPosition saved;
+    board_save_position(board, &saved);
+
+    CMove castle = {PIECE_W_KING, 4, 6, PIECE_NONE, PIECE_NONE, 0, 1};
+    board_make_move(board, &castle);
+
+    board_restore_position(board, &saved);
+    char* fen = board_get_fen(board);
+    EXPECT_STREQ(fen, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    chess_free_string(fen);
+
+    // Snapshots are plain bytes and can be restored into any board
+    ChessBoardHandle other = board_create();
+    board_restore_position(other, &saved);
+    fen = board_get_fen(other);
+    EXPECT_STREQ(fen, "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    chess_free_string(fen);
+
+    board_destroy(board);
+    board_destroy(other);
+}
+
+TEST(BridgePositionTest, NullArgumentsThrow) {
+    CPosition saved;
+    EXPECT_THROW(board_save_position(nullptr, &saved), std::runtime_error);
+    EXPECT_THROW(board_restore_position(nullptr, &saved), std::runtime_error);
+}
+
+TEST(BridgeBatchTest, AnalyzesFensInParallel) {
+    const char* fens[] = {
+        "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1",                       // Ra8#
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "not a fen",
+        "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1",                             // stalemate
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    };
+    CAnalysisResult results[5];
+
+    EXPECT_EQ(chess_analyze_batch(fens, nullptr, 5, 3, 0, 3, results), 4);
+
+    EXPECT_EQ(results[0].valid, 1);
+    EXPECT_EQ(results[0].best_move.from_square, 0);
+    EXPECT_EQ(results[0].best_move.to_square, 56);
+    EXPECT_GT(results[0].score, 10000);
+
+    EXPECT_EQ(results[1].legal_moves, 20);
+    EXPECT_EQ(results[1].depth, 3);
+
+    EXPECT_EQ(results[2].valid, 0);
+    EXPECT_EQ(results[2].best_move.piece, PIECE_NONE);
+    EXPECT_EQ(results[2].legal_moves, 0);
+    EXPECT_EQ(results[2].score, 0);
+
+    EXPECT_EQ(results[3].legal_moves, 0);
+    EXPECT_EQ(results[3].best_move.piece, PIECE_NONE);
+    EXPECT_EQ(results[3].score, 0);
+
+    EXPECT_EQ(results[4].legal_moves, 48);
+
+    // The pool is reused, a second batch with the same size gives the same legal move counts
+    CAnalysisResult again[5];
+    EXPECT_EQ(chess_analyze_batch(fens, nullptr, 5, 0, 0, 3, again), 4);
+    for(int i = 0; i < 5; i++) EXPECT_EQ(again[i].legal_moves, results[i].legal_moves);
+    EXPECT_EQ(again[1].depth, 0);
+}
+
+TEST(BridgeBatchTest, AnalyzesPositionSnapshots) {
+    ChessBoardHandle board = board_create_from_fen("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1");
+    CPosition positions[2];
+    board_save_position(board, &positions[0]);
+    board_set_fen(board, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    board_save_position(board, &positions[1]);
+    board_destroy(board);
+
+    CAnalysisResult results[2];
+    EXPECT_EQ(chess_analyze_batch(nullptr, positions, 2, 2, 0, 0, results), 2);
+    EXPECT_EQ(results[0].best_move.to_square, 56);
+    EXPECT_EQ(results[1].legal_moves, 20);
+}
+
+TEST(BridgeBatchTest, RejectsBadArguments) {
+    const char* fens[] = {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+    CPosition positions[1];
+    CAnalysisResult results[1];
+
+    EXPECT_THROW(chess_analyze_batch(fens, nullptr, 1, 1, 0, 1, nullptr), std::runtime_error);
+    EXPECT_THROW(chess_analyze_batch(nullptr, nullptr, 1, 1, 0, 1, results), std::runtime_error);
+    EXPECT_THROW(chess_analyze_batch(fens, positions, 1, 1, 0, 1, results), std::runtime_error);
+    EXPECT_EQ(chess_analyze_batch(fens, nullptr, 0, 1, 0, 1, results), 0);
+}
+
+TEST(BridgeMateTest, SolvesFromSeveralThreads) {
+    const char* fens[] = {
+        "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1",
+        "kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "not a fen",
+    };
+    CMateResult results[4];
+    uint8_t ok[4];
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; i++){
+        threads.emplace_back([&, i]{ ok[i] = chess_solve_mate(fens[i], 2, 0, &results[i]); });
+    }
+    for(auto& thread : threads) thread.join();
+
+    EXPECT_EQ(ok[0], 1);
+    EXPECT_EQ(results[0].status, 1);
+    EXPECT_EQ(results[0].moves, 1);
+    ASSERT_EQ(results[0].line_length, 1);
+    EXPECT_EQ(results[0].line[0].from_square, 0);
+    EXPECT_EQ(results[0].line[0].to_square, 56);
+
+    EXPECT_EQ(results[1].status, 1);
+    EXPECT_EQ(results[1].moves, 2);
+    EXPECT_EQ(results[1].line_length, 3);
+
+    EXPECT_EQ(results[2].status, 0);
+    EXPECT_EQ(results[2].line_length, 0);
+    EXPECT_EQ(ok[3], 0);
+
+    EXPECT_EQ(chess_solve_mate("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3, 10, &results[0]), 1);
+    EXPECT_EQ(results[0].status, -1);
+    EXPECT_THROW(chess_solve_mate(nullptr, 1, 0, &results[0]), std::runtime_error);
+    EXPECT_THROW(chess_solve_mate(fens[0], 1, 0, nullptr), std::runtime_error);
+}
+
+TEST(BridgeBookTest, OpenAndProbe) {
+    EXPECT_EQ(book_open("/nonexistent/book.bin"), nullptr);
+    EXPECT_EQ(book_open(nullptr), nullptr);
+    EXPECT_NO_THROW(book_close(nullptr));
+
+    const char* path = "dart_chess_bridge_book.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        for(int i = 0; i < 16; i++) out.put(0);
+    }
+
+    ChessBookHandle book = book_open(path);
+    ASSERT_NE(book, nullptr);
+
+    // The only entry has key 0, so the start position is not in the book
+    ChessEngineHandle engine = engine_create();
+    ChessBoardHandle board = board_create();
+    CMove move;
+    EXPECT_EQ(board_get_polyglot_key(board), 0x463B96181691FC9CULL);
+    EXPECT_EQ(book_pick_move(book, engine, board, &move), 0);
+
+    EXPECT_THROW(book_pick_move(book, engine, board, nullptr), std::runtime_error);
+    EXPECT_THROW(board_get_polyglot_key(nullptr), std::runtime_error);
+
+    book_close(book);
+    board_destroy(board);
+    engine_destroy(engine);
+    std::remove(path);
+}
+
+TEST(BridgeTablebaseTest, SetsTheProbeLimit) {
+    ChessEngineHandle engine = engine_create();
+    EXPECT_NO_THROW(engine_set_tablebase_limit(engine, 0));
+    EXPECT_THROW(engine_set_tablebase_limit(nullptr, 5), std::runtime_error);
+    engine_destroy(engine);
+}
+
+TEST(BridgeTablebaseTest, LoadsGeneratedTables) {
+    EXPECT_EQ(chess_load_generated_tablebases("/nonexistent/tables"), 0);
+    EXPECT_THROW(chess_load_generated_tablebases(nullptr), std::runtime_error);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "board.h"
+
+/*
+ * King and pawn against king
+ *
+ * One bit per position saying whether the side with the pawn wins, 2 * 24 * 64 * 64 bits
+ * (24 KB). The pawn side is normalized to white and the pawn to files a-d, so only 24 pawn
+ * squares are stored. Built by retrograde iteration on first use.
+ */
+
+namespace bitbase {
+
+    /// @brief Whether white wins with its king and pawn against the black king, the pawn on any file
+    bool kpk_win(int white_king, int white_pawn, int black_king, Color side_to_move);
+
+    /// @brief KPK result from the side to move's point of view: 1 win, 0 draw, -1 loss
+    /// @return false unless the position is exactly king and pawn against king
+    bool probe_kpk(const Position& position, int& result);
+}
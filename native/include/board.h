@@ -1,9 +1,10 @@
 #pragma once
 #include <cstdint>
 #include <string>
-#include <optional>
 #include <array>
 #include <stack>
+#include <type_traits>
+#include "nnue.h"
 
 typedef uint64_t Bitboard;
 
@@ -35,7 +36,7 @@ enum Piece : uint8_t{
 };
 
 inline PieceType typeOf(Piece p) {
-    return PieceType((p - 1) % 6 + 1);
+    return PieceType(p % 6);
 }
 
 enum class Color : uint8_t {
@@ -70,6 +71,9 @@ constexpr CastlingRights operator&(CastlingRights a, CastlingRights b){
     return static_cast<CastlingRights>(static_cast<uint8_t>(a) & static_cast<uint8_t>(b)); 
 }
 
+//En passant square value when no capture is possible
+constexpr uint8_t NO_SQUARE = 64;
+
 //TODO: Consider switching to a uint16_t like in the dart implementation, but get this working first
 struct Move {
     uint8_t piece;
@@ -81,15 +85,42 @@ struct Move {
     bool is_castling;
 };
 
+/// @brief Attack information of one position, filled on first use and dropped when the position changes.
+/// valid has a bit per field so each is only computed when something asks for it.
+struct AttackCache {
+    enum : uint8_t { WHITE_ATTACKS = 1, BLACK_ATTACKS = 2, CHECKERS = 4, PINNED = 8, CHECK_INFO = 16 };
+
+    std::array<Bitboard, 2> attacked;
+    Bitboard checkers;
+    Bitboard pinned;
+    std::array<Bitboard, 6> check_squares; //by piece type, where a piece of the side to move would check
+    Bitboard discoverers; //pieces of the side to move that block their own slider from the enemy king
+    uint8_t valid;
+};
+
 struct Move_State {
     Move move;
     uint8_t captured_piece;
-    std::optional<int> enPassantSquare;
+    uint8_t enPassantSquare;
     uint8_t castling_rights;
     bool wasPromotion; 
+    uint64_t zobrist_key;
+    uint64_t pawn_key;
+    std::array<int, 2> pst_mg;
+    std::array<int, 2> pst_eg;
+    int game_phase;
+    int half_move_clock;
+    //The parent's checkers and pins, which search asks for at every node. undo_move puts them back, the
+    //attack maps and check info are recomputed when asked for.
+    Bitboard checkers;
+    Bitboard pinned;
+    uint8_t attack_valid; //AttackCache::CHECKERS and PINNED bits of the parent's cache
 };
 
-class Board {
+/// @brief Everything that describes a position except the move history: bitboards, side to move, castling,
+/// en passant, clocks, hash keys and PST sums. Trivially copyable and about 200 bytes, so search and perft
+/// threads can copy-make (copy the parent, apply_move on the copy) and keep their own history stack.
+class Position {
     friend class BoardTestFixture;
 
     public:
@@ -107,41 +138,95 @@ class Board {
 
         Color sideToMove; 
         uint8_t castlingRightsState; //only really need 4 bits but whatever
-        std::optional<int> enPassantSquare;
+        /// @brief Square behind a pawn that just moved two squares, NO_SQUARE unless a pawn of the side to
+        /// move can actually capture there, so it only reaches the hash and the FEN when it matters
+        uint8_t enPassantSquare;
         int half_move_clock;
         int num_moves_total;
 
+        /// @brief Occupancy per color and of both colors, kept up to date with XOR masks as pieces move
         Bitboard white_occupancy;
         Bitboard black_occupancy;
+        Bitboard occupancy;
 
-        Color color_can_en_passant;
+        /// @brief Middlegame and endgame PST sums, 0 is whites table 1 is blacks table
+        std::array<int, 2> pst_mg;
+        std::array<int, 2> pst_eg;
 
-        /// @brief 0 is whites table 1 is blacks table
-        std::array<int, 2> pst_colors; 
+        /// @brief Non pawn material left on the board, MAX_GAME_PHASE at the start and 0 with only kings and pawns.
+        /// Can exceed MAX_GAME_PHASE after promotions so clamp before interpolating
+        int game_phase;
 
-        Board();
+        /// @brief Zobrist hash of the position, updated incrementally in make_move
+        uint64_t zobrist_key;
+
+        /// @brief Zobrist hash of the pawns only, keys the pawn structure cache
+        uint64_t pawn_key;
+
+        Position();
 
         Bitboard get_piece_bitboard(Piece piece) const;
         Bitboard get_piece_bitboard(PieceType type, Color color) const;
         void set_position_fen(const std::string& fen);
-        void make_move(Move& move);
-        void undo_move();
-        bool is_in_check(Color color);
+
+        /// @brief Plays a legal move without recording history, the copy-make counterpart of Board::make_move
+        void apply_move(const Move& move);
+
+        bool is_in_check(Color color) const;
         bool can_castle(CastlingRights right) const;
         Piece get_piece_at(int square) const;
         Bitboard get_active_color_bb() const;
         Bitboard get_empty_squares() const;
         bool is_square_attacked(int square, Color attacking_color) const;
-        std::string getFen();
+
+        /// @brief Every square a side attacks, built set-wise instead of square by square
+        Bitboard attack_map(Color attacking_color) const;
+
+        /// @brief Squares attacked by a side with the defending king lifted off the board, so a king can not
+        /// step back along a checking slider's line. Cached until the position changes.
+        Bitboard attacked_squares(Color attacking_color) const;
+
+        /// @brief Enemy pieces giving check to the side to move, cached
+        Bitboard checkers() const;
+
+        /// @brief Pieces of the side to move pinned to their own king, cached
+        Bitboard pinned() const;
+
+        /// @brief Squares from which a piece of this type of the side to move attacks the enemy king, cached
+        Bitboard check_squares(PieceType type) const;
+
+        /// @brief Pieces of the side to move that give a discovered check by leaving the line to the enemy king
+        Bitboard discoverers() const;
+
+        /// @brief Whether a pseudo-legal move checks the enemy king, from the check squares and discoverers.
+        /// Only castling and en passant are played on a copy.
+        bool gives_check(const Move& move) const;
+
+        /// @brief Whether a pseudo-legal move of the side to move leaves its king safe. Answered from the cached
+        /// attacks, checkers and pins, only en passant is played on a copy.
+        bool is_legal(const Move& move) const;
+        std::string getFen() const;
         int32_t get_pst_color(Color color) const;
+        int32_t get_tapered_pst(int mg, int eg) const;
+        uint64_t compute_zobrist_key() const;
+        uint64_t compute_pawn_key() const;
+        bool is_insufficient_material() const;
+
+        /// @brief Repetition check against a caller-owned history of the positions before this one, oldest first
+        /// (history[count - 1] is the parent). Only scans back to the last capture or pawn move.
+        bool is_repetition(const Position* history, int count, int times = 1) const;
 
         void print_board(std::ostream& os) const;
 
-    private:
+    protected:
         std::array<uint64_t, 12> bitboard_array;
+        mutable AttackCache attack_cache;
 
-        Move_State move_history[2048];
-        int history_ply;
+        Bitboard attack_map(Color attacking_color, Bitboard occupied) const;
+
+        /// @brief Pieces standing alone between the king and a slider of the given color that would see it
+        Bitboard line_blockers(int king_square, Color slider_color) const;
+        void compute_check_info() const;
 
         //Castling stuff
         void remove_castling_right(CastlingRights right);
@@ -150,19 +235,61 @@ class Board {
 
         void parse_piece_placement(const std::string& positions);
         void set_castling_rights(uint8_t&newCastlingRights);
-        void undo_rook_castle(Color color, int start, int end);
-        void remove_captured_piece(int square, Piece captured_piece);
-        void castle_move(Move& king_move);
 
-        int get_king_square(Color color);
+        //Move making is templated on the mover's color, apply_move and Board::undo_move pick the instance once
+        template<Color Us> void apply_move_for(const Move& move);
+        template<Color Us> void undo_rook_castle(int start, int end);
+        template<Color Owner> void remove_captured_piece(int square, Piece captured_piece);
+        template<Color Us> void castle_move(const Move& king_move);
+
+        int get_king_square(Color color) const;
 
         void update_color_bitboard();
+        template<Color C> void toggle_occupancy(Bitboard mask);
+        void set_en_passant_if_capturable(int square, Color pushed_by);
 
-        std::string generate_piece_placement_fen();
-        std::string index_to_square(int index);
+        std::string generate_piece_placement_fen() const;
+        std::string index_to_square(int index) const;
         
         void init_pst_tables();
-        
+        void update_pst(Piece piece, int square, int sign);
+};
+
+static_assert(std::is_trivially_copyable_v<Position>, "Position must stay cheap to copy for copy-make");
+
+/// @brief A Position plus the make/undo history and the NNUE accumulator. The history makes a Board tens of
+/// kilobytes, so copy its Position (get_position) rather than the Board when handing it to another thread.
+class Board : public Position {
+    friend class BoardTestFixture;
+
+    public:
+        /// @brief NNUE feature transformer output, kept in sync by make_move/undo_move while a network is loaded
+        nnue::Accumulator accumulator;
+
+        Board();
+
+        /// @brief Sets up a new game, the move history is cleared
+        void set_position_fen(const std::string& fen);
+
+        /// @brief Copies a snapshot in as a new game, the move history is cleared
+        void set_position(const Position& position);
+        const Position& get_position() const { return *this; }
+
+        void make_move(Move& move);
+        void undo_move();
+
+        /// @brief True if the current position occurred at least `times` times before. Only scans back to the last
+        /// capture or pawn move and never past the position the board was set up from.
+        bool is_repetition(int times = 1) const;
+
+        /// @brief Fifty move rule, threefold repetition or a dead position (bare kings, or one minor piece left)
+        bool is_draw() const;
+
+    private:
+        Move_State move_history[2048];
+        int history_ply;
+
+        template<Color Us> void undo_move_for();
 };
 
 constexpr int squareIndexFromAlgebraicConst(const std::string notation) {
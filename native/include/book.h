@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "mapped_file.h"
+
+class Engine;
+
+/*
+ * Polyglot opening books
+ *
+ * A .bin book is a sorted array of 16 byte big endian entries:
+ *   uint64 key, uint16 move, uint16 weight, uint32 learn
+ *
+ * key is the Polyglot hash of the position, which uses its own Random64 table of 781 numbers:
+ *   [0, 768)    pieces, 64 * kind + square with kind = 2 * piece type + (white ? 1 : 0)
+ *   [768, 772)  castling rights K, Q, k, q
+ *   [772, 780)  en passant file, only when a pawn of the side to move can capture
+ *   780         white to move
+ *
+ * move packs to (bits 0-5), from (6-11) and promotion (12-14: none, n, b, r, q). Castling is
+ * written as the king taking its own rook, e1h1 for white short castling.
+ */
+
+namespace polyglot {
+
+    constexpr int RANDOM_COUNT = 781;
+
+    /// @brief Polyglot hash of the position, 0x463B96181691FC9C for the start position
+    uint64_t key(const Position& position);
+
+    struct BookEntry {
+        uint64_t key;
+        uint16_t move;
+        uint16_t weight;
+        uint32_t learn;
+    };
+
+    /// @brief A memory mapped .bin book. Books opened on the same file share the page cache.
+    class Book {
+        public:
+            Book() = default;
+            ~Book();
+            Book(const Book&) = delete;
+            Book& operator=(const Book&) = delete;
+
+            /// @return false if the file cannot be opened or is not a whole number of entries
+            bool open(const std::string& path);
+            void close();
+            bool is_open() const;
+
+            /// @brief Number of entries in the book
+            size_t size() const;
+
+            /// @brief All entries stored for the position's key, in file order
+            std::vector<BookEntry> probe(const Position& position) const;
+
+            /// @brief Picks a book move with probability proportional to its weight
+            /// @return false if the position is not in the book or no entry is legal
+            bool pick(Engine& engine, Board& board, Move& out);
+
+            void seed(uint64_t value);
+
+        private:
+            MappedFile file;
+            const unsigned char* data = nullptr;
+            size_t entry_count = 0;
+            std::mt19937_64 rng{std::random_device{}()};
+
+            BookEntry entry_at(size_t index) const;
+    };
+
+    /// @brief Matches a Polyglot move against the legal moves of the position
+    /// @return false if none of them corresponds
+    bool decode_move(Engine& engine, Board& board, uint16_t polyglot_move, Move& out);
+}
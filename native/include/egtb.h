@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "tablebase.h"
+
+/*
+ * Generated endgame tablebases
+ *
+ * Retrograde analysis of every position with up to five pieces, kings included, for one
+ * material signature ("KRPvKR"). Each table stores, for every index, WDL and the distance
+ * to mate in moves, and is written as a .dctb file that is memory mapped when probed.
+ *
+ * Index, side to move major:
+ *   stm * king_pairs * D + pair * D + piece squares
+ * pair enumerates the king placements left after symmetry: the white king in the a1-d1-d4
+ * triangle (462 legal pairs) without pawns, on files a-d (1806 pairs) with pawns. Every
+ * other piece takes 64 squares, 48 for pawns, in signature order. Like pieces are not
+ * merged, so KRRvK stores both orderings of the rooks.
+ *
+ * File layout, little endian:
+ *   [0, 4)    magic "DCTB"
+ *   [4, 6)    format version
+ *   6         number of pieces besides the kings
+ *   7         reserved
+ *   [8, 12)   the pieces as Piece values, NONE when unused
+ *   [12, 16)  reserved
+ *   [16, 24)  number of entries
+ *   [24, 32)  offset of the WDL section, 2 bits per entry: 0 draw, 1 win, 2 loss, 3 illegal
+ *   [32, 40)  offset of the distance section, 1 byte per entry: moves until mate, 0 for draws
+ *
+ * En passant is left out: probes of a position with an en passant square fail.
+ */
+
+namespace egtb {
+
+    constexpr int MAX_PIECES = 5;
+    constexpr uint16_t FORMAT_VERSION = 1;
+
+    /// @brief The pieces besides the two kings, white first, each side strongest first
+    struct Material {
+        std::vector<Piece> pieces;
+
+        bool has_pawns() const;
+        int piece_count() const; //kings included
+
+        /// @brief Signature like "KQvKR"
+        std::string name() const;
+    };
+
+    /// @brief Parses a signature like "KRPvKR". Tables are kept with the stronger side as white, so
+    /// "KvKQ" parses to KQvK.
+    /// @return false if the name is malformed, has nothing besides the kings or more than MAX_PIECES pieces
+    bool parse_material(const std::string& name, Material& out);
+
+    /// @brief Signatures one capture or promotion away, the tables a generation probes
+    std::vector<Material> successors(const Material& material);
+
+    class Table;
+
+    /// @brief Generated tables found in a directory. Probed as a tablebase::Source, so search uses them
+    /// once registered with tablebase::add_source.
+    class GeneratedTables : public tablebase::Source {
+        public:
+            GeneratedTables();
+            ~GeneratedTables() override;
+            GeneratedTables(const GeneratedTables&) = delete;
+            GeneratedTables& operator=(const GeneratedTables&) = delete;
+
+            /// @brief Maps every .dctb file in the directory, files with a bad header are skipped
+            /// @return the number of tables loaded by this call
+            int load(const std::string& directory);
+
+            /// @brief Takes over a table generated in memory
+            void add(std::unique_ptr<Table> table);
+
+            bool has(const std::string& name) const;
+            int size() const;
+
+            int max_pieces() const override;
+            bool probe_wdl(const Position& position, tablebase::WDL& out) const override;
+
+            /// @brief Answered with the distance to mate, which also bounds the distance to zeroing
+            bool probe_dtz(const Position& position, int& out) const override;
+            bool probe_dtm(const Position& position, int& out) const override;
+
+            /// @brief Looks a setup up by piece squares, the kings are not in pieces
+            /// @param wdl set to 0 draw, 1 win, 2 loss for the side to move
+            /// @param moves moves until mate, 0 for draws
+            bool lookup(const std::vector<std::pair<Piece, int>>& pieces, int white_king, int black_king,
+                        Color side_to_move, int& wdl, int& moves) const;
+
+        private:
+            std::map<std::string, std::unique_ptr<Table>> tables;
+            int largest = 0;
+    };
+
+    /// @brief Generates the table for a signature with retrograde analysis, writing it and any missing
+    /// successor tables to the directory. Tables already in the directory are reused.
+    /// @param threads worker threads for the passes over the table
+    /// @param log progress lines, may be null
+    /// @return false if the signature is invalid or a file cannot be written
+    bool generate(const std::string& name, const std::string& directory, int threads, std::ostream* log = nullptr);
+}
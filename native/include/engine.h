@@ -1,17 +1,77 @@
 #pragma once
 #include <vector>
+#include <chrono>
 #include "board.h"
 
+enum class TTFlag : uint8_t {
+    EXACT,
+    LOWER_BOUND, //score failed high, real score is >= stored
+    UPPER_BOUND  //score failed low, real score is <= stored
+};
+
+/// @brief Which moves a generator call produces
+enum class GenType : uint8_t {
+    ALL,      //every pseudo-legal move
+    CAPTURES, //captures and promotions, for quiescence
+    EVASIONS, //replies to a check: king steps, captures of the checker and blocks
+    CHECKS    //moves that give check, directly or by discovery
+};
+
+struct TTEntry {
+    uint64_t key;
+    Move best_move;
+    int32_t score;
+    int16_t depth;
+    TTFlag flag;
+};
+
+struct PawnHashEntry {
+    uint64_t key;
+    int32_t mg; //pawn structure score from whites perspective
+    int32_t eg;
+    std::array<Bitboard, 2> passed_pawns; //indexed by color
+};
+
+struct EvalCacheEntry {
+    uint64_t key;
+    int32_t score; //from the side to move's perspective
+};
+
+struct SearchResult {
+    Move best_move;
+    int score; //from the side to move's perspective
+    int depth; //0 when the move came straight from the tablebases
+    uint64_t nodes;
+};
+
 class Engine{
     public:
         Engine() = default;
 
+        /// @brief Evaluate with the loaded NNUE network, false forces the PST evaluation (e.g. to compare the two)
+        bool use_nnue = true;
+
+        /// @brief Probe the tablebases (see tablebase.h) with at most this many pieces on the board, 0 disables probing
+        int tablebase_probe_limit = 7;
+
         /*  *   *   *   *  *  */
         /*   MOVE GENERATION  */
         /*  *   *   *   *  *  */
 
         // Generates all pseudo-legal moves for the current side-to-move.
-        int generate_psuedo_legal_moves(const Board& board, Move* moves);
+        int generate_psuedo_legal_moves(const Position& board, Move* moves);
+
+        // Pseudo-legal captures and promotions only, what quiescence searches.
+        int generate_captures(const Position& board, Move* moves);
+
+        // Moves out of check: king steps to squares the enemy does not attack, and unless it is double
+        // check, captures of the checker and moves onto the squares between it and the king. Pins are
+        // not looked at, so the list still needs Position::is_legal. Falls back to every move out of check.
+        int generate_evasions(const Position& board, Move* moves);
+
+        // Pseudo-legal moves that check the enemy king, found from the check squares and discovered check
+        // candidates of Position rather than by playing moves. Used by mate search.
+        int generate_checks(const Position& board, Move* moves);
 
         // Filters the pseudo-legal moves to only include those that don't
         // leave the king in check (i.e., making them legal).
@@ -23,27 +83,90 @@ class Engine{
         // Utility for the top level, prints results clearly.
         uint64_t perft_divide(Board& board, int depth);
 
+        // Copy-make versions, the position is never modified and each child is a copy of its parent.
+        int generate_legal_moves(const Position& position, Move* moves);
+        uint64_t perft(const Position& position, int depth);
+
         /*  *   *   *   *   *  *  */
         /*  SEARCH AND EVALUATION */
         /*  *   *   *   *   *  *  */
 
 
         /// @brief Evaluate the position returning a numerical value. 
-        /// Higher score = Better For White, Lower Score = better for black
+        /// Uses the NNUE network when one is loaded (nnue::load_network), the tapered PST evaluation otherwise
         /// @param board the current position as a board object
-        /// @return The score of the position from whites perspective. 
+        /// @return The score of the position from the side to move's perspective. 
         int evaluate_position(Board& board);
 
+        /// @brief Iterative deepening alpha-beta search from the current position.
+        /// @param board the position to search, it is restored before returning
+        /// @param depth the maximum depth in plies
+        /// @param time_limit_ms stop after this many milliseconds, 0 for no limit. The depth 1 iteration
+        /// always completes so a move is returned even with a tiny limit.
+        /// @return The best move found and its score from the side to move's perspective.
+        /// best_move.piece is Piece::NONE if the side to move has no legal moves.
+        SearchResult search(Board& board, int depth, int time_limit_ms = 0);
+
+        void clear_transposition_table();
+
+        /// @brief Whether a legal move other than excluded scores at least bound at this depth. Every move gets a
+        /// null window search, much cheaper than scoring it, so positions with a single good move can be told apart.
+        /// @param board the position, it is restored before returning
+        bool other_move_reaches(Board& board, const Move& excluded, int depth, int bound);
+
+        /// @brief Quiescence search that also reports the capture sequence leading to the quiet
+        /// position its score comes from. Used by the tuner to evaluate positions without hanging pieces.
+        /// @param board the position to resolve, it is restored before returning
+        /// @param line receives at most MAX_SEARCH_PLY moves
+        /// @param score receives the quiescence score from the side to move's perspective
+        /// @return The number of moves written to line.
+        int quiet_line(Board& board, Move* line, int& score);
+
 
     private:
-        // Helper function to generate moves for a single piece type/color
-        void generate_moves_from_square(const Board& board, Piece piece, uint8_t index, Move* moves, int& move_count);
+        std::vector<TTEntry> transposition_table; //allocated on the first search
+        std::vector<PawnHashEntry> pawn_table; //allocated on the first evaluation
+        std::vector<EvalCacheEntry> eval_cache; //allocated on the first evaluation
+        uint32_t eval_cache_network = 0; //network id the cached scores were computed with
+        uint64_t nodes_searched = 0;
+        Move root_best_move{};
+        std::chrono::steady_clock::time_point deadline;
+        bool time_limited = false;
+        bool search_stopped = false; //set once the deadline passes, unwinds the current iteration
+
+        bool out_of_time();
+        bool probe_root_tablebase(Board& board, SearchResult& result);
+
+        int negamax(Board& board, int depth, int ply, int alpha, int beta);
+        int quiescence(Board& board, int ply, int alpha, int beta);
+        int quiescence_line(Board& board, int ply, int alpha, int beta, Move* line, int& line_length);
+        void score_moves(const Move* moves, int* scores, int move_count, const Move& tt_move);
+        TTEntry* probe_tt(uint64_t key);
+        const PawnHashEntry& probe_pawn_table(const Position& board);
+        void evaluate_pawn_structure(const Position& board, PawnHashEntry& entry);
+        int evaluate_uncached(Board& board);
+        void store_tt(uint64_t key, const Move& best_move, int score, int depth, TTFlag flag, int ply);
+
+        // The generators are templated on the side to move and the kind of moves wanted, so directions,
+        // rank masks and piece indices are constants. The public generators pick the instance once.
+        template<Color Us, GenType Type>
+        int generate_moves(const Position& board, Move* moves);
 
-        void generate_sliding_moves(const Board& board, Piece piece, uint8_t index, Move* moves, int& move_count);
-        void generate_pawn_moves(const Board& board, Move* moves, int& move_count);
-        void generate_knight_moves(const Board& board, Piece piece, uint8_t index, Move* moves, int& move_count);
-        void generate_king_moves(const Board& board, Piece piece, uint8_t index, Move* moves, int& move_count);
-        void generate_castle_moves(const Board& board, Piece piece, uint8_t index, Move* moves, int& move_count);
+        // Helper function to generate moves for a single piece type/color
+        // targets limits the destination squares of everything but the king (all squares unless evading).
+        template<Color Us, GenType Type>
+        void generate_moves_from_square(const Position& board, Piece piece, uint8_t index, Bitboard targets, Move* moves, int& move_count);
+
+        template<Color Us, GenType Type>
+        void generate_sliding_moves(const Position& board, Piece piece, uint8_t index, Bitboard targets, Move* moves, int& move_count);
+        template<Color Us, GenType Type>
+        void generate_pawn_moves(const Position& board, Bitboard targets, Move* moves, int& move_count);
+        template<Color Us, GenType Type>
+        void generate_knight_moves(const Position& board, Piece piece, uint8_t index, Bitboard targets, Move* moves, int& move_count);
+        template<Color Us, GenType Type>
+        void generate_king_moves(const Position& board, Piece piece, uint8_t index, Move* moves, int& move_count);
+        template<Color Us>
+        void generate_castle_moves(const Position& board, Move* moves, int& move_count);
 
         enum Direction{
             North = 8,
@@ -54,9 +177,9 @@ class Engine{
 
         Bitboard shift(Bitboard board, int direction);
         void extract_pawn_push(Bitboard bb, Piece piece, int shift, Move* moves, int& move_count);
-        void extract_pawn_capture(Bitboard bb, Piece piece, int shift, Move* moves, int& move_count, const Board& board);
+        void extract_pawn_capture(Bitboard bb, Piece piece, int shift, Move* moves, int& move_count, const Position& board);
         void extract_promotion_push(Bitboard bb, Piece piece, int shift, Move* moves, int& move_count);
-        void extract_promotion_capture(Bitboard bb, Piece piece, int shift, Move* moves, int& move_count, const Board& board);
+        void extract_promotion_capture(Bitboard bb, Piece piece, int shift, Move* moves, int& move_count, const Position& board);
         
 };
 
@@ -99,5 +222,22 @@ inline std::string move_to_string(Move m) {
     return str;
 }
 
+/// @brief Perft with the root moves split across threads, each thread copy-makes with its own Engine
+uint64_t parallel_perft(const Position& position, int depth, int threads);
+
+/// @brief Standard algebraic notation (Nf3, exd5, O-O, e8=Q+) of a legal move in the board's position
+std::string move_to_san(Engine& engine, Board& board, const Move& move);
+
+inline bool same_move(const Move& a, const Move& b) {
+    return a.from_square == b.from_square && a.to_square == b.to_square && a.promoted_piece == b.promoted_piece;
+}
+
 constexpr int MAX_NUMBER_OF_MOVES = 256;
+constexpr int MAX_SEARCH_PLY = 128;
+constexpr int INFINITE_SCORE = 1000000;
+constexpr int MATE_SCORE = 100000; //mate in n plies scores MATE_SCORE - n
+constexpr int TB_WIN_SCORE = MATE_SCORE - 2 * MAX_SEARCH_PLY; //tablebase win n plies from the root scores TB_WIN_SCORE - n, below any mate
+constexpr int TT_SIZE = 1 << 18;   //entries, must be a power of two
+constexpr int PAWN_TABLE_SIZE = 1 << 14; //entries, must be a power of two
+constexpr int EVAL_CACHE_SIZE = 1 << 16; //entries, must be a power of two
 constexpr int MAX_DEPTH = 6;               // or whatever max perft depth you need
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief A read only view of a whole file. Memory mapped and shared with every other mapping of
+/// the same file where the platform allows, read into memory otherwise.
+class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /// @return false if the file cannot be opened or mapped, an empty file opens with size 0
+        bool open(const std::string& path);
+        void close();
+        bool is_open() const;
+
+        const unsigned char* data() const;
+        size_t size() const;
+
+    private:
+        const unsigned char* bytes = nullptr;
+        size_t length = 0;
+        bool opened = false;
+        std::vector<unsigned char> owned; //fallback storage where mmap is unavailable
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "board.h"
+#include "engine.h"
+
+/*
+ * Mate solver
+ *
+ * Depth-first proof-number search (df-pn) for a forced mate by the side to move within a
+ * number of its moves. Nodes where the attacker moves are OR nodes, nodes where the defender
+ * moves are AND nodes. Every node keeps phi and delta, its proof and disproof numbers seen
+ * from the side to move there: phi = pn and delta = dn at OR nodes, the other way round at
+ * AND nodes. A node is searched until its numbers reach the thresholds handed down by its
+ * parent, so the tree is walked depth first with memory bounded by the hash table.
+ *
+ * Entries are keyed by the zobrist key mixed with the attacker moves left, since a position
+ * can be a mate in 3 and not a mate in 2. Move counting keeps the search finite: every
+ * attacker move uses one up, so repetitions only come back with fewer moves left.
+ *
+ * Draw rules are not looked at, a line that repeats or runs into the fifty move rule still
+ * counts as a mate if it ends in one within the limit.
+ */
+
+namespace mate {
+
+    enum class Status : uint8_t {
+        MATE,      //forced mate found, line holds it
+        NO_MATE,   //no mate within the move limit
+        UNKNOWN    //node limit reached first
+    };
+
+    struct Result {
+        Status status = Status::UNKNOWN;
+        int moves = 0;          //mate in this many moves of the attacker, the shortest one
+        std::vector<Move> line; //attacker and defender moves, ending in mate unless the node limit ran out while reading it
+        uint64_t nodes = 0;
+    };
+
+    /// @brief A df-pn solver with its own hash table. Solvers share nothing, so independent positions can
+    /// be solved on as many threads as there are solvers.
+    class Solver {
+        public:
+            /// @param hash_mb size of the hash table, rounded down to a power of two entries
+            explicit Solver(size_t hash_mb = 16);
+
+            /// @brief Looks for a mate in at most moves moves of the side to move. Tries 1, 2, ... moves in
+            /// turn so the mate found is the shortest, and keeps the table between the tries.
+            /// @param node_limit stop after this many nodes, 0 for no limit
+            Result solve(const Position& position, int moves, uint64_t node_limit = 0);
+
+            /// @brief Empties the hash table
+            void clear();
+
+        private:
+            struct Numbers {
+                uint32_t phi;
+                uint32_t delta;
+            };
+
+            struct Entry {
+                uint64_t key;
+                Numbers numbers;
+                uint32_t work; //nodes searched below the entry, the bigger tree is kept on a collision
+            };
+
+            Engine engine;
+            std::vector<Entry> table;
+            uint64_t nodes = 0;
+            uint64_t node_limit = 0;
+
+            static uint64_t entry_key(const Position& position, int moves_left);
+            Numbers lookup(uint64_t key) const;
+            void store(uint64_t key, Numbers numbers, uint64_t work);
+
+            /// @brief Moves worth trying: every legal move, or only checks for the attacker's last move
+            int children(const Position& position, int moves_left, bool attacker, Move* moves);
+
+            /// @brief Searches until phi >= phi_threshold or delta >= delta_threshold, the numbers are returned and
+            /// left in the table
+            Numbers search(const Position& position, int moves_left, bool attacker, uint32_t phi_threshold, uint32_t delta_threshold);
+
+            bool out_of_nodes() const;
+
+            /// @brief Runs df-pn from the root for a mate in exactly this many moves or fewer
+            Status prove(const Position& position, int moves);
+
+            /// @brief Walks the proven tree, picking the longest defence at AND nodes. Stops early when the node
+            /// limit runs out.
+            void extract_line(const Position& position, int moves_left, bool attacker, std::vector<Move>& line);
+    };
+
+    /// @brief Solves every position on its own thread pool, one solver per thread
+    std::vector<Result> solve_parallel(const std::vector<Position>& positions, int moves, uint64_t node_limit, int threads);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+class Position;
+struct Move;
+
+/*
+ * NNUE evaluation
+ *
+ * Architecture: HalfKA-style feature transformer (king bucket x 12 pieces x 64 squares per perspective)
+ * into a 2 x NNUE_HIDDEN int16 accumulator, then two small int8 dense layers and an int8 output neuron.
+ *
+ *   a  = clamp(accumulator, 0, 127)                side to move half first
+ *   h1 = clamp((l1_bias + W1 . a) >> 6, 0, 127)
+ *   h2 = clamp((l2_bias + W2 . h1) >> 6, 0, 127)
+ *   cp = (out_bias + W3 . h2) / NNUE_OUTPUT_SCALE
+ *
+ * Network file (little endian):
+ *   uint32 magic NNUE_MAGIC, uint32 version NNUE_VERSION
+ *   int16 ft_bias[HIDDEN], int16 ft_weights[INPUTS][HIDDEN]
+ *   int32 l1_bias[L1],     int8  l1_weights[L1][2 * HIDDEN]
+ *   int32 l2_bias[L2],     int8  l2_weights[L2][L1]
+ *   int32 out_bias,        int8  out_weights[L2]
+ */
+
+constexpr int NNUE_KING_BUCKETS = 4;
+constexpr int NNUE_INPUTS = NNUE_KING_BUCKETS * 12 * 64;
+constexpr int NNUE_HIDDEN = 256;
+constexpr int NNUE_L1 = 32;
+constexpr int NNUE_L2 = 32;
+constexpr int NNUE_OUTPUT_SCALE = 16;
+constexpr uint32_t NNUE_MAGIC = 0x4E4E4344; // "DCNN"
+constexpr uint32_t NNUE_VERSION = 1;
+
+namespace nnue {
+
+    /// @brief Feature transformer output for both perspectives, lives inside Board and is
+    /// updated incrementally by make_move/undo_move while a network is loaded
+    struct alignas(32) Accumulator {
+        int16_t values[2][NNUE_HIDDEN]; //indexed by perspective color
+        uint32_t network_id;            //0 or a stale id means values must be refreshed before use
+    };
+
+    /// @brief Loads a network file, replacing any loaded network. Not thread safe, load before searching.
+    /// @return false if the file is missing, truncated or has the wrong magic/version (the old network is kept)
+    bool load_network(const std::string& path);
+    void unload_network();
+    bool is_loaded();
+
+    /// @brief Id of the loaded network, 0 when none is loaded. Changes on every load.
+    uint32_t network_id();
+
+    /// @brief Recomputes both perspectives from the board's bitboards
+    void refresh(Accumulator& accumulator, const Position& board);
+
+    /// @brief Applies the feature changes of a move, board must already reflect the position after the move
+    /// when undo is false, or the position before the move when undo is true
+    void update(Accumulator& accumulator, const Position& board, const Move& move, bool undo);
+
+    /// @brief Evaluates from the side to move's perspective in centipawns
+    int evaluate(const Accumulator& accumulator, int side_to_move);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "board.h"
+#include "engine.h"
+
+/*
+ * PGN reader
+ *
+ * Walks the text of a PGN file game by game and reports what it finds to a Visitor: tag pairs,
+ * moves of the main line and of variations, comments, NAGs and the result. Text is handed out as
+ * views into the input, and positions are copy-made on a fixed stack, so nothing is allocated per
+ * move. Only a FEN tag costs a string, since Position::set_position_fen takes one.
+ *
+ * SAN is decoded by parsing the piece, destination, promotion and disambiguation, then matching
+ * them against Engine::generate_legal_moves. "0-0" castling, long algebraic moves like Ng1-f3,
+ * promotions without '=' and move suffixes (+ # ! ? !! ?? !? ?!) are accepted; the suffixes are
+ * reported as NAGs 1-6.
+ *
+ * A game starts at a tag section or at movetext following the previous game's result, and ends at
+ * a result token (1-0, 0-1, 1/2-1/2, *), at the next tag section, or at the end of the text. A move
+ * that cannot be decoded ends the line it is in: the rest of the main line, or of the variation,
+ * is skipped and the game is reported with an error. Lines starting with '%' are ignored.
+ *
+ * For the parallel mode, a game boundary is a '[' at the start of a line that follows an empty line.
+ */
+
+namespace pgn {
+
+    constexpr int MAX_VARIATION_DEPTH = 32; //deeper variations are skipped
+
+    /// @brief Receives the contents of each game in order. Views are only valid during the call.
+    class Visitor {
+        public:
+            virtual ~Visitor() = default;
+
+            virtual void begin_game() {}
+            virtual void tag(std::string_view, std::string_view) {}
+
+            /// @brief A move, with the position it is played from. Depth is 0 for the main line, 1 and up inside variations.
+            virtual void move(const Position&, const Move&, int) {}
+            virtual void comment(std::string_view, int) {}
+            virtual void nag(int, int) {}
+            virtual void begin_variation(int) {}
+            virtual void end_variation(int) {}
+
+            /// @brief The result token, empty if the game ended without one, and whether a move could not be decoded or
+            /// the FEN tag could not be read
+            virtual void end_game(std::string_view, bool) {}
+
+            /// @brief Checked before each game, true ends the parse
+            virtual bool done() const { return false; }
+    };
+
+    /// @brief Parses PGN text. Keeps an Engine for move generation, so use one parser per thread.
+    class Parser {
+        public:
+            /// @return the number of games visited
+            uint64_t parse(std::string_view text, Visitor& visitor);
+
+            /// @brief The legal move a SAN string names in the position
+            /// @return false if there is none or the SAN is ambiguous
+            bool decode_san(const Position& position, std::string_view san, Move& out);
+
+        private:
+            Engine engine;
+    };
+
+    /// @brief Memory maps a file and parses it
+    /// @return the number of games visited, -1 if the file cannot be opened
+    int64_t parse_file(const std::string& path, Visitor& visitor);
+
+    /// @brief Cuts the text into at most parts pieces of about equal size, each starting at a game boundary
+    std::vector<std::string_view> split_games(std::string_view text, int parts);
+
+    /// @brief Parses pieces of the text on separate threads. Games within a piece are visited in order, pieces
+    /// run at the same time.
+    /// @param visitor_for gives the visitor of each piece, called on the piece's thread
+    /// @param pieces how many pieces to cut the text into, more pieces than threads balance the load
+    /// @return the number of games visited
+    uint64_t parse_parallel(std::string_view text, int threads, int pieces, const std::function<Visitor&(int piece)>& visitor_for);
+
+    /// @brief Memory maps a file and parses it with parse_parallel
+    /// @return the number of games visited, -1 if the file cannot be opened
+    int64_t parse_file_parallel(const std::string& path, int threads, int pieces, const std::function<Visitor&(int piece)>& visitor_for);
+}
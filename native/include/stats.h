@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+
+/// @brief Hot path counters, compiled in only when building with -DCHESS_STATS=ON.
+/// Counters are thread_local so each search/perft thread counts on its own without atomics.
+struct SearchStats {
+    uint64_t make_move_calls;
+    uint64_t undo_move_calls;
+    uint64_t illegal_moves_rejected; //pseudo-legal moves thrown out by generate_legal_moves
+    uint64_t square_attacked_calls;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    uint64_t beta_cutoffs;
+    uint64_t first_move_cutoffs; //beta cutoffs produced by the first move searched at a node
+    uint64_t pawn_table_probes;
+    uint64_t pawn_table_hits;
+    uint64_t eval_cache_probes;
+    uint64_t eval_cache_hits;
+    uint64_t tablebase_probes;
+    uint64_t tablebase_hits;
+};
+
+#ifdef CHESS_STATS
+
+inline thread_local SearchStats search_stats{};
+
+constexpr bool stats_enabled = true;
+
+#define CHESS_STAT_INC(field) (++search_stats.field)
+
+inline SearchStats get_search_stats() { return search_stats; }
+inline void reset_search_stats() { search_stats = SearchStats{}; }
+
+#else
+
+constexpr bool stats_enabled = false;
+
+//Expands to nothing so the counters cost nothing when the option is off
+#define CHESS_STAT_INC(field) ((void)0)
+
+inline SearchStats get_search_stats() { return SearchStats{}; }
+inline void reset_search_stats() {}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+class Position;
+
+/*
+ * Endgame tablebases
+ *
+ * Search consults the registered sources once few enough pieces are left: WDL results
+ * end the subtree with an exact score, and at the root DTZ ranks the moves that keep
+ * the best result. Sources are registered before searching and only read while probing,
+ * so every search thread can probe them.
+ *
+ * The only source shipped is egtb::GeneratedTables (tools/tbgen). There is no Syzygy reader:
+ * .rtbw/.rtbz files need a prober such as Fathom behind Source before they can be used.
+ */
+
+namespace tablebase {
+
+    /// @brief Game theoretic value for the side to move. Cursed wins and blessed losses are
+    /// wins and losses the fifty move rule turns into draws.
+    enum class WDL : int8_t {
+        LOSS = -2,
+        BLESSED_LOSS = -1,
+        DRAW = 0,
+        CURSED_WIN = 1,
+        WIN = 2
+    };
+
+    class Source {
+        public:
+            virtual ~Source() = default;
+
+            /// @brief Most pieces, kings included, this source has tables for
+            virtual int max_pieces() const = 0;
+
+            virtual bool probe_wdl(const Position& position, WDL& out) const = 0;
+
+            /// @brief Plies until the next capture or pawn move with best play, positive when the
+            /// side to move wins and negative when it loses
+            virtual bool probe_dtz(const Position& position, int& out) const = 0;
+
+            /// @brief Moves until mate with best play, positive when the side to move mates. Only
+            /// sources built from distance to mate tables know it.
+            virtual bool probe_dtm(const Position&, int&) const { return false; }
+    };
+
+    /// @brief Registers a source, earlier sources are asked first. Not thread safe, register before searching.
+    void add_source(std::shared_ptr<Source> source);
+    void clear_sources();
+
+    /// @brief Largest max_pieces of the registered sources, 0 when there are none
+    int max_pieces();
+
+    /// @return false if no source knows the position, positions with castling rights are never probed
+    bool probe_wdl(const Position& position, WDL& out);
+    bool probe_dtz(const Position& position, int& out);
+    bool probe_dtm(const Position& position, int& out);
+}
@@ -1,14 +1,31 @@
 #pragma once
 #include <vector>
+#include <bit>
 #include <board.h>
 
+/*
+ * Every lookup table below is constinit: the compiler computes it into read only data, so
+ * loading the engine or the bridge library runs no static initialization for them and no
+ * table depends on another being initialized first. New tables should be built the same way.
+ */
+
 constexpr int CHAR_MAP_SIZE = 128;
 
 std::vector<std::string> splitString(const std::string& string, char delimiter);
-int rankOf(int square);
-int fileOf(int square);
 
-extern const Piece charToPiece[CHAR_MAP_SIZE];
+constexpr int rankOf(int square){ return square / 8; }
+constexpr int fileOf(int square){ return square % 8; }
+
+//Chebyshev distance, the number of king moves between the squares
+constexpr int square_distance(int a, int b){
+    int ranks = rankOf(a) - rankOf(b);
+    int files = fileOf(a) - fileOf(b);
+    ranks = ranks < 0 ? -ranks : ranks;
+    files = files < 0 ? -files : files;
+    return ranks > files ? ranks : files;
+}
+
+extern const std::array<Piece, CHAR_MAP_SIZE> charToPiece;
 extern const char pieceToChar[CHAR_MAP_SIZE];
 
 extern const std::array<int, 8> knight_offsets;
@@ -23,9 +40,19 @@ extern const std::array<Bitboard, 64> knight_moves; //We call these moves instea
 extern const std::array<Bitboard, 64> king_moves; //because they are used in move generation as well
 extern const std::array<Bitboard, 128> pawn_attacks;
 extern const std::array<std::array<int,8>, 64> num_squares_to_edge;
+
+//Indexed [a][b], 0 when the squares share no rank, file or diagonal
+extern const std::array<std::array<Bitboard, 64>, 64> between_masks; //squares strictly between a and b
+extern const std::array<std::array<Bitboard, 64>, 64> line_masks; //the whole line through a and b, both included
+
+//Pawn structure masks, the per color tables are indexed [color][square]
+extern const std::array<Bitboard, 8> file_masks;
+extern const std::array<Bitboard, 8> adjacent_file_masks;
+extern const std::array<std::array<Bitboard, 64>, 2> passed_pawn_masks; //squares ahead on the same and adjacent files
+extern const std::array<std::array<Bitboard, 64>, 2> pawn_support_masks; //adjacent files on the same rank or behind
 extern const std::array<int, 16> direction_offsets;
 
-const std::array<int, 64> flip_array = {
+constexpr std::array<int, 64> flip_array = {
     56, 57, 58, 59, 60, 61, 62, 63,
     48, 49, 50, 51, 52, 53, 54, 55,
     40, 41, 42, 43, 44, 45, 46, 47,
@@ -36,16 +63,71 @@ const std::array<int, 64> flip_array = {
     0,  1,  2,  3,  4,  5,  6,  7
 };
 
+//Middlegame and endgame tables, the evaluation blends them by game phase
 extern const std::array<std::array<int, 64>, 6> piece_square_table;
+extern const std::array<std::array<int, 64>, 6> piece_square_table_eg;
+
+//Contribution of each piece type to the game phase, the starting position sums to MAX_GAME_PHASE
+constexpr std::array<int, 6> phase_weights = {0, 1, 1, 2, 4, 0};
+constexpr int MAX_GAME_PHASE = 24;
+
+//Zobrist keys, castling is indexed by the full 4 bit castling state and en passant by file
+extern const std::array<std::array<uint64_t, 64>, 12> zobrist_pieces;
+extern const std::array<uint64_t, 16> zobrist_castling;
+extern const std::array<uint64_t, 8> zobrist_en_passant;
+extern const uint64_t zobrist_side;
+
+constexpr Bitboard compute_knight_attacks(int square){
+    constexpr std::array<int, 8> rank_steps = {2, 2, 1, 1, -1, -1, -2, -2};
+    constexpr std::array<int, 8> file_steps = {1, -1, 2, -2, 2, -2, 1, -1};
+    Bitboard attacks = 0ULL;
+
+    for(int j = 0; j < 8; j++){
+        int r = rankOf(square) + rank_steps[j];
+        int f = fileOf(square) + file_steps[j];
+        if(r >= 0 && r < 8 && f >= 0 && f < 8) attacks |= 1ULL << (r * 8 + f);
+    }
+    return attacks;
+}
+
+constexpr Bitboard compute_king_attacks(int square){
+    Bitboard attacks = 0ULL;
+
+    for(int dr = -1; dr <= 1; dr++){
+        for(int df = -1; df <= 1; df++){
+            if(dr == 0 && df == 0) continue;
+            int r = rankOf(square) + dr;
+            int f = fileOf(square) + df;
+            if(r >= 0 && r < 8 && f >= 0 && f < 8) attacks |= 1ULL << (r * 8 + f);
+        }
+    }
+    return attacks;
+}
 
-Bitboard compute_knight_attacks(int square);
-Bitboard compute_king_attacks(int square);
-Bitboard compute_pawn_attacks(int square, Color color);
+constexpr Bitboard compute_pawn_attacks(int square, Color color){
+    Bitboard attacks = 0ULL;
+    int r = rankOf(square) + (color == Color::WHITE ? 1 : -1);
+
+    for(int df : {-1, 1}){
+        int f = fileOf(square) + df;
+        if(r >= 0 && r < 8 && f >= 0 && f < 8) attacks |= 1ULL << (r * 8 + f);
+    }
+    return attacks;
+}
 
 Bitboard get_bishop_attacks(int square, Bitboard occupied);
 Bitboard get_rook_attacks(int square, Bitboard occupied);
 Bitboard get_queen_attacks(int square, Bitboard occupied);
 
+//Set-wise attack maps: the union of the attacks of every piece in the set, for whole side attack maps
+Bitboard pawn_attack_map(Bitboard pawns, Color color);
+Bitboard knight_attack_map(Bitboard knights);
+Bitboard king_attack_map(Bitboard kings);
+
+/// @brief Attacks of all rook movers and bishop movers at once with Kogge-Stone occluded fills, queens
+/// go in both sets. Runs the eight directions as two AVX2 vectors of four when the build targets AVX2.
+Bitboard slider_attack_map(Bitboard orthogonal, Bitboard diagonal, Bitboard occupied);
+
 constexpr uint64_t A_FILE_MASK = 0x0101010101010101ULL; //(A1, A2, ..., A8)
 constexpr uint64_t H_FILE_MASK = 0x8080808080808080ULL; //(H1, H2, ..., H8)
 
@@ -0,0 +1,154 @@
+#include "bitbase.h"
+#include "utils.h"
+#include <array>
+#include <bit>
+#include <vector>
+
+namespace {
+
+    constexpr int PAWN_SQUARES = 24; //files a-d, ranks 2-7
+    constexpr int POSITIONS = 2 * PAWN_SQUARES * 64 * 64;
+
+    //Results are flags so a position can collect what its moves reach
+    constexpr uint8_t INVALID = 0;
+    constexpr uint8_t UNKNOWN = 1;
+    constexpr uint8_t DRAW = 2;
+    constexpr uint8_t WIN = 4;
+
+    int kpk_index(Color side_to_move, int black_king, int white_king, int pawn) {
+        int pawn_index = (rankOf(pawn) - 1) * 4 + fileOf(pawn);
+        return static_cast<int>(side_to_move) + 2 * (black_king + 64 * (white_king + 64 * pawn_index));
+    }
+
+    struct KPKPosition {
+        Color side_to_move;
+        int white_king;
+        int black_king;
+        int pawn;
+        uint8_t result;
+
+        explicit KPKPosition(int index) {
+            side_to_move = static_cast<Color>(index & 1);
+            black_king = (index >> 1) & 63;
+            white_king = (index >> 7) & 63;
+            int pawn_index = index >> 13;
+            pawn = (pawn_index / 4 + 1) * 8 + pawn_index % 4;
+
+            Bitboard pawn_attacks_white = pawn_attacks[pawn];
+            int promotion = pawn + 8;
+
+            if(square_distance(white_king, black_king) <= 1 || white_king == pawn || black_king == pawn
+               || (side_to_move == Color::WHITE && (pawn_attacks_white & (1ULL << black_king)))){
+                result = INVALID;
+            } else if(side_to_move == Color::WHITE && rankOf(pawn) == 6 && white_king != promotion
+                      && (square_distance(black_king, promotion) > 1 || square_distance(white_king, promotion) == 1)){
+                //The pawn promotes and the queen cannot be taken
+                result = WIN;
+            } else if(side_to_move == Color::BLACK
+                      && (!(king_moves[black_king] & ~(king_moves[white_king] | pawn_attacks_white))
+                          || (king_moves[black_king] & ~king_moves[white_king] & (1ULL << pawn)))){
+                //Stalemate, or the black king takes the undefended pawn
+                result = DRAW;
+            } else {
+                result = UNKNOWN;
+            }
+        }
+
+        //White needs one winning move, black one drawing move
+        uint8_t classify(const std::vector<KPKPosition>& positions) const {
+            uint8_t reached = INVALID;
+            Bitboard targets = king_moves[side_to_move == Color::WHITE ? white_king : black_king];
+
+            while(targets != 0){
+                int to = pop_lsb(targets);
+                reached |= side_to_move == Color::WHITE ? positions[kpk_index(Color::BLACK, black_king, to, pawn)].result
+                                                        : positions[kpk_index(Color::WHITE, to, white_king, pawn)].result;
+            }
+
+            if(side_to_move == Color::WHITE && rankOf(pawn) < 6){
+                int push = pawn + 8;
+                reached |= positions[kpk_index(Color::BLACK, black_king, white_king, push)].result;
+
+                if(rankOf(pawn) == 1 && push != white_king && push != black_king){
+                    reached |= positions[kpk_index(Color::BLACK, black_king, white_king, push + 8)].result;
+                }
+            }
+
+            uint8_t good = side_to_move == Color::WHITE ? WIN : DRAW;
+            uint8_t bad = side_to_move == Color::WHITE ? DRAW : WIN;
+            return (reached & good) ? good : (reached & UNKNOWN) ? UNKNOWN : bad;
+        }
+    };
+
+    std::array<uint32_t, POSITIONS / 32> build_kpk() {
+        std::vector<KPKPosition> positions;
+        positions.reserve(POSITIONS);
+        for(int index = 0; index < POSITIONS; index++) positions.emplace_back(index);
+
+        //Iterate until nothing changes, whatever is left unknown is a draw
+        bool changed = true;
+        while(changed){
+            changed = false;
+            for(KPKPosition& position : positions){
+                if(position.result != UNKNOWN) continue;
+                position.result = position.classify(positions);
+                changed |= position.result != UNKNOWN;
+            }
+        }
+
+        std::array<uint32_t, POSITIONS / 32> bits{};
+        for(int index = 0; index < POSITIONS; index++){
+            if(positions[index].result == WIN) bits[index / 32] |= 1u << (index % 32);
+        }
+        return bits;
+    }
+
+    const std::array<uint32_t, POSITIONS / 32>& kpk_bits() {
+        static const std::array<uint32_t, POSITIONS / 32> bits = build_kpk();
+        return bits;
+    }
+}
+
+namespace bitbase {
+
+    bool kpk_win(int white_king, int white_pawn, int black_king, Color side_to_move) {
+        //Mirror pawns on files e-h onto a-d
+        if(fileOf(white_pawn) > 3){
+            white_king ^= 7;
+            white_pawn ^= 7;
+            black_king ^= 7;
+        }
+
+        int index = kpk_index(side_to_move, black_king, white_king, white_pawn);
+        return kpk_bits()[index / 32] & (1u << (index % 32));
+    }
+
+    bool probe_kpk(const Position& position, int& result) {
+        Bitboard occupied = position.occupancy;
+        if(std::popcount(occupied) != 3) return false;
+
+        Bitboard white_pawns = position.get_piece_bitboard(Piece::W_PAWN);
+        Bitboard black_pawns = position.get_piece_bitboard(Piece::B_PAWN);
+        if((white_pawns | black_pawns) == 0) return false;
+
+        Color strong = white_pawns != 0 ? Color::WHITE : Color::BLACK;
+        int strong_king = std::countr_zero(position.get_piece_bitboard(strong == Color::WHITE ? Piece::W_KING : Piece::B_KING));
+        int weak_king = std::countr_zero(position.get_piece_bitboard(strong == Color::WHITE ? Piece::B_KING : Piece::W_KING));
+        int pawn = std::countr_zero(white_pawns | black_pawns);
+        //The table only indexes pawns on ranks 2-7, anything else is left to the normal eval
+        if(rankOf(pawn) == 0 || rankOf(pawn) == 7) return false;
+        Color side_to_move = position.sideToMove;
+
+        //Black's pawn: flip the board so it runs up as white's
+        if(strong == Color::BLACK){
+            strong_king ^= 56;
+            weak_king ^= 56;
+            pawn ^= 56;
+            side_to_move = side_to_move == Color::WHITE ? Color::BLACK : Color::WHITE;
+        }
+
+        bool win = kpk_win(strong_king, pawn, weak_king, side_to_move);
+        result = !win ? 0 : position.sideToMove == strong ? 1 : -1;
+        return true;
+    }
+}
@@ -3,16 +3,16 @@
 #include <regex>
 #include <iostream>
 #include "board.h"
+#include "stats.h"
 #include <sstream>
+#include <algorithm>
 
-Board::Board() {
+Position::Position() {
     sideToMove = Color::WHITE;
     castlingRightsState = static_cast<u_int8_t>(CastlingRights::ALL);
-    enPassantSquare = std::nullopt;
+    enPassantSquare = NO_SQUARE;
     half_move_clock = 0;
-    num_moves_total = 0;
-    color_can_en_passant = Color::NONE;
-    history_ply = 0;
+    num_moves_total = 1;
 
     bitboard_array = {
         0x000000000000FF00,
@@ -30,20 +30,28 @@ Board::Board() {
     };
 
     update_color_bitboard();
+    attack_cache = AttackCache{};
     init_pst_tables(); //initial values of pst_tables should be the same;
+    zobrist_key = compute_zobrist_key();
+    pawn_key = compute_pawn_key();
+}
+
+Board::Board() {
+    history_ply = 0;
+    accumulator.network_id = 0; //refreshed on first evaluation
 }
 
-Bitboard Board::get_piece_bitboard(Piece piece) const
+Bitboard Position::get_piece_bitboard(Piece piece) const
 {
     return bitboard_array[piece];
 }
 
-Bitboard Board::get_piece_bitboard(PieceType type, Color color) const
+Bitboard Position::get_piece_bitboard(PieceType type, Color color) const
 {
-    return bitboard_array[((int) type) + (color == Color::WHITE ? 0 : 1)];
+    return bitboard_array[static_cast<int>(type) + (color == Color::WHITE ? 0 : 6)];
 }
 
-void Board::set_position_fen(const std::string &fen)
+void Position::set_position_fen(const std::string &fen)
 {
     const auto parts = splitString(fen, ' ');
 
@@ -64,11 +72,10 @@ void Board::set_position_fen(const std::string &fen)
     //Turn
     this->sideToMove = side_to_move == "w" ? Color::WHITE : Color::BLACK;
 
-    //En Passant
-    if(en_passant_target_square == "-") {
-      enPassantSquare = std::nullopt;
-    } else {
-      enPassantSquare = squareIndexFromAlgebraicConst(en_passant_target_square);
+    //En Passant, dropped when no pawn can take it
+    enPassantSquare = NO_SQUARE;
+    if(en_passant_target_square != "-") {
+      set_en_passant_if_capturable(squareIndexFromAlgebraicConst(en_passant_target_square), sideToMove == Color::WHITE ? Color::BLACK : Color::WHITE);
     }
 
     //Castling Ability
@@ -85,66 +92,117 @@ void Board::set_position_fen(const std::string &fen)
     this->num_moves_total = std::stoi(num_moves_total);
 
     update_color_bitboard();
+    attack_cache.valid = 0;
     
     //Update pst
     init_pst_tables();
+
+    zobrist_key = compute_zobrist_key();
+    pawn_key = compute_pawn_key();
+}
+
+//A pawn of the other color standing diagonally behind the square is the only thing that can capture on it
+void Position::set_en_passant_if_capturable(int square, Color pushed_by)
+{
+    Piece capturer = pushed_by == Color::WHITE ? Piece::B_PAWN : Piece::W_PAWN;
+    Bitboard attackers = pawn_attacks[static_cast<int>(pushed_by) * 64 + square] & bitboard_array[capturer];
+
+    if(attackers != 0) enPassantSquare = static_cast<uint8_t>(square);
+}
+
+void Board::set_position_fen(const std::string &fen)
+{
+    Position::set_position_fen(fen);
+
+    //A new position starts a new game, earlier moves can no longer be undone or repeated
+    history_ply = 0;
+    accumulator.network_id = 0;
+}
+
+void Board::set_position(const Position &position)
+{
+    static_cast<Position&>(*this) = position;
+    history_ply = 0;
+    accumulator.network_id = 0;
 }
 
 //We assume a move passed into here is valid
 void Board::make_move(Move& move) {
-    Bitboard bitboard = bitboard_array[move.piece];
-
     move_history[history_ply++] = Move_State{
         move,
         move.captured_piece,
         enPassantSquare,
         castlingRightsState,
-        move.promoted_piece != Piece::NONE
+        move.promoted_piece != Piece::NONE,
+        zobrist_key,
+        pawn_key,
+        pst_mg,
+        pst_eg,
+        game_phase,
+        half_move_clock,
+        attack_cache.checkers,
+        attack_cache.pinned,
+        static_cast<uint8_t>(attack_cache.valid & (AttackCache::CHECKERS | AttackCache::PINNED))
     };
 
-    if(move.is_enpassant && move.captured_piece != Piece::NONE){
-        int captured_pawn_square = (move.piece == Piece::W_PAWN)
-            ? move.to_square - 8
-            : move.to_square + 8;
-        
-        remove_captured_piece(captured_pawn_square, move.captured_piece);
-    } else if (move.captured_piece != Piece::NONE) {
-        remove_captured_piece(move.to_square, move.captured_piece);
+    apply_move(move);
+
+    nnue::update(accumulator, *this, move, false);
+}
+
+void Position::apply_move(const Move& move) {
+    //The only branch on the mover's color, apply_move_for is compiled once per color
+    if(sideToMove == Color::WHITE) apply_move_for<Color::WHITE>(move);
+    else apply_move_for<Color::BLACK>(move);
+}
+
+template<Color Us>
+void Position::apply_move_for(const Move& move) {
+    CHESS_STAT_INC(make_move_calls);
+
+    constexpr Color Them = Us == Color::WHITE ? Color::BLACK : Color::WHITE;
+    constexpr Piece pawn = Us == Color::WHITE ? Piece::W_PAWN : Piece::B_PAWN;
+    constexpr Piece king = Us == Color::WHITE ? Piece::W_KING : Piece::B_KING;
+    constexpr Piece rook = Us == Color::WHITE ? Piece::W_ROOK : Piece::B_ROOK;
+    constexpr int UP = Us == Color::WHITE ? 8 : -8;
+    constexpr int home = Us == Color::WHITE ? 0 : 56; //a1 or a8
+
+    Bitboard bitboard = bitboard_array[move.piece];
+
+    //Captures and pawn moves can never be undone, so they reset the fifty move count and end repetition scans
+    bool irreversible = move.captured_piece != Piece::NONE || move.piece == pawn;
+    half_move_clock = irreversible ? 0 : half_move_clock + 1;
+    if constexpr (Us == Color::BLACK) num_moves_total++;
+
+    //Take the old castling and en passant state out of the key, the new state is hashed back in at the end
+    zobrist_key ^= zobrist_castling[castlingRightsState];
+    if(enPassantSquare != NO_SQUARE) zobrist_key ^= zobrist_en_passant[enPassantSquare % 8];
+
+    //An en passant capture takes the pawn behind the target square
+    if(move.captured_piece != Piece::NONE){
+        int captured_square = move.is_enpassant ? move.to_square - UP : move.to_square;
+        remove_captured_piece<Them>(captured_square, move.captured_piece);
     }
 
     //En Passant updates
-    if(move.piece == Piece::W_PAWN && (move.from_square / 8 == 1) && (move.to_square / 8 == 3)){
-        enPassantSquare = move.from_square + 8;
-        color_can_en_passant = Color::BLACK;
-    } else if (move.piece == Piece::B_PAWN && (move.from_square / 8 == 6) && (move.to_square / 8 == 4)){
-        enPassantSquare = move.from_square - 8;
-        color_can_en_passant = Color::WHITE;
-    } else {
-        enPassantSquare = std::nullopt;
-        color_can_en_passant = Color::NONE;
+    enPassantSquare = NO_SQUARE;
+    if(move.piece == pawn && move.to_square - move.from_square == 2 * UP){
+        set_en_passant_if_capturable(move.from_square + UP, Us);
     }
 
     //Castling Rights updates
-    if(move.piece == W_KING){
-        remove_all_castling_rights_white();
-    } else if (move.piece == B_KING) {
-        remove_all_castling_rights_black();
-    } else if(move.piece == W_ROOK && move.from_square == 0){
-        remove_castling_right(CastlingRights::WHITE_QUEENSIDE);
-    }
-    else if(move.piece == W_ROOK && move.from_square == 7){
-        remove_castling_right(CastlingRights::WHITE_KINGSIDE);
-    }
-    else if(move.piece == B_ROOK && move.from_square == 56){
-        remove_castling_right(CastlingRights::BLACK_QUEENSIDE);
-    }
-    else if(move.piece == B_ROOK && move.from_square == 63){
-        remove_castling_right(CastlingRights::BLACK_KINGSIDE);
+    if(move.piece == king){
+        if constexpr (Us == Color::WHITE) remove_all_castling_rights_white();
+        else remove_all_castling_rights_black();
+    } else if(move.piece == rook && move.from_square == home){
+        remove_castling_right(Us == Color::WHITE ? CastlingRights::WHITE_QUEENSIDE : CastlingRights::BLACK_QUEENSIDE);
+    } else if(move.piece == rook && move.from_square == home + 7){
+        remove_castling_right(Us == Color::WHITE ? CastlingRights::WHITE_KINGSIDE : CastlingRights::BLACK_KINGSIDE);
     }
 
     //Castling
     if(move.is_castling){
-        castle_move(move);
+        castle_move<Us>(move);
     }
 
     //Regular Logic & Promotion
@@ -154,6 +212,14 @@ void Board::make_move(Move& move) {
 
     Bitboard endMask = 1ULL << move.to_square;
 
+    zobrist_key ^= zobrist_pieces[move.piece][move.from_square];
+    zobrist_key ^= zobrist_pieces[move.promoted_piece != Piece::NONE ? move.promoted_piece : static_cast<Piece>(move.piece)][move.to_square];
+
+    if(move.piece == pawn){
+        pawn_key ^= zobrist_pieces[move.piece][move.from_square];
+        if(move.promoted_piece == Piece::NONE) pawn_key ^= zobrist_pieces[move.piece][move.to_square];
+    }
+
     //Promotion
     if(move.promoted_piece != Piece::NONE){
         // Remove pawn from its bitboard (already done in newBitboard)
@@ -167,72 +233,81 @@ void Board::make_move(Move& move) {
         bitboard_array[move.piece] = newBitboard;
     }
 
-    //Update PST
-    Color color = colorOf(static_cast<Piece>(move.piece));
-    int pstFromSquare = color == Color::WHITE ? flip_array[move.from_square] : move.from_square;
-    int pstToSquare = color == Color::WHITE ? flip_array[move.to_square]: move.to_square;
+    //Update PST, a promotion removes the pawn and adds the new piece
+    update_pst(static_cast<Piece>(move.piece), move.from_square, -1);
+    update_pst(move.promoted_piece != Piece::NONE ? move.promoted_piece : static_cast<Piece>(move.piece), move.to_square, 1);
 
-    pst_colors[static_cast<int>(color)] -= piece_square_table[static_cast<int>(typeOf(static_cast<Piece>(move.piece)))][pstFromSquare];
-    pst_colors[static_cast<int>(color)] += piece_square_table[static_cast<int>(typeOf(static_cast<Piece>(move.piece)))][pstToSquare];
+    toggle_occupancy<Us>(startMask | endMask);
 
     //Switch turn
-    sideToMove = sideToMove == Color::WHITE ? Color::BLACK : Color::WHITE;
+    sideToMove = Them;
 
-    update_color_bitboard();
+    zobrist_key ^= zobrist_castling[castlingRightsState];
+    if(enPassantSquare != NO_SQUARE) zobrist_key ^= zobrist_en_passant[enPassantSquare % 8];
+    zobrist_key ^= zobrist_side;
+
+    attack_cache.valid = 0;
 }
 
 void Board::undo_move() {
+    CHESS_STAT_INC(undo_move_calls);
+
     if(history_ply == 0){
         //throw std::invalid_argument("Tried to invoke undo_move when move_history was empty");
         return;
     }
 
+    //The side that made the last move is the one not to move now
+    if(sideToMove == Color::BLACK) undo_move_for<Color::WHITE>();
+    else undo_move_for<Color::BLACK>();
+}
+
+template<Color Us>
+void Board::undo_move_for() {
+    constexpr Color Them = Us == Color::WHITE ? Color::BLACK : Color::WHITE;
+    constexpr int UP = Us == Color::WHITE ? 8 : -8;
+    constexpr int home = Us == Color::WHITE ? 0 : 56;
+
     Move_State last = move_history[--history_ply];
 
     Move move = last.move;
 
     //Revert side
-    sideToMove = sideToMove == Color::WHITE ? Color::BLACK : Color::WHITE;
+    sideToMove = Us;
 
     //Restore Flags
     enPassantSquare = last.enPassantSquare;
     castlingRightsState = last.castling_rights;
+    zobrist_key = last.zobrist_key;
+    pawn_key = last.pawn_key;
+    pst_mg = last.pst_mg;
+    pst_eg = last.pst_eg;
+    game_phase = last.game_phase;
+    half_move_clock = last.half_move_clock;
+    attack_cache.checkers = last.checkers;
+    attack_cache.pinned = last.pinned;
+    attack_cache.valid = last.attack_valid;
+    if constexpr (Us == Color::BLACK) num_moves_total--;
 
     //Undo Piece Movement
     bitboard_array[move.piece] &= ~(1ULL << move.to_square);
     bitboard_array[move.piece] |= 1ULL << move.from_square;
+    toggle_occupancy<Us>((1ULL << move.from_square) | (1ULL << move.to_square));
 
-    //Restore capture
-    if(last.captured_piece != Piece::NONE && !move.is_enpassant){
-        bitboard_array[last.captured_piece] |= (1ULL << move.to_square);
+    //Restore capture, an en passant capture puts the pawn back behind the target square
+    if(last.captured_piece != Piece::NONE){
+        int captured_square = move.is_enpassant ? move.to_square - UP : move.to_square;
+        bitboard_array[last.captured_piece] |= (1ULL << captured_square);
+        toggle_occupancy<Them>(1ULL << captured_square);
     }
 
-    //Undo special moves (castle, en passant, etc.)
+    //Undo castle, the rook goes back to its corner
     if(move.is_castling){
-        if (move.to_square - move.from_square == 2) {
-        // kingside
-        int rookStart = colorOf(static_cast<Piece>(move.piece)) == Color::WHITE ? 7 : 63;
-        int rookEnd = colorOf(static_cast<Piece>(move.piece)) == Color::WHITE  ? 5 : 61;
-        
-        undo_rook_castle(colorOf(static_cast<Piece>(move.piece)), rookStart, rookEnd);
-      } else if (move.to_square - move.from_square == -2) {
-        // queenside
-        int rookStart = colorOf(static_cast<Piece>(move.piece)) == Color::WHITE ? 0 : 56;
-        int rookEnd = colorOf(static_cast<Piece>(move.piece)) == Color::WHITE ? 3 : 59;
-
-        undo_rook_castle(colorOf(static_cast<Piece>(move.piece)), rookStart, rookEnd);
-      }
-    }
-
-    // Undo en passant
-    if (move.is_enpassant && move.captured_piece != Piece::NONE) {
-        int capturedPawnSquare = colorOf(static_cast<Piece>(move.piece)) == Color::WHITE
-            ? move.to_square - 8
-            : move.to_square + 8;
-        Piece capturedPawn = colorOf(static_cast<Piece>(move.piece)) == Color::WHITE
-            ? Piece::B_PAWN
-            : Piece::W_PAWN;
-        bitboard_array[move.captured_piece] |= (1ULL << capturedPawnSquare);
+        if (move.to_square > move.from_square) {
+            undo_rook_castle<Us>(home + 7, home + 5);
+        } else {
+            undo_rook_castle<Us>(home, home + 3);
+        }
     }
 
     //undo promotion
@@ -241,20 +316,22 @@ void Board::undo_move() {
       bitboard_array[move.promoted_piece] &= ~(1ULL << move.to_square);
     }
 
-    update_color_bitboard();
+    nnue::update(accumulator, *this, move, true);
 }
 
-bool Board::is_in_check(Color color) {
+bool Position::is_in_check(Color color) const {
+    if(color == sideToMove) return checkers() != 0;
+
     int kingSquare = get_king_square(color);
     return is_square_attacked(kingSquare, color == Color::WHITE ? Color::BLACK : Color::WHITE);
 }
 
-bool Board::can_castle(CastlingRights right) const {
+bool Position::can_castle(CastlingRights right) const {
     //if can castle 1 bit = 1, so non-zero = true, else all 0 = false
     return (castlingRightsState & static_cast<uint8_t>(right)) != 0; 
 }
 
-Piece Board::get_piece_at(int square) const
+Piece Position::get_piece_at(int square) const
 {
     if(square < 0 || square > 63){
         throw std::invalid_argument("Square must be between 0 and 63");  
@@ -279,7 +356,7 @@ Piece Board::get_piece_at(int square) const
     return Piece::NONE;
 }
 
-Bitboard Board::get_active_color_bb() const
+Bitboard Position::get_active_color_bb() const
 {
     if(sideToMove == Color::WHITE) 
         return white_occupancy;
@@ -287,21 +364,229 @@ Bitboard Board::get_active_color_bb() const
         return black_occupancy;
 }
 
-Bitboard Board::get_empty_squares() const
+Bitboard Position::get_empty_squares() const
+{
+    return ~occupancy;
+}
+
+Bitboard Position::attack_map(Color attacking_color) const
+{
+    return attack_map(attacking_color, occupancy);
+}
+
+Bitboard Position::attack_map(Color attacking_color, Bitboard occupied) const
+{
+    Bitboard queens = get_piece_bitboard(PieceType::QUEEN, attacking_color);
+
+    return pawn_attack_map(get_piece_bitboard(PieceType::PAWN, attacking_color), attacking_color)
+         | knight_attack_map(get_piece_bitboard(PieceType::KNIGHT, attacking_color))
+         | king_attack_map(get_piece_bitboard(PieceType::KING, attacking_color))
+         | slider_attack_map(get_piece_bitboard(PieceType::ROOK, attacking_color) | queens,
+                             get_piece_bitboard(PieceType::BISHOP, attacking_color) | queens, occupied);
+}
+
+Bitboard Position::attacked_squares(Color attacking_color) const
+{
+    int index = static_cast<int>(attacking_color);
+    uint8_t flag = attacking_color == Color::WHITE ? AttackCache::WHITE_ATTACKS : AttackCache::BLACK_ATTACKS;
+
+    if((attack_cache.valid & flag) == 0){
+        Color defender = attacking_color == Color::WHITE ? Color::BLACK : Color::WHITE;
+        Bitboard occupied = occupancy & ~get_piece_bitboard(PieceType::KING, defender);
+
+        attack_cache.attacked[index] = attack_map(attacking_color, occupied);
+        attack_cache.valid |= flag;
+    }
+    return attack_cache.attacked[index];
+}
+
+Bitboard Position::checkers() const
+{
+    if((attack_cache.valid & AttackCache::CHECKERS) == 0){
+        Color us = sideToMove;
+        Color them = us == Color::WHITE ? Color::BLACK : Color::WHITE;
+        Bitboard king = get_piece_bitboard(PieceType::KING, us);
+        Bitboard result = 0;
+
+        if(king != 0){
+            int square = std::countr_zero(king);
+            Bitboard occupied = occupancy;
+            Bitboard queens = get_piece_bitboard(PieceType::QUEEN, them);
+
+            result = (pawn_attacks[static_cast<int>(us) * 64 + square] & get_piece_bitboard(PieceType::PAWN, them))
+                   | (knight_moves[square] & get_piece_bitboard(PieceType::KNIGHT, them))
+                   | (king_moves[square] & get_piece_bitboard(PieceType::KING, them))
+                   | (get_rook_attacks(square, occupied) & (get_piece_bitboard(PieceType::ROOK, them) | queens))
+                   | (get_bishop_attacks(square, occupied) & (get_piece_bitboard(PieceType::BISHOP, them) | queens));
+        }
+
+        attack_cache.checkers = result;
+        attack_cache.valid |= AttackCache::CHECKERS;
+    }
+    return attack_cache.checkers;
+}
+
+Bitboard Position::pinned() const
+{
+    if((attack_cache.valid & AttackCache::PINNED) == 0){
+        Color us = sideToMove;
+        Color them = us == Color::WHITE ? Color::BLACK : Color::WHITE;
+        Bitboard king = get_piece_bitboard(PieceType::KING, us);
+        Bitboard result = 0;
+
+        if(king != 0){
+            Bitboard own = us == Color::WHITE ? white_occupancy : black_occupancy;
+            result = line_blockers(std::countr_zero(king), them) & own;
+        }
+
+        attack_cache.pinned = result;
+        attack_cache.valid |= AttackCache::PINNED;
+    }
+    return attack_cache.pinned;
+}
+
+Bitboard Position::line_blockers(int king_square, Color slider_color) const
+{
+    Bitboard queens = get_piece_bitboard(PieceType::QUEEN, slider_color);
+    Bitboard result = 0;
+
+    //A slider that would see the king on an empty board is held back by a lone piece in between
+    Bitboard snipers = (get_rook_attacks(king_square, 0) & (get_piece_bitboard(PieceType::ROOK, slider_color) | queens))
+                     | (get_bishop_attacks(king_square, 0) & (get_piece_bitboard(PieceType::BISHOP, slider_color) | queens));
+    while(snipers != 0){
+        Bitboard between = between_masks[king_square][pop_lsb(snipers)] & occupancy;
+        if(std::popcount(between) == 1) result |= between;
+    }
+    return result;
+}
+
+void Position::compute_check_info() const
+{
+    Color us = sideToMove;
+    Color them = us == Color::WHITE ? Color::BLACK : Color::WHITE;
+    Bitboard king = get_piece_bitboard(PieceType::KING, them);
+
+    attack_cache.check_squares = {};
+    attack_cache.discoverers = 0;
+
+    if(king != 0){
+        int square = std::countr_zero(king);
+        Bitboard own = us == Color::WHITE ? white_occupancy : black_occupancy;
+
+        //Attacks are symmetric, a piece checks from the squares the same piece would attack from the king
+        auto& squares = attack_cache.check_squares;
+        squares[static_cast<int>(PieceType::PAWN)] = pawn_attacks[static_cast<int>(them) * 64 + square];
+        squares[static_cast<int>(PieceType::KNIGHT)] = knight_moves[square];
+        squares[static_cast<int>(PieceType::BISHOP)] = get_bishop_attacks(square, occupancy);
+        squares[static_cast<int>(PieceType::ROOK)] = get_rook_attacks(square, occupancy);
+        squares[static_cast<int>(PieceType::QUEEN)] = squares[static_cast<int>(PieceType::BISHOP)] | squares[static_cast<int>(PieceType::ROOK)];
+
+        attack_cache.discoverers = line_blockers(square, us) & own;
+    }
+
+    attack_cache.valid |= AttackCache::CHECK_INFO;
+}
+
+Bitboard Position::check_squares(PieceType type) const
+{
+    if((attack_cache.valid & AttackCache::CHECK_INFO) == 0) compute_check_info();
+    return attack_cache.check_squares[static_cast<int>(type)];
+}
+
+Bitboard Position::discoverers() const
+{
+    if((attack_cache.valid & AttackCache::CHECK_INFO) == 0) compute_check_info();
+    return attack_cache.discoverers;
+}
+
+bool Position::gives_check(const Move& move) const
 {
-    return ~(white_occupancy | black_occupancy);
+    Color them = sideToMove == Color::WHITE ? Color::BLACK : Color::WHITE;
+    Bitboard king = get_piece_bitboard(PieceType::KING, them);
+    if(king == 0) return false;
+
+    //The rook of a castle and the pawn taken en passant move or vanish off the from/to squares
+    if(move.is_castling || move.is_enpassant){
+        Position child = *this;
+        child.apply_move(move);
+        return child.checkers() != 0;
+    }
+
+    int king_square = std::countr_zero(king);
+    Bitboard to = 1ULL << move.to_square;
+
+    //A promoted slider can see the king through the square the pawn left
+    if(move.promoted_piece != Piece::NONE){
+        Bitboard occupied = occupancy ^ (1ULL << move.from_square);
+        Bitboard attacks = 0;
+        switch(typeOf(move.promoted_piece)){
+            case PieceType::KNIGHT: attacks = knight_moves[move.to_square]; break;
+            case PieceType::BISHOP: attacks = get_bishop_attacks(move.to_square, occupied); break;
+            case PieceType::ROOK:   attacks = get_rook_attacks(move.to_square, occupied); break;
+            default:                attacks = get_queen_attacks(move.to_square, occupied); break;
+        }
+        if((attacks & king) != 0) return true;
+    } else if((check_squares(typeOf(static_cast<Piece>(move.piece))) & to) != 0){
+        return true;
+    }
+
+    //Stepping off the line between our slider and their king uncovers it
+    return (discoverers() & (1ULL << move.from_square)) != 0 && (line_masks[king_square][move.from_square] & to) == 0;
 }
 
-void Board::update_color_bitboard()
+bool Position::is_legal(const Move& move) const
+{
+    Color us = sideToMove;
+    Color them = us == Color::WHITE ? Color::BLACK : Color::WHITE;
+
+    //Castling already checked every square the king crosses
+    if(move.is_castling) return true;
+
+    if(typeOf(static_cast<Piece>(move.piece)) == PieceType::KING){
+        return (attacked_squares(them) & (1ULL << move.to_square)) == 0;
+    }
+
+    //En passant removes a second piece from the rank, so only playing it tells whether the king is exposed
+    if(move.is_enpassant){
+        Position child = *this;
+        child.apply_move(move);
+        return !child.is_in_check(us);
+    }
+
+    int king = get_king_square(us);
+    Bitboard from = 1ULL << move.from_square, to = 1ULL << move.to_square;
+    Bitboard checking = checkers();
+
+    //A pinned piece may only slide along the pin, and that never answers a check
+    if((pinned() & from) != 0) return checking == 0 && (line_masks[king][move.from_square] & to) != 0;
+
+    //Otherwise it has to capture a lone checker or block its line
+    if(checking == 0) return true;
+    if(std::popcount(checking) > 1) return false;
+    return ((checking | between_masks[king][std::countr_zero(checking)]) & to) != 0;
+}
+
+void Position::update_color_bitboard()
 {
     white_occupancy = bitboard_array[W_PAWN] | bitboard_array[W_KNIGHT] | bitboard_array[W_BISHOP] 
     | bitboard_array[W_ROOK] | bitboard_array[W_QUEEN] | bitboard_array[W_KING];
 
     black_occupancy =  bitboard_array[B_PAWN] | bitboard_array[B_KNIGHT] | bitboard_array[B_BISHOP] 
     | bitboard_array[B_ROOK] | bitboard_array[B_QUEEN] | bitboard_array[B_KING];
+
+    occupancy = white_occupancy | black_occupancy;
 }
 
-std::string Board::getFen()
+//A piece leaving or entering squares flips the same bits in its color's occupancy and the total
+template<Color C>
+void Position::toggle_occupancy(Bitboard mask)
+{
+    if constexpr (C == Color::WHITE) white_occupancy ^= mask;
+    else black_occupancy ^= mask;
+    occupancy ^= mask;
+}
+
+std::string Position::getFen() const
 {
     std::array<std::string,6> parts;
 
@@ -320,7 +605,7 @@ std::string Board::getFen()
     if (parts[2].empty()) parts[2] = "-";
 
     // ---------- 4. En passant ----------
-    parts[3] = enPassantSquare.has_value() ? index_to_square(enPassantSquare.value()) : "-";
+    parts[3] = enPassantSquare != NO_SQUARE ? index_to_square(enPassantSquare) : "-";
 
     // ---------- 5. Halfmove clock ----------
     parts[4] = std::to_string(half_move_clock);
@@ -338,12 +623,93 @@ std::string Board::getFen()
     return fen.str();
 }
 
-int32_t Board::get_pst_color(Color color) const
+int32_t Position::get_pst_color(Color color) const
+{
+    return get_tapered_pst(pst_mg[static_cast<int>(color)], pst_eg[static_cast<int>(color)]);
+}
+
+int32_t Position::get_tapered_pst(int mg, int eg) const
 {
-    return pst_colors[static_cast<int>(color)];
+    int phase = std::min(game_phase, MAX_GAME_PHASE);
+    return (mg * phase + eg * (MAX_GAME_PHASE - phase)) / MAX_GAME_PHASE;
 }
 
-std::string Board::generate_piece_placement_fen()
+bool Board::is_repetition(int times) const
+{
+    //move_history[i].zobrist_key is the key before move i, positions with the same side to move are two plies apart
+    int limit = std::min(half_move_clock, history_ply);
+    int found = 0;
+
+    for(int back = 2; back <= limit; back += 2){
+        if(move_history[history_ply - back].zobrist_key == zobrist_key && ++found >= times){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Position::is_repetition(const Position *history, int count, int times) const
+{
+    int limit = std::min(half_move_clock, count);
+    int found = 0;
+
+    for(int back = 2; back <= limit; back += 2){
+        if(history[count - back].zobrist_key == zobrist_key && ++found >= times){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Position::is_insufficient_material() const
+{
+    Bitboard mating_material = bitboard_array[W_PAWN] | bitboard_array[B_PAWN] | bitboard_array[W_ROOK]
+                             | bitboard_array[B_ROOK] | bitboard_array[W_QUEEN] | bitboard_array[B_QUEEN];
+    Bitboard minors = bitboard_array[W_KNIGHT] | bitboard_array[B_KNIGHT] | bitboard_array[W_BISHOP] | bitboard_array[B_BISHOP];
+
+    return mating_material == 0 && std::popcount(minors) <= 1;
+}
+
+bool Board::is_draw() const
+{
+    return half_move_clock >= 100 || is_repetition(2) || is_insufficient_material();
+}
+
+uint64_t Position::compute_zobrist_key() const
+{
+    uint64_t key = 0ULL;
+
+    for(int i = W_PAWN; i < NONE; i++){
+        Bitboard piece_board = bitboard_array[i];
+
+        while(piece_board != 0){
+            key ^= zobrist_pieces[i][pop_lsb(piece_board)];
+        }
+    }
+
+    key ^= zobrist_castling[castlingRightsState];
+    if(enPassantSquare != NO_SQUARE) key ^= zobrist_en_passant[enPassantSquare % 8];
+    if(sideToMove == Color::BLACK) key ^= zobrist_side;
+
+    return key;
+}
+
+uint64_t Position::compute_pawn_key() const
+{
+    uint64_t key = 0ULL;
+
+    for(int i : {W_PAWN, B_PAWN}){
+        Bitboard piece_board = bitboard_array[i];
+
+        while(piece_board != 0){
+            key ^= zobrist_pieces[i][pop_lsb(piece_board)];
+        }
+    }
+
+    return key;
+}
+
+std::string Position::generate_piece_placement_fen() const
 {
     std::ostringstream buffer;
 
@@ -375,7 +741,7 @@ std::string Board::generate_piece_placement_fen()
     return buffer.str();
 }
 
-std::string Board::index_to_square(int index)
+std::string Position::index_to_square(int index) const
 {
     int rank = index / 8;       // integer division
     int file = index % 8;
@@ -386,36 +752,35 @@ std::string Board::index_to_square(int index)
     return std::string() + fileChar + rankChar;
 }
 
-void Board::init_pst_tables()
+void Position::init_pst_tables()
 {
-    int w_pst = 0;
-    int b_pst = 0;
+    pst_mg = {0, 0};
+    pst_eg = {0, 0};
+    game_phase = 0;
 
-    //Iterate over white pieces
-    for(int i = W_PAWN; i < B_PAWN; i++){
+    for(int i = W_PAWN; i < NONE; i++){
         Bitboard piece_board = bitboard_array[i];
 
         while(piece_board != 0){
-            int square = pop_lsb(piece_board);
-            w_pst += piece_square_table[i][flip_array[square]];
+            update_pst(static_cast<Piece>(i), pop_lsb(piece_board), 1);
         }
     }
+}
 
-    //Iterate over Black pieces
-    for(int i = B_PAWN; i < NONE; i++){
-        Bitboard piece_board = bitboard_array[i];
+void Position::update_pst(Piece piece, int square, int sign)
+{
+    Color color = colorOf(piece);
+    int type = static_cast<int>(typeOf(piece));
 
-        while(piece_board != 0){
-            int square = pop_lsb(piece_board);
-            b_pst += piece_square_table[i-B_PAWN][square];
-        }
-    }
+    //Tables are written from whites point of view with rank 8 on top
+    square = color == Color::WHITE ? flip_array[square] : square;
 
-    pst_colors[static_cast<int>(Color::WHITE)] = w_pst;
-    pst_colors[static_cast<int>(Color::BLACK)] = b_pst;
+    pst_mg[static_cast<int>(color)] += sign * piece_square_table[type][square];
+    pst_eg[static_cast<int>(color)] += sign * piece_square_table_eg[type][square];
+    game_phase += sign * phase_weights[type];
 }
 
-void Board::print_board(std::ostream& os) const {
+void Position::print_board(std::ostream& os) const {
     for(int rank = 7; rank >=0; rank--){
         for(int file = 0; file <= 7; file++){
             int square = rank * 8 + file;
@@ -438,19 +803,19 @@ void Board::print_board(std::ostream& os) const {
     }
 }
 
-void Board::remove_castling_right(CastlingRights right) {
+void Position::remove_castling_right(CastlingRights right) {
     castlingRightsState &= ~static_cast<uint8_t>(right);
 }
 
-void Board::remove_all_castling_rights_white() {
+void Position::remove_all_castling_rights_white() {
     remove_castling_right(CastlingRights::WHITE_ALL);
 }
 
-void Board::remove_all_castling_rights_black(){
+void Position::remove_all_castling_rights_black(){
     remove_castling_right(CastlingRights::BLACK_ALL);
 }
 
-void Board::parse_piece_placement(const std::string& positions) {
+void Position::parse_piece_placement(const std::string& positions) {
     //Clear all bitboards
     for(int i = 0; i < 12; i++){
         bitboard_array[i] = 0;
@@ -480,37 +845,42 @@ void Board::parse_piece_placement(const std::string& positions) {
     }
 }
 
-void Board::set_castling_rights(uint8_t& newCastlingRights){
+void Position::set_castling_rights(uint8_t& newCastlingRights){
     this->castlingRightsState = newCastlingRights;
 }
 
-void Board::undo_rook_castle(Color color, int start, int end) {
-    if(color == Color::WHITE){
-        bitboard_array[W_ROOK] &= ~(1ULL << end);
-        bitboard_array[W_ROOK] |= (1ULL << start);
-    } else {
-        bitboard_array[B_ROOK] &= ~(1ULL << end);
-        bitboard_array[B_ROOK] |= (1ULL << start);
-    }
+template<Color Us>
+void Position::undo_rook_castle(int start, int end) {
+    constexpr Piece rook = Us == Color::WHITE ? Piece::W_ROOK : Piece::B_ROOK;
+
+    bitboard_array[rook] &= ~(1ULL << end);
+    bitboard_array[rook] |= (1ULL << start);
+    toggle_occupancy<Us>((1ULL << start) | (1ULL << end));
 }
 
-void Board::remove_captured_piece(int square, Piece capturedPiece)
+//Owner is the color of the captured piece
+template<Color Owner>
+void Position::remove_captured_piece(int square, Piece capturedPiece)
 {
-    bitboard_array[capturedPiece] &= ~(1ULL << square);
-    if(capturedPiece == Piece::W_ROOK && square == 7) remove_castling_right(CastlingRights::WHITE_KINGSIDE);
-    if(capturedPiece == Piece::W_ROOK && square == 0) remove_castling_right(CastlingRights::WHITE_QUEENSIDE);
-    if(capturedPiece == Piece::B_ROOK && square == 56) remove_castling_right(CastlingRights::BLACK_QUEENSIDE);
-    if(capturedPiece == Piece::B_ROOK && square == 63) remove_castling_right(CastlingRights::BLACK_KINGSIDE);
+    constexpr Piece pawn = Owner == Color::WHITE ? Piece::W_PAWN : Piece::B_PAWN;
+    constexpr Piece rook = Owner == Color::WHITE ? Piece::W_ROOK : Piece::B_ROOK;
+    constexpr int home = Owner == Color::WHITE ? 0 : 56;
 
-    //Update PST
-    Color color = colorOf(capturedPiece);
-    square = color == Color::WHITE ? flip_array[square] : square;
+    bitboard_array[capturedPiece] &= ~(1ULL << square);
+    toggle_occupancy<Owner>(1ULL << square);
+    zobrist_key ^= zobrist_pieces[capturedPiece][square];
+    if(capturedPiece == pawn) pawn_key ^= zobrist_pieces[capturedPiece][square];
+    if(capturedPiece == rook && square == home + 7) remove_castling_right(Owner == Color::WHITE ? CastlingRights::WHITE_KINGSIDE : CastlingRights::BLACK_KINGSIDE);
+    if(capturedPiece == rook && square == home) remove_castling_right(Owner == Color::WHITE ? CastlingRights::WHITE_QUEENSIDE : CastlingRights::BLACK_QUEENSIDE);
 
-    pst_colors[static_cast<int>(color)] -= piece_square_table[static_cast<int>(typeOf(capturedPiece))][square];
+    update_pst(capturedPiece, square, -1);
 }
 
-void Board::castle_move(Move &king_move)
+template<Color Us>
+void Position::castle_move(const Move &king_move)
 {
+    constexpr Piece rookPiece = Us == Color::WHITE ? Piece::W_ROOK : Piece::B_ROOK;
+
     int rookStart, rookEnd;
     if(king_move.to_square - king_move.from_square == 2){
         //Kingside
@@ -525,22 +895,23 @@ void Board::castle_move(Move &king_move)
         throw std::invalid_argument("Invalid castling move");
     }
 
-    // Determine which rook piece
-    Piece rookPiece = colorOf(static_cast<Piece>(king_move.piece)) == Color::WHITE ? Piece::W_ROOK : Piece::B_ROOK;
-
     // Move the rook on the bitboard
     bitboard_array[rookPiece] &= ~(1ULL << rookStart); //remove from start
     bitboard_array[rookPiece] |= (1ULL << rookEnd); //add to end
+    toggle_occupancy<Us>((1ULL << rookStart) | (1ULL << rookEnd));
+
+    zobrist_key ^= zobrist_pieces[rookPiece][rookStart] ^ zobrist_pieces[rookPiece][rookEnd];
+    update_pst(rookPiece, rookStart, -1);
+    update_pst(rookPiece, rookEnd, 1);
 }
 
-bool Board::is_square_attacked(int target, Color attacking_color) const
+bool Position::is_square_attacked(int target, Color attacking_color) const
 {
+    CHESS_STAT_INC(square_attacked_calls);
+
     if(target < 0 || target > 63) std::cerr << "is_square_atatcked: Target must be between 0 and 63" << std::endl;
 
-    Bitboard occupied = 0;
-    for(int i = 0; i < 12; i++){
-        occupied |= bitboard_array[i];
-    }
+    Bitboard occupied = occupancy;
 
     //Pawns
     if(attacking_color == Color::WHITE){
@@ -588,7 +959,7 @@ bool Board::is_square_attacked(int target, Color attacking_color) const
     return false;
 }
 
-int Board::get_king_square(Color color)
+int Position::get_king_square(Color color) const
 {
     if(color == Color::WHITE){
       return std::countr_zero(bitboard_array[W_KING]);
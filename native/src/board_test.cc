@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <board.h>
+#include <utils.h>
+#include <random>
 
 class BoardTestFixture : public ::testing::Test {
     protected:
@@ -62,7 +64,7 @@ R N B Q K B . R
     EXPECT_EQ(Color::BLACK, board.sideToMove);
     EXPECT_EQ(1, board.half_move_clock);
     EXPECT_EQ(2, board.num_moves_total);
-    EXPECT_EQ(std::nullopt, board.enPassantSquare);
+    EXPECT_EQ(NO_SQUARE, board.enPassantSquare);
     EXPECT_EQ(board.getFen(),"rnbqkbnr/pp1ppppp/8/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2" );
 }
 
@@ -88,8 +90,15 @@ R N B Q K B N R
     EXPECT_EQ(Color::WHITE, board.sideToMove);
     EXPECT_EQ(0, board.half_move_clock);
     EXPECT_EQ(2, board.num_moves_total);
-    EXPECT_EQ(board.C6, board.enPassantSquare);  
-    EXPECT_EQ(board.getFen(), "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2");
+    // No white pawn can take on c6, so the square is dropped
+    EXPECT_EQ(NO_SQUARE, board.enPassantSquare);  
+    EXPECT_EQ(board.getFen(), "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+
+    board.set_position_fen("rnbqkbnr/pp1ppppp/8/2p1P3/8/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 3");
+    EXPECT_EQ(NO_SQUARE, board.enPassantSquare) << "e5 is not next to c5";
+    board.set_position_fen("rnbqkbnr/pp1ppppp/8/1Pp5/8/8/P1PPPPPP/RNBQKBNR w KQkq c6 0 3");
+    EXPECT_EQ(board.C6, board.enPassantSquare);
+    EXPECT_EQ(board.getFen(), "rnbqkbnr/pp1ppppp/8/1Pp5/8/8/P1PPPPPP/RNBQKBNR w KQkq c6 0 3");
 }
 
 TEST_F(BoardTestFixture, CastlingRights){
@@ -153,15 +162,15 @@ TEST_F(BoardTestFixture, DoublePawnPushAndUndo) {
     
     board.make_move(pawnE2E4);
 
-    // Verify state change: En Passant must be set to E3 (square 20)
-    EXPECT_EQ(board.E3, board.enPassantSquare); 
+    // Verify state change: no black pawn can reach E3, so En Passant stays unset
+    EXPECT_EQ(NO_SQUARE, board.enPassantSquare); 
     EXPECT_EQ(Color::BLACK, board.sideToMove); // Side to move must flip
 
     // Undo move
     board.undo_move();
 
     // Verify board and state are completely restored
-    EXPECT_EQ(std::nullopt, board.enPassantSquare); // En passant reset
+    EXPECT_EQ(NO_SQUARE, board.enPassantSquare); // En passant reset
     EXPECT_EQ(Color::WHITE, board.sideToMove);     // Side to move reset
 
     // Check board state via print
@@ -448,3 +457,335 @@ TEST_F(BoardTestFixture, KingsAdjacentBothInCheck) {
 }
 
 
+
+TEST_F(BoardTestFixture, ZobristKeyRestoredAfterUndo) {
+    board = Board();
+    board.set_position_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    const uint64_t original = board.zobrist_key;
+
+    Move castle = {Piece::W_KING, 4, 6, Piece::NONE, Piece::NONE, false, true};
+    board.make_move(castle);
+    EXPECT_NE(original, board.zobrist_key);
+    EXPECT_EQ(board.compute_zobrist_key(), board.zobrist_key);
+
+    Move capture = {Piece::B_BISHOP, 40, 12, Piece::W_BISHOP, Piece::NONE, false, false};
+    board.make_move(capture);
+    EXPECT_EQ(board.compute_zobrist_key(), board.zobrist_key);
+
+    board.undo_move();
+    board.undo_move();
+    EXPECT_EQ(original, board.zobrist_key);
+}
+
+TEST_F(BoardTestFixture, ZobristKeyMatchesAfterTransposition) {
+    // 1.Nf3 Nf6 2.Nc3 and 1.Nc3 Nf6 2.Nf3 reach the same position
+    Board first = Board();
+    Move nf3 = {Piece::W_KNIGHT, 6, 21, Piece::NONE, Piece::NONE, false, false};
+    Move nf6 = {Piece::B_KNIGHT, 62, 45, Piece::NONE, Piece::NONE, false, false};
+    Move nc3 = {Piece::W_KNIGHT, 1, 18, Piece::NONE, Piece::NONE, false, false};
+    first.make_move(nf3);
+    first.make_move(nf6);
+    first.make_move(nc3);
+
+    Board second = Board();
+    second.make_move(nc3);
+    second.make_move(nf6);
+    second.make_move(nf3);
+
+    EXPECT_EQ(first.zobrist_key, second.zobrist_key);
+
+    second.set_position_fen(first.getFen());
+    EXPECT_EQ(first.zobrist_key, second.zobrist_key);
+}
+
+TEST_F(BoardTestFixture, GamePhaseTracksMaterial) {
+    board = Board();
+    EXPECT_EQ(MAX_GAME_PHASE, board.game_phase);
+
+    // Only kings and pawns left
+    board.set_position_fen("4k3/pppppppp/8/8/8/8/PPPPPPPP/4K3 w - - 0 1");
+    EXPECT_EQ(0, board.game_phase);
+
+    // Rook takes queen: phase drops by the queen's weight, undo restores it
+    board.set_position_fen("3qk3/8/8/8/8/8/8/3RK3 w - - 0 1");
+    EXPECT_EQ(6, board.game_phase);
+    Move rxd8 = {Piece::W_ROOK, 3, 59, Piece::B_QUEEN, Piece::NONE, false, false};
+    board.make_move(rxd8);
+    EXPECT_EQ(2, board.game_phase);
+    board.undo_move();
+    EXPECT_EQ(6, board.game_phase);
+}
+
+TEST_F(BoardTestFixture, IncrementalPstMatchesRecompute) {
+    board = Board();
+    board.set_position_fen("r3k2r/1P6/8/8/8/8/8/R3K2R w KQkq - 0 1");
+
+    // Promotion with capture, then castling
+    Move promo = {Piece::W_PAWN, 49, 56, Piece::B_ROOK, Piece::W_QUEEN, false, false};
+    board.make_move(promo);
+    Move castle = {Piece::B_KING, 60, 62, Piece::NONE, Piece::NONE, false, true};
+    board.make_move(castle);
+
+    Board fresh = Board();
+    fresh.set_position_fen(board.getFen());
+
+    EXPECT_EQ(fresh.pst_mg, board.pst_mg);
+    EXPECT_EQ(fresh.pst_eg, board.pst_eg);
+    EXPECT_EQ(fresh.game_phase, board.game_phase);
+}
+
+TEST_F(BoardTestFixture, MoveCountersFollowMakeAndUndo) {
+    board = Board();
+    board.set_position_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+    Move knight_out = {Piece::W_KNIGHT, 6, 21, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(knight_out);
+    EXPECT_EQ(1, board.half_move_clock);
+    EXPECT_EQ(1, board.num_moves_total);
+
+    Move pawn_push = {Piece::B_PAWN, 52, 36, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(pawn_push);
+    EXPECT_EQ(0, board.half_move_clock);
+    EXPECT_EQ(2, board.num_moves_total);
+
+    Move knight_capture = {Piece::W_KNIGHT, 21, 36, Piece::B_PAWN, Piece::NONE, false, false};
+    board.make_move(knight_capture);
+    EXPECT_EQ(0, board.half_move_clock);
+    EXPECT_EQ(board.getFen(), "rnbqkbnr/pppp1ppp/8/4N3/8/8/PPPPPPPP/RNBQKB1R b KQkq - 0 2");
+
+    board.undo_move();
+    board.undo_move();
+    board.undo_move();
+    EXPECT_EQ(board.getFen(), "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+}
+
+TEST_F(BoardTestFixture, RepetitionDetection) {
+    board = Board();
+    board.set_position_fen("4k3/8/8/8/8/8/4P3/4K1N1 w - - 0 1");
+
+    Move out = {Piece::W_KNIGHT, 6, 21, Piece::NONE, Piece::NONE, false, false};
+    Move back = {Piece::W_KNIGHT, 21, 6, Piece::NONE, Piece::NONE, false, false};
+    Move king_out = {Piece::B_KING, 60, 59, Piece::NONE, Piece::NONE, false, false};
+    Move king_back = {Piece::B_KING, 59, 60, Piece::NONE, Piece::NONE, false, false};
+
+    EXPECT_FALSE(board.is_repetition());
+    for(int cycle = 1; cycle <= 2; cycle++){
+        board.make_move(out);
+        board.make_move(king_out);
+        board.make_move(back);
+        board.make_move(king_back);
+        EXPECT_TRUE(board.is_repetition(cycle));
+        EXPECT_FALSE(board.is_repetition(cycle + 1));
+    }
+    EXPECT_TRUE(board.is_draw()) << "Third occurrence of the starting position";
+
+    // A pawn move can never be undone, so positions before it are not scanned
+    Move pawn_push = {Piece::W_PAWN, 12, 20, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(pawn_push);
+    EXPECT_FALSE(board.is_repetition());
+    EXPECT_FALSE(board.is_draw());
+
+    board.undo_move();
+    EXPECT_TRUE(board.is_draw());
+
+    // Setting a new position forgets the old game
+    board.set_position_fen("4k3/8/8/8/8/8/4P3/4K1N1 w - - 0 1");
+    EXPECT_FALSE(board.is_repetition());
+}
+
+TEST_F(BoardTestFixture, EnPassantOnlySetWhenCapturable) {
+    board = Board();
+    board.set_position_fen("4k3/8/8/8/3p4/8/4P1P1/4K3 w - - 0 1");
+    uint64_t key_before = board.zobrist_key;
+
+    // g2g4 has no black pawn beside it, e2e4 lands next to d4
+    Move g2g4 = {Piece::W_PAWN, 14, 30, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(g2g4);
+    EXPECT_EQ(NO_SQUARE, board.enPassantSquare);
+    EXPECT_EQ(board.zobrist_key, board.compute_zobrist_key());
+    board.undo_move();
+    EXPECT_EQ(key_before, board.zobrist_key);
+
+    Move e2e4 = {Piece::W_PAWN, 12, 28, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(e2e4);
+    EXPECT_EQ(board.E3, board.enPassantSquare);
+    EXPECT_EQ(board.getFen(), "4k3/8/8/8/3pP3/8/6P1/4K3 b - e3 0 1");
+    EXPECT_EQ(board.zobrist_key, board.compute_zobrist_key());
+
+    board.undo_move();
+    EXPECT_EQ(NO_SQUARE, board.enPassantSquare);
+    EXPECT_EQ(key_before, board.zobrist_key);
+}
+
+TEST_F(BoardTestFixture, CopyMakeMatchesMakeMove) {
+    board = Board();
+    board.set_position_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Position position = board.get_position();
+
+    Move moves[] = {
+        {Piece::W_PAWN, 10, 26, Piece::NONE, Piece::NONE, false, false},    // c2c4, double push next to b4
+        {Piece::B_PAWN, 25, 18, Piece::W_PAWN, Piece::NONE, true, false},   // b4xc3 en passant
+        {Piece::W_KING, 4, 6, Piece::NONE, Piece::NONE, false, true},       // O-O
+        {Piece::B_PAWN, 18, 9, Piece::W_PAWN, Piece::NONE, false, false},   // c3xb2
+        {Piece::W_KNIGHT, 36, 53, Piece::B_PAWN, Piece::NONE, false, false},// Nxf7
+        {Piece::B_PAWN, 9, 0, Piece::W_ROOK, Piece::B_QUEEN, false, false}, // bxa1=Q
+    };
+
+    for(Move& move : moves){
+        Position parent = position;
+        position.apply_move(move);
+        board.make_move(move);
+
+        EXPECT_EQ(position.getFen(), board.getFen());
+        EXPECT_EQ(position.zobrist_key, board.zobrist_key);
+        EXPECT_EQ(position.pawn_key, board.pawn_key);
+        EXPECT_EQ(position.zobrist_key, position.compute_zobrist_key());
+
+        // The parent copy is untouched, which is all copy-make needs to "undo"
+        EXPECT_NE(parent.getFen(), position.getFen());
+    }
+}
+
+TEST_F(BoardTestFixture, RepetitionWithExternalHistory) {
+    Position history[8];
+    Position position;
+    position.set_position_fen("4k3/8/8/8/8/8/4P3/4K1N1 w - - 0 1");
+
+    Move cycle[] = {
+        {Piece::W_KNIGHT, 6, 21, Piece::NONE, Piece::NONE, false, false},
+        {Piece::B_KING, 60, 59, Piece::NONE, Piece::NONE, false, false},
+        {Piece::W_KNIGHT, 21, 6, Piece::NONE, Piece::NONE, false, false},
+        {Piece::B_KING, 59, 60, Piece::NONE, Piece::NONE, false, false},
+    };
+
+    int count = 0;
+    for(Move& move : cycle){
+        history[count++] = position;
+        position.apply_move(move);
+    }
+
+    EXPECT_TRUE(position.is_repetition(history, count));
+    EXPECT_FALSE(position.is_repetition(history, count, 2));
+    EXPECT_FALSE(position.is_repetition(history, 0)) << "Nothing to compare against without a history";
+}
+
+TEST_F(BoardTestFixture, FiftyMoveRuleAndInsufficientMaterial) {
+    board = Board();
+    board.set_position_fen("4k3/8/8/8/8/8/4P3/4K1N1 w - - 99 80");
+    EXPECT_FALSE(board.is_draw());
+
+    Move out = {Piece::W_KNIGHT, 6, 21, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(out);
+    EXPECT_EQ(100, board.half_move_clock);
+    EXPECT_TRUE(board.is_draw());
+
+    board.set_position_fen("4k3/8/8/8/8/8/8/4K1N1 w - - 0 1");
+    EXPECT_TRUE(board.is_insufficient_material());
+    board.set_position_fen("4k3/8/8/8/8/8/8/2B1K1N1 w - - 0 1");
+    EXPECT_FALSE(board.is_insufficient_material());
+    board.set_position_fen("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+    EXPECT_FALSE(board.is_insufficient_material());
+}
+
+// The tables are built by the compiler, so their generators have to work in constant expressions
+static_assert(compute_knight_attacks(Position::A1) == ((1ULL << Position::B3) | (1ULL << Position::C2)));
+static_assert(compute_king_attacks(Position::H8) == ((1ULL << Position::G8) | (1ULL << Position::G7) | (1ULL << Position::H7)));
+static_assert(compute_pawn_attacks(Position::E4, Color::BLACK) == ((1ULL << Position::D3) | (1ULL << Position::F3)));
+static_assert(square_distance(Position::A1, Position::H8) == 7);
+
+TEST(UtilsTest, AttackTablesCoverTheBoard) {
+    int knight = 0, king = 0, white_pawn = 0, black_pawn = 0;
+    for(int square = 0; square < 64; square++){
+        knight += std::popcount(knight_moves[square]);
+        king += std::popcount(king_moves[square]);
+        white_pawn += std::popcount(pawn_attacks[square]);
+        black_pawn += std::popcount(pawn_attacks[64 + square]);
+    }
+
+    EXPECT_EQ(knight, 336);
+    EXPECT_EQ(king, 420);
+    EXPECT_EQ(white_pawn, 98);
+    EXPECT_EQ(black_pawn, 98);
+    EXPECT_EQ(zobrist_castling[0], 0ULL);
+    EXPECT_NE(zobrist_side, 0ULL);
+}
+
+TEST(UtilsTest, SliderAttackMapMatchesSquareAttacks) {
+    std::mt19937_64 rng(42);
+    for(int trial = 0; trial < 500; trial++){
+        Bitboard occupied = rng() & rng();
+        Bitboard rooks = occupied & rng() & rng();
+        Bitboard bishops = occupied & rng() & rng();
+
+        Bitboard expected = 0;
+        for(Bitboard set = rooks; set; set &= set - 1) expected |= get_rook_attacks(std::countr_zero(set), occupied);
+        for(Bitboard set = bishops; set; set &= set - 1) expected |= get_bishop_attacks(std::countr_zero(set), occupied);
+        ASSERT_EQ(slider_attack_map(rooks, bishops, occupied), expected) << "trial " << trial;
+
+        Bitboard knights = rng() & rng(), kings = rng() & rng() & rng(), pawns = rng() & 0x00FFFFFFFFFFFF00ULL;
+        Bitboard knight = 0, king = 0, white_pawn = 0, black_pawn = 0;
+        for(Bitboard set = knights; set; set &= set - 1) knight |= knight_moves[std::countr_zero(set)];
+        for(Bitboard set = kings; set; set &= set - 1) king |= king_moves[std::countr_zero(set)];
+        for(Bitboard set = pawns; set; set &= set - 1){
+            white_pawn |= pawn_attacks[std::countr_zero(set)];
+            black_pawn |= pawn_attacks[64 + std::countr_zero(set)];
+        }
+        ASSERT_EQ(knight_attack_map(knights), knight);
+        ASSERT_EQ(king_attack_map(kings), king);
+        ASSERT_EQ(pawn_attack_map(pawns, Color::WHITE), white_pawn);
+        ASSERT_EQ(pawn_attack_map(pawns, Color::BLACK), black_pawn);
+    }
+}
+
+TEST(BoardTest, AttackMapMatchesIsSquareAttacked) {
+    const char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    };
+
+    Board board;
+    for(const char* fen : fens){
+        board.set_position_fen(fen);
+        for(Color color : {Color::WHITE, Color::BLACK}){
+            Bitboard expected = 0;
+            for(int square = 0; square < 64; square++){
+                if(board.is_square_attacked(square, color)) expected |= 1ULL << square;
+            }
+            EXPECT_EQ(board.attack_map(color), expected) << fen;
+        }
+    }
+}
+
+TEST(BoardTest, CachedCheckersAndPins) {
+    Board board;
+
+    //The bishop pins the knight on d2 and the rook pins the e2 pawn
+    board.set_position_fen("4k3/8/8/8/1b2r3/8/3NP3/4K3 w - - 0 1");
+    EXPECT_EQ(board.checkers(), 0ULL);
+    EXPECT_EQ(board.pinned(), (1ULL << Position::D2) | (1ULL << Position::E2));
+
+    board.set_position_fen("4k3/8/8/8/1b6/8/8/4K2r w - - 0 1");
+    EXPECT_EQ(board.checkers(), (1ULL << Position::B4) | (1ULL << Position::H1));
+    EXPECT_TRUE(board.is_in_check(Color::WHITE));
+
+    //The king is lifted off the board, so the square behind it on the rook's line counts as attacked
+    EXPECT_NE(board.attacked_squares(Color::BLACK) & (1ULL << Position::D1), 0ULL);
+    EXPECT_EQ(board.attack_map(Color::BLACK) & (1ULL << Position::D1), 0ULL);
+}
+
+TEST(BoardTest, AttackCacheFollowsMakeAndUndo) {
+    Board board;
+    board.set_position_fen("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+    Bitboard before = board.attacked_squares(Color::WHITE);
+
+    Move check{Piece::W_ROOK, Position::A1, Position::A8, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(check);
+    EXPECT_EQ(board.checkers(), 1ULL << Position::A8);
+    EXPECT_NE(board.attacked_squares(Color::WHITE), before);
+
+    board.undo_move();
+    EXPECT_EQ(board.checkers(), 0ULL);
+    EXPECT_EQ(board.attacked_squares(Color::WHITE), before);
+}
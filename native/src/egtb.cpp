@@ -0,0 +1,884 @@
+#include "egtb.h"
+#include "mapped_file.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+    constexpr std::array<char, 4> MAGIC = {'D', 'C', 'T', 'B'};
+    constexpr size_t HEADER_SIZE = 40;
+
+    //WDL codes in the files
+    constexpr uint8_t DRAW = 0;
+    constexpr uint8_t WIN = 1;
+    constexpr uint8_t LOSS = 2;
+    constexpr uint8_t ILLEGAL = 3;
+
+    //Extra states while generating: UNKNOWN may still turn out lost, ESCAPE has a drawing capture or
+    //promotion so it cannot, DECIDED_DRAW is stalemate or a position whose every move converts to a draw or worse
+    constexpr uint8_t UNKNOWN = 4;
+    constexpr uint8_t ESCAPE = 5;
+    constexpr uint8_t DECIDED_DRAW = 6;
+
+    constexpr int MOVES_LIMIT = 255;
+
+    //Signature order, queens first and pawns last, indexed by PieceType
+    constexpr std::array<int, 6> SIGNATURE_RANK = {4, 3, 2, 1, 0, 5};
+    constexpr std::array<int, 6> PIECE_VALUE = {1, 3, 3, 5, 9, 0};
+    constexpr std::array<char, 6> PIECE_LETTER = {'P', 'N', 'B', 'R', 'Q', 'K'};
+
+    Color opposite(Color color) {
+        return color == Color::WHITE ? Color::BLACK : Color::WHITE;
+    }
+
+    Piece swap_color(Piece piece) {
+        return static_cast<Piece>(colorOf(piece) == Color::WHITE ? piece + 6 : piece - 6);
+    }
+
+    bool signature_before(Piece a, Piece b) {
+        if(colorOf(a) != colorOf(b)) return colorOf(a) == Color::WHITE;
+        return SIGNATURE_RANK[static_cast<int>(typeOf(a))] < SIGNATURE_RANK[static_cast<int>(typeOf(b))];
+    }
+
+    //Tables keep the stronger side as white: more material, then the stronger pieces
+    bool black_is_stronger(const std::vector<Piece>& sorted) {
+        int white_value = 0, black_value = 0;
+        std::vector<int> white_ranks, black_ranks;
+        for(Piece piece : sorted){
+            int type = static_cast<int>(typeOf(piece));
+            if(colorOf(piece) == Color::WHITE){
+                white_value += PIECE_VALUE[type];
+                white_ranks.push_back(SIGNATURE_RANK[type]);
+            } else {
+                black_value += PIECE_VALUE[type];
+                black_ranks.push_back(SIGNATURE_RANK[type]);
+            }
+        }
+        if(black_value != white_value) return black_value > white_value;
+        return black_ranks < white_ranks;
+    }
+
+    egtb::Material canonical_material(std::vector<Piece> pieces) {
+        std::sort(pieces.begin(), pieces.end(), signature_before);
+        if(black_is_stronger(pieces)){
+            for(Piece& piece : pieces) piece = swap_color(piece);
+            std::sort(pieces.begin(), pieces.end(), signature_before);
+        }
+        return egtb::Material{pieces};
+    }
+
+    /// @brief King placements left after symmetry, index is -1 for the rest and for touching kings
+    struct KingPairs {
+        std::vector<std::pair<uint8_t, uint8_t>> pairs;
+        std::array<int16_t, 64 * 64> index;
+    };
+
+    KingPairs build_king_pairs(bool pawns) {
+        KingPairs kings;
+        kings.index.fill(-1);
+
+        for(int white_king = 0; white_king < 64; white_king++){
+            int file = fileOf(white_king), rank = rankOf(white_king);
+            if(file > 3) continue;
+            if(!pawns && rank > file) continue;
+
+            for(int black_king = 0; black_king < 64; black_king++){
+                if(square_distance(white_king, black_king) <= 1) continue;
+                if(!pawns && rank == file && rankOf(black_king) > fileOf(black_king)) continue;
+
+                kings.index[white_king * 64 + black_king] = static_cast<int16_t>(kings.pairs.size());
+                kings.pairs.emplace_back(white_king, black_king);
+            }
+        }
+        return kings;
+    }
+
+    const KingPairs& king_pairs(bool pawns) {
+        static const KingPairs with_pawns = build_king_pairs(true);
+        static const KingPairs without_pawns = build_king_pairs(false);
+        return pawns ? with_pawns : without_pawns;
+    }
+
+    //Symmetries as flags: mirror the files, mirror the ranks, then swap files and ranks
+    int transform(int square, int symmetry) {
+        int file = fileOf(square), rank = rankOf(square);
+        if(symmetry & 1) file = 7 - file;
+        if(symmetry & 2) rank = 7 - rank;
+        if(symmetry & 4) std::swap(file, rank);
+        return rank * 8 + file;
+    }
+
+    //Pawns only allow the file mirror, without them the white king goes to a1-d1-d4 and a king on
+    //the long diagonal leaves the black king on or below it
+    int canonical_symmetry(int white_king, int black_king, bool pawns) {
+        int symmetry = fileOf(white_king) > 3 ? 1 : 0;
+        if(pawns) return symmetry;
+
+        if(rankOf(white_king) > 3) symmetry |= 2;
+        int king = transform(white_king, symmetry);
+        if(rankOf(king) > fileOf(king)){
+            symmetry |= 4;
+        } else if(rankOf(king) == fileOf(king)){
+            int other = transform(black_king, symmetry);
+            if(rankOf(other) > fileOf(other)) symmetry |= 4;
+        }
+        return symmetry;
+    }
+
+    Bitboard piece_attacks(PieceType type, int square, Bitboard occupied) {
+        switch(type){
+            case PieceType::KNIGHT: return knight_moves[square];
+            case PieceType::BISHOP: return get_bishop_attacks(square, occupied);
+            case PieceType::ROOK:   return get_rook_attacks(square, occupied);
+            case PieceType::QUEEN:  return get_queen_attacks(square, occupied);
+            case PieceType::KING:   return king_moves[square];
+            default:                return 0;
+        }
+    }
+
+    template<typename Work>
+    void parallel_for(uint64_t count, int threads, Work&& work) {
+        constexpr uint64_t CHUNK = 1 << 14;
+        std::atomic<uint64_t> next{0};
+
+        auto run = [&]{
+            while(true){
+                uint64_t begin = next.fetch_add(CHUNK);
+                if(begin >= count) return;
+                uint64_t end = std::min(count, begin + CHUNK);
+                for(uint64_t i = begin; i < end; i++) work(i);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for(int t = 1; t < threads; t++) workers.emplace_back(run);
+        run();
+        for(auto& worker : workers) worker.join();
+    }
+
+    uint8_t load(std::vector<uint8_t>& values, uint64_t index) {
+        return std::atomic_ref<uint8_t>(values[index]).load(std::memory_order_relaxed);
+    }
+
+    void store(std::vector<uint8_t>& values, uint64_t index, uint8_t value) {
+        std::atomic_ref<uint8_t>(values[index]).store(value, std::memory_order_relaxed);
+    }
+
+    void raise_to(std::atomic<int>& value, int candidate) {
+        int current = value.load();
+        while(current < candidate && !value.compare_exchange_weak(current, candidate)){}
+    }
+
+    //Plies from the position to mate, which orders the retrograde passes
+    int level_of(uint8_t state, uint8_t moves) {
+        if(state == WIN) return 2 * moves - 1;
+        if(state == LOSS) return 2 * moves;
+        return -1;
+    }
+
+    uint64_t read_little_endian(const unsigned char* bytes, int count) {
+        uint64_t value = 0;
+        for(int i = count - 1; i >= 0; i--){
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    void write_little_endian(std::ostream& out, uint64_t value, int count) {
+        for(int i = 0; i < count; i++){
+            out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+}
+
+namespace egtb {
+
+    bool Material::has_pawns() const {
+        return std::any_of(pieces.begin(), pieces.end(), [](Piece piece){ return typeOf(piece) == PieceType::PAWN; });
+    }
+
+    int Material::piece_count() const {
+        return static_cast<int>(pieces.size()) + 2;
+    }
+
+    std::string Material::name() const {
+        std::string white = "K", black = "K";
+        for(Piece piece : pieces){
+            char letter = PIECE_LETTER[static_cast<int>(typeOf(piece))];
+            if(colorOf(piece) == Color::WHITE) white += letter;
+            else black += letter;
+        }
+        return white + "v" + black;
+    }
+
+    bool parse_material(const std::string& name, Material& out) {
+        size_t split = name.find('v');
+        if(split == std::string::npos || name.find('v', split + 1) != std::string::npos) return false;
+
+        std::vector<Piece> pieces;
+        const std::string sides[2] = {name.substr(0, split), name.substr(split + 1)};
+        for(int side = 0; side < 2; side++){
+            if(sides[side].empty() || sides[side][0] != 'K') return false;
+
+            for(size_t i = 1; i < sides[side].size(); i++){
+                auto letter = std::find(PIECE_LETTER.begin(), PIECE_LETTER.end() - 1, sides[side][i]);
+                if(letter == PIECE_LETTER.end() - 1) return false;
+
+                int type = static_cast<int>(letter - PIECE_LETTER.begin());
+                pieces.push_back(static_cast<Piece>(type + 6 * side));
+            }
+        }
+
+        if(pieces.empty() || static_cast<int>(pieces.size()) + 2 > MAX_PIECES) return false;
+
+        out = canonical_material(pieces);
+        return true;
+    }
+
+    std::vector<Material> successors(const Material& material) {
+        std::vector<Material> result;
+        auto add = [&](std::vector<Piece> pieces){
+            if(pieces.empty()) return; //bare kings
+            Material next = canonical_material(std::move(pieces));
+            bool seen = std::any_of(result.begin(), result.end(), [&](const Material& m){ return m.name() == next.name(); });
+            if(!seen) result.push_back(next);
+        };
+
+        const std::vector<Piece>& pieces = material.pieces;
+        for(size_t i = 0; i < pieces.size(); i++){
+            std::vector<Piece> captured = pieces;
+            captured.erase(captured.begin() + i);
+            add(captured);
+
+            if(typeOf(pieces[i]) != PieceType::PAWN) continue;
+
+            Color color = colorOf(pieces[i]);
+            for(PieceType type : {PieceType::QUEEN, PieceType::ROOK, PieceType::BISHOP, PieceType::KNIGHT}){
+                Piece promoted = static_cast<Piece>(static_cast<int>(type) + (color == Color::WHITE ? 0 : 6));
+
+                std::vector<Piece> promotion = pieces;
+                promotion[i] = promoted;
+                add(promotion);
+
+                //Promoting with a capture
+                for(size_t j = 0; j < pieces.size(); j++){
+                    if(colorOf(pieces[j]) == color) continue;
+                    std::vector<Piece> both = promotion;
+                    both.erase(both.begin() + j);
+                    add(both);
+                }
+            }
+        }
+        return result;
+    }
+
+    /// @brief A position as piece squares, slots 0 and 1 hold the white and black king and the rest
+    /// follow the table's signature order until a capture or promotion changes the material
+    struct Setup {
+        std::array<Piece, MAX_PIECES> piece;
+        std::array<int8_t, MAX_PIECES> square;
+        int count;
+        Color side_to_move;
+
+        Bitboard occupancy(Color color) const {
+            Bitboard occupied = 0;
+            for(int slot = 0; slot < count; slot++){
+                if(colorOf(piece[slot]) == color) occupied |= 1ULL << square[slot];
+            }
+            return occupied;
+        }
+
+        bool attacked(int target, Color by, Bitboard occupied) const {
+            for(int slot = 0; slot < count; slot++){
+                if(colorOf(piece[slot]) != by) continue;
+
+                PieceType type = typeOf(piece[slot]);
+                Bitboard attacks = type == PieceType::PAWN ? pawn_attacks[static_cast<int>(by) * 64 + square[slot]]
+                                                           : piece_attacks(type, square[slot], occupied);
+                if(attacks & (1ULL << target)) return true;
+            }
+            return false;
+        }
+
+        bool in_check(Color color) const {
+            int king = square[color == Color::WHITE ? 0 : 1];
+            return attacked(king, opposite(color), occupancy(Color::WHITE) | occupancy(Color::BLACK));
+        }
+
+        std::vector<std::pair<Piece, int>> pieces() const {
+            std::vector<std::pair<Piece, int>> result;
+            for(int slot = 2; slot < count; slot++) result.emplace_back(piece[slot], square[slot]);
+            return result;
+        }
+    };
+
+    /// @brief Calls visit(child, conversion) for every legal move, conversion when the move captures or promotes
+    /// @return the number of legal moves
+    template<typename Visit>
+    int for_each_move(const Setup& setup, Visit&& visit) {
+        Color us = setup.side_to_move, them = opposite(setup.side_to_move);
+        Bitboard own = setup.occupancy(us), other = setup.occupancy(them), occupied = own | other;
+        Bitboard their_king = 1ULL << setup.square[them == Color::WHITE ? 0 : 1];
+        int legal = 0;
+
+        auto play = [&](int slot, int to, Piece promoted){
+            Setup child = setup;
+            bool captured = false;
+            for(int other_slot = 2; other_slot < child.count; other_slot++){
+                if(other_slot == slot || child.square[other_slot] != to) continue;
+                for(int s = other_slot; s + 1 < child.count; s++){
+                    child.piece[s] = child.piece[s + 1];
+                    child.square[s] = child.square[s + 1];
+                }
+                child.count--;
+                if(other_slot < slot) slot--;
+                captured = true;
+                break;
+            }
+
+            child.square[slot] = static_cast<int8_t>(to);
+            if(promoted != Piece::NONE) child.piece[slot] = promoted;
+            child.side_to_move = them;
+            if(child.in_check(us)) return;
+
+            legal++;
+            visit(child, captured || promoted != Piece::NONE);
+        };
+
+        for(int slot = 0; slot < setup.count; slot++){
+            Piece piece = setup.piece[slot];
+            if(colorOf(piece) != us) continue;
+
+            int from = setup.square[slot];
+            PieceType type = typeOf(piece);
+            if(type != PieceType::PAWN){
+                Bitboard targets = piece_attacks(type, from, occupied) & ~own & ~their_king;
+                while(targets != 0) play(slot, pop_lsb(targets), Piece::NONE);
+                continue;
+            }
+
+            int forward = us == Color::WHITE ? 8 : -8;
+            int offset = us == Color::WHITE ? 0 : 6;
+            Bitboard targets = pawn_attacks[static_cast<int>(us) * 64 + from] & other & ~their_king;
+            if(!(occupied & (1ULL << (from + forward)))){
+                targets |= 1ULL << (from + forward);
+
+                int start_rank = us == Color::WHITE ? 1 : 6;
+                if(rankOf(from) == start_rank && !(occupied & (1ULL << (from + 2 * forward)))) play(slot, from + 2 * forward, Piece::NONE);
+            }
+
+            while(targets != 0){
+                int to = pop_lsb(targets);
+                if(rankOf(to) != 0 && rankOf(to) != 7){
+                    play(slot, to, Piece::NONE);
+                    continue;
+                }
+                for(Piece promoted : {W_QUEEN, W_ROOK, W_BISHOP, W_KNIGHT}) play(slot, to, static_cast<Piece>(promoted + offset));
+            }
+        }
+        return legal;
+    }
+
+    /// @brief Calls visit(parent) for every legal position that reaches this one with a quiet move.
+    /// Captures and promotions come from other tables and are not undone.
+    template<typename Visit>
+    void for_each_unmove(const Setup& setup, Visit&& visit) {
+        Color mover = opposite(setup.side_to_move);
+        Bitboard occupied = setup.occupancy(Color::WHITE) | setup.occupancy(Color::BLACK);
+
+        for(int slot = 0; slot < setup.count; slot++){
+            if(colorOf(setup.piece[slot]) != mover) continue;
+
+            int to = setup.square[slot];
+            PieceType type = typeOf(setup.piece[slot]);
+            Bitboard origins = 0;
+
+            if(type == PieceType::PAWN){
+                int backward = mover == Color::WHITE ? -8 : 8;
+                int double_rank = mover == Color::WHITE ? 3 : 4;
+                int from = to + backward;
+
+                //A pawn never stands on its first rank, so a single step back has to leave it on the second or further
+                if(rankOf(from) != 0 && rankOf(from) != 7 && !(occupied & (1ULL << from))){
+                    origins |= 1ULL << from;
+                    if(rankOf(to) == double_rank && !(occupied & (1ULL << (from + backward)))) origins |= 1ULL << (from + backward);
+                }
+            } else {
+                origins = piece_attacks(type, to, occupied) & ~occupied;
+            }
+
+            while(origins != 0){
+                Setup parent = setup;
+                parent.square[slot] = static_cast<int8_t>(pop_lsb(origins));
+                parent.side_to_move = mover;
+                if(!parent.in_check(setup.side_to_move)) visit(parent);
+            }
+        }
+    }
+
+    /// @brief One signature's entries, either generated in memory or mapped from a .dctb file
+    class Table {
+        public:
+            explicit Table(const Material& material)
+                : material(material), pawns(material.has_pawns()), kings(&king_pairs(pawns)) {
+                entries = 2 * kings->pairs.size();
+                for(Piece piece : material.pieces) entries *= domain(piece);
+            }
+
+            const Material material;
+
+            uint64_t size() const {
+                return entries;
+            }
+
+            bool index_of(const Setup& setup, uint64_t& out) const {
+                int symmetry = canonical_symmetry(setup.square[0], setup.square[1], pawns);
+                int pair = kings->index[transform(setup.square[0], symmetry) * 64 + transform(setup.square[1], symmetry)];
+                if(pair < 0) return false;
+
+                uint64_t index = static_cast<uint64_t>(setup.side_to_move == Color::WHITE ? 0 : 1) * kings->pairs.size() + pair;
+                for(int slot = 2; slot < setup.count; slot++){
+                    int square = transform(setup.square[slot], symmetry);
+                    if(typeOf(setup.piece[slot]) == PieceType::PAWN){
+                        if(rankOf(square) == 0 || rankOf(square) == 7) return false;
+                        square -= 8;
+                    }
+                    index = index * domain(setup.piece[slot]) + square;
+                }
+                out = index;
+                return true;
+            }
+
+            /// @brief Every index holding the position. Pawnless positions with both kings on the long diagonal
+            /// have a second one, mirrored along it, and retrograde passes have to update both.
+            int indexes_of(const Setup& setup, uint64_t* out) const {
+                if(!index_of(setup, out[0])) return 0;
+                if(pawns) return 1;
+
+                int symmetry = canonical_symmetry(setup.square[0], setup.square[1], pawns);
+                Setup mirrored = setup;
+                for(int slot = 0; slot < setup.count; slot++){
+                    mirrored.square[slot] = static_cast<int8_t>(transform(transform(setup.square[slot], symmetry), 4));
+                }
+                if(fileOf(mirrored.square[0]) != rankOf(mirrored.square[0]) || fileOf(mirrored.square[1]) != rankOf(mirrored.square[1])) return 1;
+
+                if(!index_of(mirrored, out[1]) || out[1] == out[0]) return 1;
+                return 2;
+            }
+
+            void setup_of(uint64_t index, Setup& out) const {
+                out.count = static_cast<int>(material.pieces.size()) + 2;
+                for(int slot = out.count - 1; slot >= 2; slot--){
+                    Piece piece = material.pieces[slot - 2];
+                    int size = domain(piece);
+                    int square = static_cast<int>(index % size);
+                    index /= size;
+
+                    out.piece[slot] = piece;
+                    out.square[slot] = static_cast<int8_t>(typeOf(piece) == PieceType::PAWN ? square + 8 : square);
+                }
+
+                const auto& pair = kings->pairs[index % kings->pairs.size()];
+                out.piece[0] = W_KING;
+                out.piece[1] = B_KING;
+                out.square[0] = static_cast<int8_t>(pair.first);
+                out.square[1] = static_cast<int8_t>(pair.second);
+                out.side_to_move = index / kings->pairs.size() == 0 ? Color::WHITE : Color::BLACK;
+            }
+
+            uint8_t wdl(uint64_t index) const {
+                return (wdl_bits[index / 4] >> (2 * (index % 4))) & 3;
+            }
+
+            uint8_t moves(uint64_t index) const {
+                return distances[index];
+            }
+
+            void adopt(std::vector<uint8_t> wdl_section, std::vector<uint8_t> distance_section) {
+                owned_wdl = std::move(wdl_section);
+                owned_distances = std::move(distance_section);
+                wdl_bits = owned_wdl.data();
+                distances = owned_distances.data();
+            }
+
+            bool open(const std::string& path) {
+                if(!file.open(path) || file.size() < HEADER_SIZE) return false;
+
+                const unsigned char* header = file.data();
+                if(!std::equal(MAGIC.begin(), MAGIC.end(), header)) return false;
+                if(read_little_endian(header + 4, 2) != FORMAT_VERSION) return false;
+
+                int count = header[6];
+                if(count != static_cast<int>(material.pieces.size())) return false;
+                for(int i = 0; i < count; i++){
+                    if(header[8 + i] != material.pieces[i]) return false;
+                }
+
+                uint64_t stored_entries = read_little_endian(header + 16, 8);
+                uint64_t wdl_offset = read_little_endian(header + 24, 8);
+                uint64_t distance_offset = read_little_endian(header + 32, 8);
+                if(stored_entries != entries) return false;
+                if(wdl_offset + (entries + 3) / 4 > file.size() || distance_offset + entries > file.size()) return false;
+
+                wdl_bits = file.data() + wdl_offset;
+                distances = file.data() + distance_offset;
+                return true;
+            }
+
+            bool write(const std::string& path) const {
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                if(!out) return false;
+
+                uint64_t wdl_size = (entries + 3) / 4;
+                out.write(MAGIC.data(), MAGIC.size());
+                write_little_endian(out, FORMAT_VERSION, 2);
+                out.put(static_cast<char>(material.pieces.size()));
+                out.put(0);
+                for(int i = 0; i < 4; i++){
+                    out.put(static_cast<char>(i < static_cast<int>(material.pieces.size()) ? material.pieces[i] : Piece::NONE));
+                }
+                write_little_endian(out, 0, 4);
+                write_little_endian(out, entries, 8);
+                write_little_endian(out, HEADER_SIZE, 8);
+                write_little_endian(out, HEADER_SIZE + wdl_size, 8);
+
+                out.write(reinterpret_cast<const char*>(wdl_bits), static_cast<std::streamsize>(wdl_size));
+                out.write(reinterpret_cast<const char*>(distances), static_cast<std::streamsize>(entries));
+                return static_cast<bool>(out);
+            }
+
+        private:
+            bool pawns;
+            const KingPairs* kings;
+            uint64_t entries;
+
+            MappedFile file;
+            std::vector<uint8_t> owned_wdl;
+            std::vector<uint8_t> owned_distances;
+            const uint8_t* wdl_bits = nullptr;
+            const uint8_t* distances = nullptr;
+
+            static int domain(Piece piece) {
+                return typeOf(piece) == PieceType::PAWN ? 48 : 64;
+            }
+    };
+
+    GeneratedTables::GeneratedTables() = default;
+    GeneratedTables::~GeneratedTables() = default;
+
+    int GeneratedTables::load(const std::string& directory) {
+        int loaded = 0;
+        std::error_code error;
+        if(!std::filesystem::is_directory(directory, error)) return 0;
+
+        for(const auto& file : std::filesystem::directory_iterator(directory, error)){
+            if(file.path().extension() != ".dctb") continue;
+
+            Material material;
+            if(!parse_material(file.path().stem().string(), material) || has(material.name())) continue;
+
+            auto table = std::make_unique<Table>(material);
+            if(!table->open(file.path().string())) continue;
+
+            add(std::move(table));
+            loaded++;
+        }
+        return loaded;
+    }
+
+    void GeneratedTables::add(std::unique_ptr<Table> table) {
+        largest = std::max(largest, table->material.piece_count());
+        std::string name = table->material.name();
+        tables[name] = std::move(table);
+    }
+
+    bool GeneratedTables::has(const std::string& name) const {
+        return tables.count(name) != 0;
+    }
+
+    int GeneratedTables::size() const {
+        return static_cast<int>(tables.size());
+    }
+
+    int GeneratedTables::max_pieces() const {
+        return largest;
+    }
+
+    bool GeneratedTables::lookup(const std::vector<std::pair<Piece, int>>& pieces, int white_king, int black_king,
+                                 Color side_to_move, int& wdl, int& moves) const {
+        if(pieces.empty()){
+            wdl = DRAW;
+            moves = 0;
+            return true;
+        }
+        if(static_cast<int>(pieces.size()) + 2 > MAX_PIECES) return false;
+
+        auto by_signature = [](const std::pair<Piece, int>& a, const std::pair<Piece, int>& b){
+            return signature_before(a.first, b.first);
+        };
+
+        //Tables hold one orientation, the other is looked up with the colors swapped and the board flipped
+        for(int flipped = 0; flipped < 2; flipped++){
+            std::vector<std::pair<Piece, int>> sorted = pieces;
+            Setup setup;
+            setup.piece[0] = W_KING;
+            setup.piece[1] = B_KING;
+            setup.square[0] = static_cast<int8_t>(white_king);
+            setup.square[1] = static_cast<int8_t>(black_king);
+            setup.side_to_move = side_to_move;
+
+            if(flipped){
+                for(auto& [piece, square] : sorted){
+                    piece = swap_color(piece);
+                    square ^= 56;
+                }
+                setup.square[0] = static_cast<int8_t>(black_king ^ 56);
+                setup.square[1] = static_cast<int8_t>(white_king ^ 56);
+                setup.side_to_move = opposite(side_to_move);
+            }
+
+            std::sort(sorted.begin(), sorted.end(), by_signature);
+            Material material;
+            for(const auto& entry : sorted) material.pieces.push_back(entry.first);
+
+            auto table = tables.find(material.name());
+            if(table == tables.end()) continue;
+
+            setup.count = static_cast<int>(sorted.size()) + 2;
+            for(size_t i = 0; i < sorted.size(); i++){
+                setup.piece[i + 2] = sorted[i].first;
+                setup.square[i + 2] = static_cast<int8_t>(sorted[i].second);
+            }
+
+            uint64_t index;
+            if(!table->second->index_of(setup, index)) return false;
+
+            wdl = table->second->wdl(index);
+            moves = table->second->moves(index);
+            return wdl != ILLEGAL;
+        }
+        return false;
+    }
+
+    namespace {
+        bool lookup_position(const GeneratedTables& tables, const Position& position, int& wdl, int& moves) {
+            if(position.enPassantSquare != NO_SQUARE) return false;
+
+            std::vector<std::pair<Piece, int>> pieces;
+            for(int p = W_PAWN; p < NONE; p++){
+                Piece piece = static_cast<Piece>(p);
+                if(typeOf(piece) == PieceType::KING) continue;
+
+                Bitboard board = position.get_piece_bitboard(piece);
+                while(board != 0) pieces.emplace_back(piece, pop_lsb(board));
+            }
+
+            int white_king = std::countr_zero(position.get_piece_bitboard(W_KING));
+            int black_king = std::countr_zero(position.get_piece_bitboard(B_KING));
+            return tables.lookup(pieces, white_king, black_king, position.sideToMove, wdl, moves);
+        }
+    }
+
+    bool GeneratedTables::probe_wdl(const Position& position, tablebase::WDL& out) const {
+        int wdl, moves;
+        if(!lookup_position(*this, position, wdl, moves)) return false;
+
+        out = wdl == WIN ? tablebase::WDL::WIN : wdl == LOSS ? tablebase::WDL::LOSS : tablebase::WDL::DRAW;
+        return true;
+    }
+
+    bool GeneratedTables::probe_dtz(const Position& position, int& out) const {
+        int wdl, moves;
+        if(!lookup_position(*this, position, wdl, moves)) return false;
+
+        out = wdl == WIN ? 2 * moves - 1 : wdl == LOSS ? -2 * moves : 0;
+        return true;
+    }
+
+    bool GeneratedTables::probe_dtm(const Position& position, int& out) const {
+        int wdl, moves;
+        if(!lookup_position(*this, position, wdl, moves)) return false;
+
+        out = wdl == WIN ? moves : wdl == LOSS ? -moves : 0;
+        return true;
+    }
+
+    namespace {
+
+        /*
+         * Retrograde analysis of one table, every position the other tables reach must already be known.
+         *
+         * The first pass plays every move of every position: mates are losses in 0, stalemates draws, and
+         * captures and promotions are resolved in the smaller tables. Then pass n handles the positions decided
+         * n plies from mate. After a loss in n plies every predecessor wins in n + 1. After a win in n plies a
+         * predecessor is lost if all its quiet moves lead to wins decided by now, and then it is lost in n + 1
+         * plies, or later if one of its captures holds out longer. Whatever is left undecided is a draw.
+         */
+        bool build(Table& table, const GeneratedTables& smaller, int threads) {
+            uint64_t entries = table.size();
+            std::vector<uint8_t> state(entries, ILLEGAL);
+            std::vector<uint8_t> moves(entries, 0); //loss in moves of the longest losing conversion while undecided
+            std::atomic<int> max_level{0};
+            std::atomic<bool> missing{false};
+
+            parallel_for(entries, threads, [&](uint64_t index){
+                Setup setup;
+                table.setup_of(index, setup);
+
+                Bitboard occupied = 0;
+                for(int slot = 0; slot < setup.count; slot++) occupied |= 1ULL << setup.square[slot];
+                if(std::popcount(occupied) != setup.count || setup.in_check(opposite(setup.side_to_move))) return;
+
+                int best_win = 0, longest_loss = 0, quiet = 0;
+                bool escape = false;
+                int legal = for_each_move(setup, [&](const Setup& child, bool conversion){
+                    if(!conversion){
+                        quiet++;
+                        return;
+                    }
+
+                    int wdl, distance;
+                    if(!smaller.lookup(child.pieces(), child.square[0], child.square[1], child.side_to_move, wdl, distance)){
+                        missing = true;
+                        return;
+                    }
+                    if(wdl == DRAW) escape = true;
+                    else if(wdl == LOSS) best_win = best_win == 0 ? distance + 1 : std::min(best_win, distance + 1);
+                    else longest_loss = std::max(longest_loss, distance);
+                });
+
+                uint8_t result;
+                if(legal == 0){
+                    result = setup.in_check(setup.side_to_move) ? LOSS : DECIDED_DRAW;
+                } else if(best_win != 0){
+                    result = WIN; //may still be lowered by a faster quiet win
+                    moves[index] = static_cast<uint8_t>(std::min(best_win, MOVES_LIMIT));
+                } else if(quiet == 0){
+                    result = escape ? DECIDED_DRAW : LOSS;
+                    moves[index] = static_cast<uint8_t>(std::min(longest_loss, MOVES_LIMIT));
+                } else {
+                    result = escape ? ESCAPE : UNKNOWN;
+                    moves[index] = static_cast<uint8_t>(std::min(longest_loss, MOVES_LIMIT));
+                }
+
+                state[index] = result;
+                raise_to(max_level, level_of(result, moves[index]));
+            });
+            if(missing) return false;
+
+            for(int level = 0; level <= max_level.load(); level++){
+                bool losses = level % 2 == 0;
+
+                auto update = [&](const Setup& parent_setup, uint64_t parent){
+                    uint8_t parent_state = load(state, parent);
+
+                    if(losses){
+                        uint8_t win_moves = static_cast<uint8_t>(std::min(level / 2 + 1, MOVES_LIMIT));
+                        bool faster = parent_state == WIN && load(moves, parent) > win_moves;
+                        if(parent_state != UNKNOWN && parent_state != ESCAPE && !faster) return;
+
+                        store(moves, parent, win_moves);
+                        store(state, parent, WIN);
+                        raise_to(max_level, level + 1);
+                        return;
+                    }
+
+                    if(parent_state != UNKNOWN) return;
+
+                    //Lost only once every quiet move reaches a win decided by now
+                    bool lost = true;
+                    for_each_move(parent_setup, [&](const Setup& child_setup, bool conversion){
+                        if(conversion || !lost) return;
+                        uint64_t child;
+                        lost = table.index_of(child_setup, child) && load(state, child) == WIN
+                            && level_of(WIN, load(moves, child)) <= level;
+                    });
+                    if(!lost) return;
+
+                    int loss_moves = std::min(std::max<int>(load(moves, parent), (level + 1) / 2), MOVES_LIMIT);
+                    store(moves, parent, static_cast<uint8_t>(loss_moves));
+                    store(state, parent, LOSS);
+                    raise_to(max_level, 2 * loss_moves);
+                };
+
+                parallel_for(entries, threads, [&](uint64_t index){
+                    uint8_t current = load(state, index);
+                    if(current != (losses ? LOSS : WIN) || level_of(current, load(moves, index)) != level) return;
+
+                    Setup setup;
+                    table.setup_of(index, setup);
+                    for_each_unmove(setup, [&](const Setup& parent_setup){
+                        uint64_t parents[2];
+                        int count = table.indexes_of(parent_setup, parents);
+                        for(int i = 0; i < count; i++) update(parent_setup, parents[i]);
+                    });
+                });
+            }
+
+            std::vector<uint8_t> wdl_section((entries + 3) / 4, 0);
+            for(uint64_t index = 0; index < entries; index++){
+                uint8_t code = state[index] == WIN || state[index] == LOSS || state[index] == ILLEGAL ? state[index] : DRAW;
+                if(code != WIN && code != LOSS) moves[index] = 0;
+                wdl_section[index / 4] |= static_cast<uint8_t>(code << (2 * (index % 4)));
+            }
+            table.adopt(std::move(wdl_section), std::move(moves));
+            return true;
+        }
+
+        bool generate_with(const Material& material, const std::string& directory, int threads,
+                           std::ostream* log, GeneratedTables& tables) {
+            if(tables.has(material.name())) return true;
+
+            for(const Material& next : successors(material)){
+                if(!generate_with(next, directory, threads, log, tables)) return false;
+            }
+
+            auto started = std::chrono::steady_clock::now();
+            auto table = std::make_unique<Table>(material);
+            if(!build(*table, tables, threads)) return false;
+
+            std::filesystem::path path = std::filesystem::path(directory) / (material.name() + ".dctb");
+            if(!table->write(path.string())) return false;
+
+            if(log != nullptr){
+                uint64_t wins = 0, losses = 0, draws = 0;
+                int longest = 0;
+                for(uint64_t index = 0; index < table->size(); index++){
+                    uint8_t code = table->wdl(index);
+                    if(code == WIN){
+                        wins++;
+                        longest = std::max<int>(longest, table->moves(index));
+                    }
+                    else if(code == LOSS) losses++;
+                    else if(code == DRAW) draws++;
+                }
+
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+                *log << material.name() << ": " << table->size() << " entries, " << wins << " wins, " << losses
+                     << " losses, " << draws << " draws, longest mate " << longest << " moves (" << elapsed.count() << " ms)" << std::endl;
+            }
+
+            tables.add(std::move(table));
+            return true;
+        }
+    }
+
+    bool generate(const std::string& name, const std::string& directory, int threads, std::ostream* log) {
+        Material material;
+        if(!parse_material(name, material)) return false;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if(!std::filesystem::is_directory(directory, error)) return false;
+
+        GeneratedTables tables;
+        tables.load(directory);
+        return generate_with(material, directory, std::max(threads, 1), log, tables);
+    }
+}
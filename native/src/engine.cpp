@@ -2,36 +2,116 @@
 #include <ranges> 
 #include "utils.h"
 #include "engine.h"
+#include "stats.h"
+#include "tablebase.h"
+#include "bitbase.h"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include "engine.h"
 
-int Engine::generate_psuedo_legal_moves(const Board &board, Move* moves)
+//Evasions and checks only go to the destination squares generate_moves works out for each piece
+constexpr bool has_targets(GenType type) {
+    return type == GenType::EVASIONS || type == GenType::CHECKS;
+}
+
+int Engine::generate_psuedo_legal_moves(const Position &board, Move* moves)
+{
+    //The only branch on the side to move, the generators below are compiled once per color
+    return board.sideToMove == Color::WHITE ? generate_moves<Color::WHITE, GenType::ALL>(board, moves)
+                                            : generate_moves<Color::BLACK, GenType::ALL>(board, moves);
+}
+
+int Engine::generate_captures(const Position &board, Move* moves)
+{
+    return board.sideToMove == Color::WHITE ? generate_moves<Color::WHITE, GenType::CAPTURES>(board, moves)
+                                            : generate_moves<Color::BLACK, GenType::CAPTURES>(board, moves);
+}
+
+int Engine::generate_evasions(const Position &board, Move* moves)
+{
+    return board.sideToMove == Color::WHITE ? generate_moves<Color::WHITE, GenType::EVASIONS>(board, moves)
+                                            : generate_moves<Color::BLACK, GenType::EVASIONS>(board, moves);
+}
+
+int Engine::generate_checks(const Position &board, Move* moves)
+{
+    return board.sideToMove == Color::WHITE ? generate_moves<Color::WHITE, GenType::CHECKS>(board, moves)
+                                            : generate_moves<Color::BLACK, GenType::CHECKS>(board, moves);
+}
+
+template<Color Us, GenType Type>
+int Engine::generate_moves(const Position &board, Move* moves)
 {
     int move_count = 0;
-    Color color = board.sideToMove;
-    
-    // Determine the range of pieces to check (W_PAWN to W_KING or B_PAWN to B_KING)
-    int start_piece = (color == Color::WHITE) ? Piece::W_PAWN : Piece::B_PAWN;
-    int end_piece = (color == Color::WHITE) ? Piece::W_KING : Piece::B_KING;
+    Bitboard targets = ~0ULL;
 
-    generate_pawn_moves(board, moves, move_count);
+    // Pawns are generated set-wise, then knight to king one piece at a time
+    constexpr int start_piece = (Us == Color::WHITE) ? Piece::W_KNIGHT : Piece::B_KNIGHT;
+    constexpr int end_piece = (Us == Color::WHITE) ? Piece::W_KING : Piece::B_KING;
 
-    for (int p_idx = start_piece; p_idx <= end_piece; ++p_idx) {
-        Piece piece = static_cast<Piece>(p_idx);
+    if constexpr (Type == GenType::EVASIONS) {
+        Bitboard checking = board.checkers();
+        if(checking == 0) return generate_moves<Us, GenType::ALL>(board, moves);
+
+        constexpr Piece king = static_cast<Piece>(end_piece);
+        int king_square = std::countr_zero(board.get_piece_bitboard(king));
 
-        if(piece == B_PAWN || piece == W_PAWN) continue;
+        // Two checkers can not both be captured or blocked with one move
+        if(std::popcount(checking) > 1){
+            generate_king_moves<Us, Type>(board, king, king_square, moves, move_count);
+            return move_count;
+        }
+
+        // Between is empty for a knight, a pawn or an adjacent checker, leaving only its capture
+        targets = checking | between_masks[king_square][std::countr_zero(checking)];
+    }
+
+    if constexpr (Type == GenType::CHECKS) {
+        // Pawn and king moves are few and check in awkward ways (promotions, en passant, castling,
+        // discoveries), so they are generated in full and filtered
+        constexpr Piece king = static_cast<Piece>(end_piece);
+        generate_pawn_moves<Us, GenType::ALL>(board, targets, moves, move_count);
+        generate_king_moves<Us, GenType::ALL>(board, king, std::countr_zero(board.get_piece_bitboard(king)), moves, move_count);
+
+        int checks = 0;
+        for(int i = 0; i < move_count; i++){
+            if(board.gives_check(moves[i])) moves[checks++] = moves[i];
+        }
+        move_count = checks;
+    } else {
+        generate_pawn_moves<Us, Type>(board, targets, moves, move_count);
+    }
+
+    // The king was handled above when looking for checks
+    constexpr int last_piece = Type == GenType::CHECKS ? end_piece - 1 : end_piece;
+    [[maybe_unused]] int enemy_king = 64;
+    if constexpr (Type == GenType::CHECKS) {
+        constexpr Piece their_king = Us == Color::WHITE ? Piece::B_KING : Piece::W_KING;
+        enemy_king = std::countr_zero(board.get_piece_bitboard(their_king));
+        if(enemy_king == 64) return move_count;
+    }
+
+    for (int p_idx = start_piece; p_idx <= last_piece; ++p_idx) {
+        Piece piece = static_cast<Piece>(p_idx);
         
         // 1. Get the Bitboard for the current piece type
         Bitboard pieces_bb = board.get_piece_bitboard(piece);
         
         // 2. Iterate over every square (bit) set in the Bitboard
-        // This loop replaces your old "for square = 0 to 63"
         while (pieces_bb) {
             // Extracts the least significant set bit's index (the piece's square)
             int from_square = __builtin_ctzll(pieces_bb); 
 
+            // A piece checks from its check squares, and a discoverer from anywhere off its line to the king
+            if constexpr (Type == GenType::CHECKS) {
+                targets = board.check_squares(typeOf(piece));
+                if ((board.discoverers() & (1ULL << from_square)) != 0) targets |= ~line_masks[enemy_king][from_square];
+            }
+
             // 3. Call the specialized helper to generate moves from this square
-            generate_moves_from_square(board, piece, from_square, moves, move_count);
+            generate_moves_from_square<Us, Type>(board, piece, from_square, targets, moves, move_count);
 
             // 4. Clear the bit we just processed
             pieces_bb &= (pieces_bb - 1);
@@ -43,45 +123,91 @@ int Engine::generate_psuedo_legal_moves(const Board &board, Move* moves)
 
 int Engine::generate_legal_moves(Board &board, Move* moves)
 {
-    int psuedo_count = generate_psuedo_legal_moves(board, moves);
+    //The attack cache settles almost every move, so the Board needs no make/undo (and no NNUE update) here
+    return generate_legal_moves(board.get_position(), moves);
+}
 
-    Move* out = moves;         // write pointer for legal moves
-    Move* in  = moves;         // read pointer for pseudo-legal moves
+uint64_t Engine::perft(Board &board, int depth) {
+    if (depth == 0) return 1;
 
-    for(int i = 0; i < psuedo_count; i++, in++){
-        board.make_move(*in); // read and make the move in psuedo-legal
+    Move move_list[MAX_NUMBER_OF_MOVES];
+    int n_moves = generate_legal_moves(board, move_list);
 
-        //increment until we find a legal move basically
-        if(!board.is_in_check(board.sideToMove == Color::WHITE ? Color::BLACK : Color::WHITE)){
-            *out = *in; //overwrites with the next legal move
-            out++; //by the end the front n moves are all the legal moves, and we return n
-                    //that way we when we loop over we only look at the front n moves, aka the legal moves
-        }
+    if (depth == 1) return n_moves;
 
+    uint64_t nodes = 0;
+    for (int i = 0; i < n_moves; i++) {
+        board.make_move(move_list[i]);
+        nodes += perft(board, depth - 1);
         board.undo_move();
     }
 
-    return static_cast<int>(out - moves); //out starts at start of moves and goes to last move, so the difference is # of legal moves
+    return nodes;
 }
 
-uint64_t Engine::perft(Board &board, int depth) {
+int Engine::generate_legal_moves(const Position &position, Move *moves)
+{
+    int psuedo_count = position.checkers() != 0 ? generate_evasions(position, moves)
+                                                 : generate_psuedo_legal_moves(position, moves);
+    int legal_count = 0;
+
+    for(int i = 0; i < psuedo_count; i++){
+        if(position.is_legal(moves[i])){
+            moves[legal_count++] = moves[i];
+        } else {
+            CHESS_STAT_INC(illegal_moves_rejected);
+        }
+    }
+
+    return legal_count;
+}
+
+uint64_t Engine::perft(const Position &position, int depth)
+{
     if (depth == 0) return 1;
 
     Move move_list[MAX_NUMBER_OF_MOVES];
-    int n_moves = generate_legal_moves(board, move_list);
+    int n_moves = generate_legal_moves(position, move_list);
 
     if (depth == 1) return n_moves;
 
     uint64_t nodes = 0;
     for (int i = 0; i < n_moves; i++) {
-        board.make_move(move_list[i]);
-        nodes += perft(board, depth - 1);
-        board.undo_move();
+        Position child = position;
+        child.apply_move(move_list[i]);
+        nodes += perft(child, depth - 1);
     }
 
     return nodes;
 }
 
+uint64_t parallel_perft(const Position &position, int depth, int threads)
+{
+    Engine root_engine;
+    Move root_moves[MAX_NUMBER_OF_MOVES];
+    int root_count = root_engine.generate_legal_moves(position, root_moves);
+    if(depth <= 1) return depth == 1 ? root_count : 1;
+
+    std::atomic<int> next_move{0};
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> workers;
+
+    for(int t = 0; t < std::max(1, threads); t++){
+        workers.emplace_back([&]{
+            Engine engine;
+            int i;
+            while((i = next_move++) < root_count){
+                Position child = position;
+                child.apply_move(root_moves[i]);
+                total += engine.perft(child, depth - 1);
+            }
+        });
+    }
+    for(auto& worker : workers) worker.join();
+
+    return total;
+}
+
 uint64_t Engine::perft_divide(Board &board, int depth) {
     Move move_list[MAX_NUMBER_OF_MOVES];
     int n_moves = generate_legal_moves(board, move_list);
@@ -106,48 +232,517 @@ uint64_t Engine::perft_divide(Board &board, int depth) {
 
 int Engine::evaluate_position(Board &board)
 {
+    if(eval_cache.empty()){
+        eval_cache.resize(EVAL_CACHE_SIZE);
+    }
+
+    //Scores from another network (or the PST fallback) are no longer valid
+    uint32_t network = use_nnue ? nnue::network_id() : 0;
+    if(eval_cache_network != network){
+        std::fill(eval_cache.begin(), eval_cache.end(), EvalCacheEntry{});
+        eval_cache_network = network;
+    }
+
+    CHESS_STAT_INC(eval_cache_probes);
+
+    //The key includes the side to move, so the cached side-to-move score is always the right sign
+    EvalCacheEntry& entry = eval_cache[board.zobrist_key & (EVAL_CACHE_SIZE - 1)];
+    if(entry.key == board.zobrist_key && entry.key != 0){
+        CHESS_STAT_INC(eval_cache_hits);
+        return entry.score;
+    }
+
+    entry.score = evaluate_uncached(board);
+
+    //King and pawn against king is decided by the bitbase, the evaluation only steers towards the win.
+    //The bonus stays below a queen so promoting still looks better than keeping the pawn.
+    static constexpr int kpk_win_bonus = 400;
+    int kpk;
+    if(bitbase::probe_kpk(board, kpk)){
+        entry.score = kpk * (std::abs(entry.score) + kpk_win_bonus);
+    }
+
+    entry.key = board.zobrist_key;
+    return entry.score;
+}
+
+int Engine::evaluate_uncached(Board &board)
+{
+    if(use_nnue && nnue::is_loaded()){
+        if(board.accumulator.network_id != nnue::network_id()){
+            nnue::refresh(board.accumulator, board);
+        }
+        return nnue::evaluate(board.accumulator, static_cast<int>(board.sideToMove));
+    }
+
     Color side = board.sideToMove;
 
-    int score = board.get_pst_color(Color::WHITE) - board.get_pst_color(Color::BLACK);
+    //Blend middlegame and endgame scores by how much material is left
+    int mg = board.pst_mg[static_cast<int>(Color::WHITE)] - board.pst_mg[static_cast<int>(Color::BLACK)];
+    int eg = board.pst_eg[static_cast<int>(Color::WHITE)] - board.pst_eg[static_cast<int>(Color::BLACK)];
+
+    //Pawn structure barely changes between nodes, so it comes from the pawn hash table
+    const PawnHashEntry& pawns = probe_pawn_table(board);
+    mg += pawns.mg;
+    eg += pawns.eg;
+
+    //Passed pawns are worth more the closer our king is to their path and the further the enemy king is
+    for(int c = 0; c < 2; c++){
+        Bitboard passed = pawns.passed_pawns[c];
+        int sign = c == 0 ? 1 : -1;
+        int own_king = std::countr_zero(board.get_piece_bitboard(c == 0 ? Piece::W_KING : Piece::B_KING));
+        int enemy_king = std::countr_zero(board.get_piece_bitboard(c == 0 ? Piece::B_KING : Piece::W_KING));
+
+        while(passed != 0){
+            int stop_square = pop_lsb(passed) + (c == 0 ? 8 : -8);
+            eg += sign * 5 * (square_distance(enemy_king, stop_square) - square_distance(own_king, stop_square));
+        }
+    }
+
+    int score = board.get_tapered_pst(mg, eg);
 
     score = side == Color::WHITE ? score : -score;
 
     return score;
 }
 
-void Engine::generate_moves_from_square(const Board &board, Piece piece, uint8_t index, Move *moves, int &move_count)
+const PawnHashEntry& Engine::probe_pawn_table(const Position &board)
+{
+    if(pawn_table.empty()){
+        pawn_table.resize(PAWN_TABLE_SIZE);
+    }
+
+    CHESS_STAT_INC(pawn_table_probes);
+
+    PawnHashEntry& entry = pawn_table[board.pawn_key & (PAWN_TABLE_SIZE - 1)];
+    if(entry.key == board.pawn_key && entry.key != 0){
+        CHESS_STAT_INC(pawn_table_hits);
+        return entry;
+    }
+
+    evaluate_pawn_structure(board, entry);
+    entry.key = board.pawn_key;
+    return entry;
+}
+
+void Engine::evaluate_pawn_structure(const Position &board, PawnHashEntry &entry)
+{
+    //Indexed by rank relative to the pawn's color
+    static constexpr int passed_mg[8] = {0, 5, 10, 15, 25, 40, 60, 0};
+    static constexpr int passed_eg[8] = {0, 10, 20, 35, 60, 100, 150, 0};
+    static constexpr int doubled_mg = -10, doubled_eg = -20;
+    static constexpr int isolated_mg = -10, isolated_eg = -15;
+    static constexpr int backward_mg = -8, backward_eg = -10;
+
+    entry.mg = 0;
+    entry.eg = 0;
+    entry.passed_pawns = {0ULL, 0ULL};
+
+    const Bitboard pawns[2] = {board.get_piece_bitboard(Piece::W_PAWN), board.get_piece_bitboard(Piece::B_PAWN)};
+
+    for(int c = 0; c < 2; c++){
+        const Bitboard own = pawns[c];
+        const Bitboard enemy = pawns[c ^ 1];
+        const int sign = c == 0 ? 1 : -1;
+        int mg = 0, eg = 0;
+
+        for(int file = 0; file < 8; file++){
+            int count = std::popcount(own & file_masks[file]);
+            if(count > 1){
+                mg += doubled_mg * (count - 1);
+                eg += doubled_eg * (count - 1);
+            }
+        }
+
+        Bitboard remaining = own;
+        while(remaining != 0){
+            int square = pop_lsb(remaining);
+            int relative_rank = c == 0 ? rankOf(square) : 7 - rankOf(square);
+
+            if((passed_pawn_masks[c][square] & enemy) == 0){
+                entry.passed_pawns[c] |= 1ULL << square;
+                mg += passed_mg[relative_rank];
+                eg += passed_eg[relative_rank];
+            }
+
+            if((adjacent_file_masks[fileOf(square)] & own) == 0){
+                mg += isolated_mg;
+                eg += isolated_eg;
+            } else if((pawn_support_masks[c][square] & own) == 0){
+                //No neighbour can come up to defend it and an enemy pawn controls the square in front
+                int stop_square = square + (c == 0 ? 8 : -8);
+                if((pawn_attacks[stop_square + (c == 0 ? 0 : 64)] & enemy) != 0){
+                    mg += backward_mg;
+                    eg += backward_eg;
+                }
+            }
+        }
+
+        entry.mg += sign * mg;
+        entry.eg += sign * eg;
+    }
+}
+
+SearchResult Engine::search(Board &board, int depth, int time_limit_ms)
+{
+    if(transposition_table.empty()){
+        transposition_table.resize(TT_SIZE);
+    }
+
+    nodes_searched = 0;
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(time_limit_ms);
+    time_limited = false;
+    search_stopped = false;
+
+    SearchResult result{};
+    result.best_move.piece = Piece::NONE;
+
+    Move root_moves[MAX_NUMBER_OF_MOVES];
+    if(generate_legal_moves(board, root_moves) == 0){
+        result.score = board.is_in_check(board.sideToMove) ? -MATE_SCORE : 0;
+        return result;
+    }
+
+    if(probe_root_tablebase(board, result)) return result;
+
+    //Iterative deepening, each iteration seeds the move ordering of the next through the TT
+    for(int current_depth = 1; current_depth <= depth; current_depth++){
+        int score = negamax(board, current_depth, 0, -INFINITE_SCORE, INFINITE_SCORE);
+
+        //An unfinished iteration is thrown away, its best move may not have been compared against the rest
+        if(search_stopped) break;
+
+        result.best_move = root_best_move;
+        result.score = score;
+        result.depth = current_depth;
+
+        //No point searching deeper once a forced mate is found
+        if(std::abs(score) >= MATE_SCORE - MAX_SEARCH_PLY) break;
+
+        time_limited = time_limit_ms > 0;
+        if(time_limited && std::chrono::steady_clock::now() >= deadline) break;
+    }
+
+    result.nodes = nodes_searched;
+    return result;
+}
+
+bool Engine::other_move_reaches(Board &board, const Move &excluded, int depth, int bound)
+{
+    if(transposition_table.empty()){
+        transposition_table.resize(TT_SIZE);
+    }
+    time_limited = false;
+    search_stopped = false;
+
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int move_count = generate_legal_moves(board, moves);
+    for(int i = 0; i < move_count; i++){
+        if(same_move(moves[i], excluded)) continue;
+
+        board.make_move(moves[i]);
+        int score = -negamax(board, depth - 1, 1, -bound, -bound + 1);
+        board.undo_move();
+        if(score >= bound) return true;
+    }
+    return false;
+}
+
+bool Engine::probe_root_tablebase(Board &board, SearchResult &result)
+{
+    if(std::popcount(board.occupancy) > std::min(tablebase_probe_limit, tablebase::max_pieces())){
+        return false;
+    }
+
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int move_count = generate_legal_moves(board, moves);
+
+    //The best result first, then the fastest win or the slowest loss. Distance to mate orders the moves
+    //when a source knows it, otherwise a capture or pawn move restarts the fifty move count, so a
+    //winning one is as fast as it gets.
+    int best_rank = -INFINITE_SCORE;
+    int best_wdl = 0;
+    for(int i = 0; i < move_count; i++){
+        bool zeroing = moves[i].captured_piece != Piece::NONE || moves[i].piece == Piece::W_PAWN || moves[i].piece == Piece::B_PAWN;
+
+        board.make_move(moves[i]);
+        CHESS_STAT_INC(tablebase_probes);
+        tablebase::WDL child_wdl;
+        int child_dtz = 0;
+        int child_dtm = 0;
+        bool known = tablebase::probe_wdl(board, child_wdl) && tablebase::probe_dtz(board, child_dtz);
+        bool mate_distance = known && tablebase::probe_dtm(board, child_dtm);
+        board.undo_move();
+
+        //Every move has to be ranked, otherwise the regular search decides
+        if(!known) return false;
+        CHESS_STAT_INC(tablebase_hits);
+
+        int wdl = -static_cast<int>(child_wdl);
+        int distance = mate_distance ? std::abs(child_dtm) : zeroing ? 0 : std::abs(child_dtz);
+        int rank = wdl * 10000 + (wdl > 0 ? -distance : distance);
+
+        if(rank > best_rank){
+            best_rank = rank;
+            best_wdl = wdl;
+            result.best_move = moves[i];
+        }
+    }
+
+    result.score = best_wdl == 2 ? TB_WIN_SCORE - 1 : best_wdl == -2 ? -TB_WIN_SCORE + 1 : 0;
+    result.depth = 0;
+    result.nodes = 0;
+    return true;
+}
+
+bool Engine::out_of_time()
+{
+    //Checking the clock is slow compared to a node, so only look every 2048 nodes
+    if(time_limited && (nodes_searched & 2047) == 0 && std::chrono::steady_clock::now() >= deadline){
+        search_stopped = true;
+    }
+    return search_stopped;
+}
+
+void Engine::clear_transposition_table()
+{
+    std::fill(transposition_table.begin(), transposition_table.end(), TTEntry{});
+}
+
+int Engine::negamax(Board &board, int depth, int ply, int alpha, int beta)
+{
+    if(depth <= 0 || ply >= MAX_SEARCH_PLY){
+        return quiescence(board, ply, alpha, beta);
+    }
+
+    nodes_searched++;
+    if(out_of_time()) return 0;
+
+    //A repeated position can be forced into a draw by whoever benefits, so one repetition is scored as a draw
+    if(ply > 0 && (board.half_move_clock >= 100 || board.is_repetition())) return 0;
+
+    //Few pieces left, the tablebases know the exact result of the whole subtree
+    if(ply > 0 && std::popcount(board.occupancy) <= std::min(tablebase_probe_limit, tablebase::max_pieces())){
+        CHESS_STAT_INC(tablebase_probes);
+        tablebase::WDL wdl;
+        if(tablebase::probe_wdl(board, wdl)){
+            CHESS_STAT_INC(tablebase_hits);
+            if(wdl == tablebase::WDL::WIN) return TB_WIN_SCORE - ply;
+            if(wdl == tablebase::WDL::LOSS) return -TB_WIN_SCORE + ply;
+            return 0; //draws, and results the fifty move rule turns into draws
+        }
+    }
+
+    //Drawn king and pawn endings end here, won ones are left to the search to convert
+    int kpk;
+    if(ply > 0 && bitbase::probe_kpk(board, kpk) && kpk == 0) return 0;
+
+    const int original_alpha = alpha;
+    Move tt_move{};
+    tt_move.piece = Piece::NONE;
+
+    TTEntry* entry = probe_tt(board.zobrist_key);
+    if(entry != nullptr){
+        tt_move = entry->best_move;
+
+        if(ply > 0 && entry->depth >= depth){
+            //Mate and tablebase scores are stored relative to the node, convert back to relative to the root
+            int tt_score = entry->score;
+            if(tt_score >= TB_WIN_SCORE - MAX_SEARCH_PLY) tt_score -= ply;
+            else if(tt_score <= -TB_WIN_SCORE + MAX_SEARCH_PLY) tt_score += ply;
+
+            if(entry->flag == TTFlag::EXACT) return tt_score;
+            if(entry->flag == TTFlag::LOWER_BOUND && tt_score >= beta) return tt_score;
+            if(entry->flag == TTFlag::UPPER_BOUND && tt_score <= alpha) return tt_score;
+        }
+    }
+
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int scores[MAX_NUMBER_OF_MOVES];
+    bool in_check = board.checkers() != 0;
+    int move_count = in_check ? generate_evasions(board, moves) : generate_psuedo_legal_moves(board, moves);
+    score_moves(moves, scores, move_count, tt_move);
+
+    int legal_moves = 0;
+    int best_score = -INFINITE_SCORE;
+    Move best_move = moves[0];
+
+    for(int i = 0; i < move_count; i++){
+        //Selection sort, usually a cutoff happens long before the list is sorted
+        int best_index = i;
+        for(int j = i + 1; j < move_count; j++){
+            if(scores[j] > scores[best_index]) best_index = j;
+        }
+        std::swap(moves[i], moves[best_index]);
+        std::swap(scores[i], scores[best_index]);
+
+        if(!board.is_legal(moves[i])) continue;
+        board.make_move(moves[i]);
+
+        legal_moves++;
+        int score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+        board.undo_move();
+
+        if(search_stopped) return 0;
+
+        if(score > best_score){
+            best_score = score;
+            best_move = moves[i];
+            if(ply == 0) root_best_move = best_move;
+        }
+
+        if(score > alpha){
+            alpha = score;
+        }
+
+        if(alpha >= beta){
+            CHESS_STAT_INC(beta_cutoffs);
+            if(legal_moves == 1) CHESS_STAT_INC(first_move_cutoffs);
+            break;
+        }
+    }
+
+    if(legal_moves == 0){
+        return in_check ? -MATE_SCORE + ply : 0;
+    }
+
+    TTFlag flag = best_score <= original_alpha ? TTFlag::UPPER_BOUND
+                : best_score >= beta ? TTFlag::LOWER_BOUND
+                : TTFlag::EXACT;
+    store_tt(board.zobrist_key, best_move, best_score, depth, flag, ply);
+
+    return best_score;
+}
+
+int Engine::quiescence(Board &board, int ply, int alpha, int beta)
+{
+    nodes_searched++;
+    if(out_of_time()) return 0;
+
+    int stand_pat = evaluate_position(board);
+    if(stand_pat >= beta || ply >= MAX_SEARCH_PLY) return stand_pat;
+    if(stand_pat > alpha) alpha = stand_pat;
+
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int scores[MAX_NUMBER_OF_MOVES];
+    int move_count = generate_captures(board, moves);
+
+    Move no_move{};
+    no_move.piece = Piece::NONE;
+    score_moves(moves, scores, move_count, no_move);
+
+    int legal_moves = 0;
+
+    for(int i = 0; i < move_count; i++){
+        int best_index = i;
+        for(int j = i + 1; j < move_count; j++){
+            if(scores[j] > scores[best_index]) best_index = j;
+        }
+        std::swap(moves[i], moves[best_index]);
+        std::swap(scores[i], scores[best_index]);
+
+        if(!board.is_legal(moves[i])) continue;
+        board.make_move(moves[i]);
+
+        legal_moves++;
+        int score = -quiescence(board, ply + 1, -beta, -alpha);
+        board.undo_move();
+
+        if(search_stopped) return 0;
+
+        if(score >= beta){
+            CHESS_STAT_INC(beta_cutoffs);
+            if(legal_moves == 1) CHESS_STAT_INC(first_move_cutoffs);
+            return score;
+        }
+        if(score > alpha) alpha = score;
+    }
+
+    return alpha;
+}
+
+void Engine::score_moves(const Move *moves, int *scores, int move_count, const Move &tt_move)
+{
+    static constexpr int piece_values[6] = {100, 320, 330, 500, 900, 20000};
+
+    for(int i = 0; i < move_count; i++){
+        const Move& move = moves[i];
+
+        if(tt_move.piece != Piece::NONE && same_move(move, tt_move)){
+            scores[i] = 1000000;
+        } else if(move.captured_piece != Piece::NONE){
+            //MVV-LVA: most valuable victim first, least valuable attacker breaks ties
+            scores[i] = 100000 + 10 * piece_values[move.captured_piece % 6] - piece_values[move.piece % 6];
+        } else if(move.promoted_piece != Piece::NONE){
+            scores[i] = 90000 + piece_values[move.promoted_piece % 6];
+        } else {
+            scores[i] = 0;
+        }
+    }
+}
+
+TTEntry* Engine::probe_tt(uint64_t key)
+{
+    CHESS_STAT_INC(tt_probes);
+
+    TTEntry& entry = transposition_table[key & (TT_SIZE - 1)];
+    if(entry.key != key) return nullptr;
+
+    CHESS_STAT_INC(tt_hits);
+    return &entry;
+}
+
+void Engine::store_tt(uint64_t key, const Move &best_move, int score, int depth, TTFlag flag, int ply)
+{
+    //Store mate and tablebase scores relative to this node so they stay correct when reached through another path
+    if(score >= TB_WIN_SCORE - MAX_SEARCH_PLY) score += ply;
+    else if(score <= -TB_WIN_SCORE + MAX_SEARCH_PLY) score -= ply;
+
+    TTEntry& entry = transposition_table[key & (TT_SIZE - 1)];
+
+    //Depth preferred replacement, but always replace entries from other positions
+    if(entry.key == key && entry.depth > depth) return;
+
+    entry = TTEntry{key, best_move, score, static_cast<int16_t>(depth), flag};
+}
+
+template<Color Us, GenType Type>
+void Engine::generate_moves_from_square(const Position &board, Piece piece, uint8_t index, Bitboard targets, Move *moves, int &move_count)
 {
     if(piece == Piece::W_KNIGHT || piece == Piece::B_KNIGHT){
-        generate_knight_moves(board, piece, index, moves, move_count);
+        generate_knight_moves<Us, Type>(board, piece, index, targets, moves, move_count);
     } else if(piece == Piece::W_KING || piece == Piece::B_KING){
-        generate_king_moves(board, piece, index, moves, move_count);
+        generate_king_moves<Us, Type>(board, piece, index, moves, move_count);
     } else {
-        generate_sliding_moves(board, piece, index, moves, move_count);
+        generate_sliding_moves<Us, Type>(board, piece, index, targets, moves, move_count);
     }
 }
 
-void Engine::generate_sliding_moves(const Board &board, Piece piece, uint8_t index, Move* moves, int& move_count)
+template<Color Us, GenType Type>
+void Engine::generate_sliding_moves(const Position &board, Piece piece, uint8_t index, Bitboard targets, Move* moves, int& move_count)
 {
     //Implemet Shift and Mask Approach later for faster generation
     int startDirIndex = piece == Piece::B_BISHOP || piece == Piece::W_BISHOP ? 4 : 0;
     int endDirIndex = piece == Piece::B_ROOK || piece == Piece::W_ROOK ? 4 : 8;
 
-    const Bitboard same_color = colorOf(piece) == Color::WHITE ? board.white_occupancy : board.black_occupancy;
-    const Bitboard opp_color = colorOf(piece) == Color::WHITE ? board.black_occupancy : board.white_occupancy;
+    const Bitboard same_color = Us == Color::WHITE ? board.white_occupancy : board.black_occupancy;
+    const Bitboard opp_color = Us == Color::WHITE ? board.black_occupancy : board.white_occupancy;
 
     for(int directionIndex = startDirIndex; directionIndex < endDirIndex; directionIndex++){
       for(int n = 0; n < num_squares_to_edge[index][directionIndex]; n++){
         int targetSquare = index + direction_offsets[directionIndex] * (n+1);
 
-        //This prolly unnecessary caus num_squares_to_edge
-        if(targetSquare < 0 || targetSquare > 63) break;
-
         const Bitboard target_bit = 1ULL << targetSquare;
         
         if((same_color & target_bit) != 0ULL){
             break;
         }
 
+        if(has_targets(Type) && (targets & target_bit) == 0ULL){
+            if((opp_color & target_bit) != 0ULL) break;
+            continue;
+        }
+
         if((opp_color & target_bit) != 0ULL){
             auto captured_piece = board.get_piece_at(targetSquare);
             // Construct the Move struct and add it to the list
@@ -163,6 +758,8 @@ void Engine::generate_sliding_moves(const Board &board, Piece piece, uint8_t ind
             break;
         }
 
+        if constexpr (Type == GenType::CAPTURES) continue;
+
         // Construct the Move struct and add it to the list
         moves[move_count++] = Move{
             (uint8_t)piece,          
@@ -177,70 +774,83 @@ void Engine::generate_sliding_moves(const Board &board, Piece piece, uint8_t ind
     }
 }
 
-void Engine::generate_pawn_moves(const Board &board, Move* moves, int& move_count)
+template<Color Us, GenType Type>
+void Engine::generate_pawn_moves(const Position &board, Bitboard targets, Move* moves, int& move_count)
 {
-    Color us = board.sideToMove;
-    Color them = us == Color::WHITE ? Color::BLACK : Color::WHITE;
-
-    Piece our_piece = us == Color::WHITE ? Piece::W_PAWN : Piece::B_PAWN;
+    // Everything that depends on the color is a constant here
+    constexpr Piece our_piece = Us == Color::WHITE ? Piece::W_PAWN : Piece::B_PAWN;
+    constexpr Piece their_pawn = Us == Color::WHITE ? Piece::B_PAWN : Piece::W_PAWN;
 
     // Direction constants
-    const int UP = (us == Color::WHITE) ? 8 : -8;
-    const int UP_RIGHT = (us == Color::WHITE) ? 9 : -9;
-    const int UP_LEFT = (us == Color::WHITE) ? 7 : -7;
+    constexpr int UP = (Us == Color::WHITE) ? 8 : -8;
+    constexpr int UP_RIGHT = (Us == Color::WHITE) ? 9 : -9;
+    constexpr int UP_LEFT = (Us == Color::WHITE) ? 7 : -7;
+
+    constexpr Bitboard seventh_rank = Us == Color::WHITE ? RANK7 : RANK2;
+    constexpr Bitboard third_rank = Us == Color::WHITE ? RANK3 : RANK6;
+
+    //Captures right exclude the H file for white and the A file for black, captures left the other edge
+    constexpr Bitboard capture_right_exclude = (Us == Color::WHITE) ? ~H_FILE : ~A_FILE;
+    constexpr Bitboard capture_left_exclude = (Us == Color::WHITE) ? ~A_FILE : ~H_FILE;
 
     //Bitboards
     Bitboard our_pawns = board.get_piece_bitboard(our_piece);
-    Bitboard empty = ~(board.white_occupancy | board.black_occupancy);
-    Bitboard enemies = us == Color::WHITE ? board.black_occupancy : board.white_occupancy;
+    Bitboard empty = ~board.occupancy;
+    Bitboard enemies = Us == Color::WHITE ? board.black_occupancy : board.white_occupancy;
+
+    Bitboard pawns_not_on_7th = our_pawns & ~seventh_rank;
+    Bitboard pawns_on_7th = our_pawns & seventh_rank;
+
+    //Out of check every destination has to capture the checker or block it
+    if constexpr (Type == GenType::EVASIONS) enemies &= targets;
+    Bitboard push_targets = Type == GenType::EVASIONS ? empty & targets : empty;
 
-    Bitboard pawns_not_on_7th = our_pawns & ~(us == Color::WHITE ? RANK7 : RANK2);
-    Bitboard pawns_on_7th = our_pawns & (us == Color::WHITE ? RANK7 : RANK2);
+    //Single and double push, the double push starts from the unrestricted single push
+    if constexpr (Type != GenType::CAPTURES) {
+        Bitboard single_push = shift(pawns_not_on_7th, UP) & empty;
 
-    //Single and double push
-    Bitboard single_push = shift(pawns_not_on_7th, UP) & empty;
-    extract_pawn_push(single_push, our_piece, UP, moves, move_count);
+        Bitboard double_pawns = single_push & third_rank;
+        Bitboard double_push = shift(double_pawns, UP) & push_targets;
 
-    Bitboard double_pawns = single_push & (us == Color::WHITE ? RANK3 : RANK6);
-    Bitboard double_push = shift(double_pawns, UP) & empty;
-    extract_pawn_push(double_push, our_piece, UP*2, moves, move_count);
+        extract_pawn_push(single_push & push_targets, our_piece, UP, moves, move_count);
+        extract_pawn_push(double_push, our_piece, UP*2, moves, move_count);
+    }
 
-    //Captures right (excluding H file for white, A file for black)
-    Bitboard capture_right_exclude = (us == Color::WHITE) ? ~H_FILE : ~A_FILE;
+    //Captures right
     Bitboard capture_right = shift(pawns_not_on_7th & capture_right_exclude, UP_RIGHT) & enemies;
     extract_pawn_capture(capture_right, our_piece, UP_RIGHT, moves, move_count, board);
 
-    // Captures left (excluding A file for white, H file for black)
-    Bitboard capture_left_exclude = (us == Color::WHITE) ? ~A_FILE : ~H_FILE;
+    // Captures left
     Bitboard capture_left = shift(pawns_not_on_7th & capture_left_exclude, UP_LEFT) & enemies;
     extract_pawn_capture(capture_left, our_piece, UP_LEFT, moves, move_count, board);
 
-    if(board.enPassantSquare.has_value()){
-        Bitboard ep_target = 1ULL << board.enPassantSquare.value();
+    if(board.enPassantSquare != NO_SQUARE){
+        Bitboard ep_target = 1ULL << board.enPassantSquare;
+
+        //Out of check en passant has to take the checking pawn or land between the checker and the king
+        if(Type == GenType::EVASIONS && ((ep_target | shift(ep_target, -UP)) & targets) == 0) ep_target = 0;
 
         Bitboard ep_right = shift(pawns_not_on_7th & capture_right_exclude, UP_RIGHT) & ep_target;
 
         if (ep_right) {
-            int to = board.enPassantSquare.value();
+            int to = board.enPassantSquare;
             int from = to - UP_RIGHT;
-            Piece captured = (us == Color::WHITE) ? Piece::B_PAWN : Piece::W_PAWN;
-            moves[move_count++] = Move{our_piece, (uint8_t) from, (uint8_t) to, captured, Piece::NONE, true, false};
+            moves[move_count++] = Move{our_piece, (uint8_t) from, (uint8_t) to, their_pawn, Piece::NONE, true, false};
         }
 
         Bitboard ep_left = shift(pawns_not_on_7th & capture_left_exclude, UP_LEFT) & ep_target;
 
         if (ep_left) {
-            int to = board.enPassantSquare.value();
+            int to = board.enPassantSquare;
             int from = to - UP_LEFT;
-            Piece captured = (us == Color::WHITE) ? Piece::B_PAWN : Piece::W_PAWN;
-            moves[move_count++] = Move{our_piece, (uint8_t) from, (uint8_t) to, captured, Piece::NONE, true, false};
+            moves[move_count++] = Move{our_piece, (uint8_t) from, (uint8_t) to, their_pawn, Piece::NONE, true, false};
         }
     }
 
-    //PROMOTION
+    //PROMOTION, quiescence searches every promotion so they belong to the captures as well
 
     //Pushes
-    Bitboard promo_push = shift(pawns_on_7th, UP) & empty;
+    Bitboard promo_push = shift(pawns_on_7th, UP) & push_targets;
     extract_promotion_push(promo_push, our_piece, UP, moves, move_count);
 
      // Promotion captures right
@@ -253,7 +863,8 @@ void Engine::generate_pawn_moves(const Board &board, Move* moves, int& move_coun
 
 }
 
-void Engine::generate_knight_moves(const Board &board, Piece piece, uint8_t index, Move* moves, int& move_count)
+template<Color Us, GenType Type>
+void Engine::generate_knight_moves(const Position &board, Piece piece, uint8_t index, Bitboard targets, Move* moves, int& move_count)
 {
     int startDirIndex = 8;
     int endDirIndex = 16;
@@ -266,16 +877,19 @@ void Engine::generate_knight_moves(const Board &board, Piece piece, uint8_t inde
       // Check file wrapping
       int fileDiff = (targetSquare % 8) - (index % 8);
       if (std::abs(fileDiff) > 2) continue; // illegal wrap
+      if (has_targets(Type) && (targets & (1ULL << targetSquare)) == 0) continue;
 
       Piece target_piece = board.get_piece_at(targetSquare);
 
-      if(target_piece != Piece::NONE && colorOf(target_piece) == colorOf(piece)) continue;
+      if(target_piece != Piece::NONE && colorOf(target_piece) == Us) continue;
+      if(Type == GenType::CAPTURES && target_piece == Piece::NONE) continue;
 
       moves[move_count++] = Move{piece, index, (uint8_t) targetSquare, target_piece, Piece::NONE, false, false};
      }
 }
 
-void Engine::generate_king_moves(const Board &board, Piece piece, uint8_t index, Move* moves, int& move_count)
+template<Color Us, GenType Type>
+void Engine::generate_king_moves(const Position &board, Piece piece, uint8_t index, Move* moves, int& move_count)
 {    for(int directionIndex = 0; directionIndex < 8; directionIndex++){
       int targetSquare = index + direction_offsets[directionIndex];
 
@@ -286,91 +900,71 @@ void Engine::generate_king_moves(const Board &board, Piece piece, uint8_t index,
       // Check file wrapping
       int fileDiff = (targetSquare % 8) - (index % 8);
       if (std::abs(fileDiff) > 1) continue; // illegal wrap
+
+      // Evading, the king only steps to squares the enemy does not attack
+      if constexpr (Type == GenType::EVASIONS) {
+        constexpr Color opponent = Us == Color::WHITE ? Color::BLACK : Color::WHITE;
+        if ((board.attacked_squares(opponent) & (1ULL << targetSquare)) != 0) continue;
+      }
       
       Piece target_piece = board.get_piece_at(targetSquare);
 
-      if(target_piece != Piece::NONE && colorOf(target_piece) == colorOf(piece)) continue;
+      if(target_piece != Piece::NONE && colorOf(target_piece) == Us) continue;
+      if(Type == GenType::CAPTURES && target_piece == Piece::NONE) continue;
 
       moves[move_count++] = Move{piece, index, (uint8_t)targetSquare, target_piece, Piece::NONE, false, false};
     }
 
     //Add in castle moves
-    generate_castle_moves(board, piece, index, moves,move_count);
+    if constexpr (Type == GenType::ALL) generate_castle_moves<Us>(board, moves, move_count);
 }
 
-void Engine::generate_castle_moves(const Board &board, Piece piece, uint8_t index, Move* moves, int& move_count)
-{    struct CastleInfo {
+template<Color Us>
+void Engine::generate_castle_moves(const Position &board, Move* moves, int& move_count)
+{   struct CastleInfo {
         CastlingRights right;
         int rookSquare;
-        int kingFrom;
         int kingTo;
-        std::array<int,3> emptySquares;  // squares that must be empty
-        std::array<int,3> safeSquares;   // squares that must not be attacked
+        Bitboard emptySquares;  // squares that must be empty
+        Bitboard safeSquares;   // squares that must not be attacked
     };
 
-    static const CastleInfo castleData[] = {
-        // ---- WHITE KING SIDE ----
-        { CastlingRights::WHITE_KINGSIDE, 7, 4, 6, {5,6,-1}, {4,5,6} },
-
-        // ---- WHITE QUEEN SIDE ----
-        { CastlingRights::WHITE_QUEENSIDE, 0, 4, 2, {1,2,3}, {4,3,2} },
+    // Only the two entries of our color are looked at, the king starts on e1 or e8
+    constexpr int rank = Us == Color::WHITE ? 0 : 56;
+    constexpr Piece king = Us == Color::WHITE ? Piece::W_KING : Piece::B_KING;
+    constexpr Piece rook = Us == Color::WHITE ? Piece::W_ROOK : Piece::B_ROOK;
+    constexpr Color opponent = Us == Color::WHITE ? Color::BLACK : Color::WHITE;
 
-        // ---- BLACK KING SIDE ----
-        { CastlingRights::BLACK_KINGSIDE, 63, 60, 62, {61,62,-1}, {60,61,62} },
+    static constexpr CastleInfo castleData[] = {
+        // ---- KING SIDE ----
+        { Us == Color::WHITE ? CastlingRights::WHITE_KINGSIDE : CastlingRights::BLACK_KINGSIDE, rank + 7, rank + 6,
+          0x60ULL << rank, 0x70ULL << rank },
 
-        // ---- BLACK QUEEN SIDE ----
-        { CastlingRights::BLACK_QUEENSIDE, 56, 60, 58, {57,58,59}, {60,59,58} }
+        // ---- QUEEN SIDE ----
+        { Us == Color::WHITE ? CastlingRights::WHITE_QUEENSIDE : CastlingRights::BLACK_QUEENSIDE, rank, rank + 2,
+          0x0EULL << rank, 0x1CULL << rank }
     };
 
-    Color color = colorOf(piece);
-    Color opponent = (color == Color::WHITE ? Color::BLACK : Color::WHITE);
-
     for (const auto& cs : castleData) {
 
-        // Determine the color of this castling right
-        Color castleColor = (cs.right == CastlingRights::WHITE_KINGSIDE || 
-                            cs.right == CastlingRights::WHITE_QUEENSIDE) 
-                            ? Color::WHITE : Color::BLACK;
-
-        // Skip if colors don't match
-        if (castleColor != color) continue;
-
-
         // 1. Check castling right flag
         if (!board.can_castle(cs.right)) {
             continue;
         }
 
         // 2. Rook must still be there
-        auto rook = board.get_piece_at(cs.rookSquare);
-        if (rook == Piece::NONE) {
-            continue;
-        }
+        if ((board.get_piece_bitboard(rook) & (1ULL << cs.rookSquare)) == 0) continue;
 
         // 3. Squares must be empty
-        bool empty_ok = true;
-        for (int sq : cs.emptySquares) {
-            if (sq != -1 && board.get_piece_at(sq) != Piece::NONE) {
-                empty_ok = false;
-                break;
-            }
-        }
-        if (!empty_ok) continue;
-
-        // 4. King cannot pass through attacked squares
-        bool safe_ok = true;
-        for (int sq : cs.safeSquares) {
-            if (sq != -1 && board.is_square_attacked(sq, opponent)) {
-                safe_ok = false;
-                break;
-            }
-        }
-        if (!safe_ok) continue;
+        if ((board.occupancy & cs.emptySquares) != 0) continue;
+
+        // 4. King cannot pass through attacked squares, read from the cached attack map
+        if ((board.attacked_squares(opponent) & cs.safeSquares) != 0) continue;
 
         // 5. Add castling move
         moves[move_count++] = Move{
-            board.get_piece_at(cs.kingFrom),
-            (uint8_t)cs.kingFrom,
+            king,
+            (uint8_t)(rank + 4),
             (uint8_t)cs.kingTo,
             Piece::NONE,
             Piece::NONE,
@@ -404,7 +998,7 @@ void Engine::extract_pawn_push(Bitboard bb, Piece piece, int shift, Move* moves,
     }
 }
 
-void Engine::extract_pawn_capture(Bitboard bb, Piece piece, int shift, Move *moves, int &move_count, const Board &board)
+void Engine::extract_pawn_capture(Bitboard bb, Piece piece, int shift, Move *moves, int &move_count, const Position &board)
 {
     while(bb != 0ULL){
         int to = std::countr_zero(bb);
@@ -443,7 +1037,7 @@ void Engine::extract_promotion_push(Bitboard bb, Piece piece, int shift, Move *m
     }
 }
 
-void Engine::extract_promotion_capture(Bitboard bb, Piece piece, int shift, Move *moves, int &move_count, const Board &board)
+void Engine::extract_promotion_capture(Bitboard bb, Piece piece, int shift, Move *moves, int &move_count, const Position &board)
 {
     Color us = colorOf(piece);
     Piece queen = (us == Color::WHITE) ? Piece::W_QUEEN : Piece::B_QUEEN;
@@ -463,3 +1057,110 @@ void Engine::extract_promotion_capture(Bitboard bb, Piece piece, int shift, Move
         moves[move_count++] = Move{piece, (uint8_t)from, (uint8_t) to, capture, knight, false, false};
     }
 }
+
+int Engine::quiet_line(Board &board, Move *line, int &score)
+{
+    int line_length = 0;
+    score = quiescence_line(board, 0, -INFINITE_SCORE, INFINITE_SCORE, line, line_length);
+    return line_length;
+}
+
+//Same search as quiescence, kept separate so the search hot path does not pay for line tracking
+int Engine::quiescence_line(Board &board, int ply, int alpha, int beta, Move *line, int &line_length)
+{
+    line_length = 0;
+
+    int stand_pat = evaluate_position(board);
+    if(stand_pat >= beta || ply >= MAX_SEARCH_PLY) return stand_pat;
+    if(stand_pat > alpha) alpha = stand_pat;
+
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int scores[MAX_NUMBER_OF_MOVES];
+    int move_count = generate_captures(board, moves);
+
+    Move no_move{};
+    no_move.piece = Piece::NONE;
+    score_moves(moves, scores, move_count, no_move);
+
+    Move child_line[MAX_SEARCH_PLY];
+
+    for(int i = 0; i < move_count; i++){
+        int best_index = i;
+        for(int j = i + 1; j < move_count; j++){
+            if(scores[j] > scores[best_index]) best_index = j;
+        }
+        std::swap(moves[i], moves[best_index]);
+        std::swap(scores[i], scores[best_index]);
+
+        if(!board.is_legal(moves[i])) continue;
+        board.make_move(moves[i]);
+
+        int child_length = 0;
+        int score = -quiescence_line(board, ply + 1, -beta, -alpha, child_line, child_length);
+        board.undo_move();
+
+        if(score > alpha){
+            alpha = score;
+            line[0] = moves[i];
+            std::copy(child_line, child_line + std::min(child_length, MAX_SEARCH_PLY - 1), line + 1);
+            line_length = 1 + std::min(child_length, MAX_SEARCH_PLY - 1);
+        }
+        if(score >= beta) return score;
+    }
+
+    return alpha;
+}
+
+std::string move_to_san(Engine &engine, Board &board, const Move &move)
+{
+    static const char piece_letters[6] = {'P', 'N', 'B', 'R', 'Q', 'K'};
+    std::string uci = move_to_string(move);
+    std::string san;
+
+    if(move.is_castling){
+        san = move.to_square > move.from_square ? "O-O" : "O-O-O";
+    } else {
+        PieceType type = typeOf(static_cast<Piece>(move.piece));
+        bool capture = move.captured_piece != Piece::NONE;
+
+        if(type == PieceType::PAWN){
+            if(capture) san += uci[0];
+        } else {
+            san += piece_letters[static_cast<int>(type)];
+
+            //Disambiguate against other pieces of the same kind that can reach the same square
+            Move moves[MAX_NUMBER_OF_MOVES];
+            int count = engine.generate_legal_moves(board, moves);
+            bool ambiguous = false, same_file = false, same_rank = false;
+            for(int i = 0; i < count; i++){
+                if(moves[i].piece != move.piece || moves[i].to_square != move.to_square || moves[i].from_square == move.from_square) continue;
+                ambiguous = true;
+                if(moves[i].from_square % 8 == move.from_square % 8) same_file = true;
+                if(moves[i].from_square / 8 == move.from_square / 8) same_rank = true;
+            }
+            if(ambiguous){
+                if(!same_file) san += uci[0];
+                else if(!same_rank) san += uci[1];
+                else san += uci.substr(0, 2);
+            }
+        }
+
+        if(capture) san += 'x';
+        san += uci.substr(2, 2);
+
+        if(move.promoted_piece != Piece::NONE){
+            san += '=';
+            san += piece_letters[static_cast<int>(typeOf(move.promoted_piece))];
+        }
+    }
+
+    Move played = move;
+    board.make_move(played);
+    if(board.is_in_check(board.sideToMove)){
+        Move replies[MAX_NUMBER_OF_MOVES];
+        san += engine.generate_legal_moves(board, replies) == 0 ? '#' : '+';
+    }
+    board.undo_move();
+
+    return san;
+}
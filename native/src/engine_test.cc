@@ -1,6 +1,22 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <engine.h>
 #include <board.h>
+#include <nnue.h>
+#include <book.h>
+#include <tablebase.h>
+#include <egtb.h>
+#include <bitbase.h>
+#include <mate.h>
+#include <pgn.h>
+#include <stats.h>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <cstdlib>
 
 class EngineTestFixture : public ::testing::Test {
     protected:
@@ -67,6 +83,158 @@ TEST_F(EngineTestFixture, PerfSix){
     std::cout << "Depth: 6, Moves: " << result << std::endl;
 }
 
+TEST_F(EngineTestFixture, CopyMakePerftMatchesMakeUndo){
+    board.set_position_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    const Position& position = board.get_position();
+
+    EXPECT_EQ(engine.perft(position, 3), 97862u);
+    EXPECT_EQ(engine.perft(board, 3), 97862u);
+    EXPECT_EQ(parallel_perft(position, 3, 4), 97862u);
+    EXPECT_EQ(parallel_perft(position, 1, 4), 48u);
+}
+
+namespace {
+    //Walks every line to the given depth and checks the incrementally kept occupancy after each make and undo
+    bool occupancy_stays_consistent(Engine& engine, Board& board, int depth){
+        Bitboard white = 0, black = 0;
+        for(int p = W_PAWN; p <= W_KING; p++) white |= board.get_piece_bitboard(static_cast<Piece>(p));
+        for(int p = B_PAWN; p <= B_KING; p++) black |= board.get_piece_bitboard(static_cast<Piece>(p));
+        if(board.white_occupancy != white || board.black_occupancy != black || board.occupancy != (white | black)) return false;
+        if(depth == 0) return true;
+
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(board, moves);
+        for(int i = 0; i < count; i++){
+            board.make_move(moves[i]);
+            bool ok = occupancy_stays_consistent(engine, board, depth - 1);
+            board.undo_move();
+            if(!ok) return false;
+        }
+        return true;
+    }
+}
+
+TEST_F(EngineTestFixture, IncrementalOccupancyMatchesPieces){
+    //Castling both ways, en passant, promotions with and without capture
+    for(const char* fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                           "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+                           "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"}){
+        board.set_position_fen(fen);
+        EXPECT_TRUE(occupancy_stays_consistent(engine, board, 3)) << fen;
+    }
+}
+
+TEST_F(EngineTestFixture, CaptureGenerationMatchesFilteredMoves){
+    for(const char* fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                           "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+                           "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+                           "8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1"}){
+        board.set_position_fen(fen);
+
+        Move all[MAX_NUMBER_OF_MOVES], captures[MAX_NUMBER_OF_MOVES];
+        int all_count = engine.generate_psuedo_legal_moves(board, all);
+        int capture_count = engine.generate_captures(board, captures);
+
+        std::vector<std::string> expected, generated;
+        for(int i = 0; i < all_count; i++){
+            if(all[i].captured_piece != Piece::NONE || all[i].promoted_piece != Piece::NONE) expected.push_back(move_to_string(all[i]));
+        }
+        for(int i = 0; i < capture_count; i++) generated.push_back(move_to_string(captures[i]));
+
+        EXPECT_EQ(generated, expected) << fen;
+    }
+}
+
+namespace {
+    //Legal moves by playing every pseudo-legal move on a copy, the reference the generators are checked against
+    std::vector<std::string> legal_by_copy_make(Engine& engine, const Position& position){
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_psuedo_legal_moves(position, moves);
+
+        std::vector<std::string> legal;
+        for(int i = 0; i < count; i++){
+            Position child = position;
+            child.apply_move(moves[i]);
+            if(!child.is_in_check(position.sideToMove)) legal.push_back(move_to_string(moves[i]));
+        }
+        std::sort(legal.begin(), legal.end());
+        return legal;
+    }
+}
+
+TEST_F(EngineTestFixture, EvasionsAnswerEveryCheck){
+    for(const char* fen : {"4k3/8/8/8/1b6/P7/8/RN2K2R w KQ - 0 1",          //bishop check, block or capture
+                           "4k3/8/8/8/8/5n2/3P4/R3K2r w Q - 0 1",          //double check, king moves only
+                           "8/8/8/2k5/3Pp3/8/8/7K b - d3 0 1",             //en passant takes the checking pawn
+                           "8/8/8/3k4/4Pp2/8/8/4K3 b - e3 0 1",             //the same, from the other side
+                           "r3k2r/p1pp1pb1/bn2Qnp1/2qPN3/1p2P3/2N4p/PPPBBPPP/R3K2R b KQkq - 0 1",
+                           "3k4/8/8/8/8/8/3q4/4K3 w - - 0 1"}){
+        board.set_position_fen(fen);
+        ASSERT_NE(board.checkers(), 0ULL) << fen;
+
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(board.get_position(), moves);
+        std::vector<std::string> generated;
+        for(int i = 0; i < count; i++) generated.push_back(move_to_string(moves[i]));
+        std::sort(generated.begin(), generated.end());
+
+        EXPECT_EQ(generated, legal_by_copy_make(engine, board.get_position())) << fen;
+    }
+
+    //Double check leaves the king as the only piece to move
+    board.set_position_fen("4k3/8/8/8/8/5n2/3P4/R3K2r w Q - 0 1");
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int count = engine.generate_evasions(board.get_position(), moves);
+    for(int i = 0; i < count; i++) EXPECT_EQ(moves[i].piece, Piece::W_KING);
+}
+
+namespace {
+    //Compares gives_check and generate_checks with playing every legal move, over every position to the given depth
+    void expect_checks_match_copy_make(Engine& engine, const Position& position, int depth){
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(position, moves);
+
+        std::vector<std::string> expected;
+        for(int i = 0; i < count; i++){
+            Position child = position;
+            child.apply_move(moves[i]);
+            bool checks = child.is_in_check(child.sideToMove);
+            ASSERT_EQ(position.gives_check(moves[i]), checks) << position.getFen() << " " << move_to_string(moves[i]);
+            if(checks) expected.push_back(move_to_string(moves[i]));
+        }
+
+        //Pseudo-legal king steps next to the other king would count as checks, so compare legal moves only
+        Move checks[MAX_NUMBER_OF_MOVES];
+        int check_count = engine.generate_checks(position, checks);
+        std::vector<std::string> generated;
+        for(int i = 0; i < check_count; i++){
+            if(position.is_legal(checks[i])) generated.push_back(move_to_string(checks[i]));
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(generated.begin(), generated.end());
+        ASSERT_EQ(generated, expected) << position.getFen();
+
+        if(depth == 1) return;
+        for(int i = 0; i < count; i++){
+            Position child = position;
+            child.apply_move(moves[i]);
+            expect_checks_match_copy_make(engine, child, depth - 1);
+        }
+    }
+}
+
+TEST_F(EngineTestFixture, ChecksMatchCopyMake){
+    //Discoveries, promotions, castling into check and en passant checks all appear within a few plies
+    for(const char* fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                           "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+                           "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                           "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+                           "4k3/8/8/2KPp2r/8/8/8/8 w - e6 0 1"}){
+        board.set_position_fen(fen);
+        expect_checks_match_copy_make(engine, board.get_position(), 3);
+    }
+}
+
 TEST_F(EngineTestFixture, PerftPosition2){
     board.set_position_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
     board.print_board(std::cout);
@@ -305,3 +473,1030 @@ TEST(EngineEvaluationTest, NoPanicOnEmptySquares) {
 
 
 
+
+/*
+ * =============================================================================
+ * SEARCH TESTS
+ * =============================================================================
+ */
+
+TEST(EngineSearchTest, FindsMateInOne) {
+    Board board;
+    Engine engine;
+
+    // Back rank mate: Ra8#
+    board.set_position_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+
+    SearchResult result = engine.search(board, 3);
+
+    EXPECT_EQ(move_to_string(result.best_move), "a1a8");
+    EXPECT_EQ(result.score, MATE_SCORE - 1);
+    EXPECT_EQ(board.getFen(), "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1") << "Search should restore the board";
+}
+
+TEST(EngineSearchTest, TellsOnlyMovesApart) {
+    Board board;
+    Engine engine;
+
+    // Scholar's mate: only Qxf7# wins, every other move leaves white about even
+    board.set_position_fen("r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
+    SearchResult result = engine.search(board, 4);
+    ASSERT_EQ(move_to_string(result.best_move), "h5f7");
+    EXPECT_FALSE(engine.other_move_reaches(board, result.best_move, 4, 200));
+    EXPECT_EQ(board.getFen(), "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4");
+
+    // A rook up, the mate is not the only winning move
+    board.set_position_fen("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1");
+    result = engine.search(board, 4);
+    EXPECT_TRUE(engine.other_move_reaches(board, result.best_move, 4, 200));
+}
+
+TEST(EngineSearchTest, WinsHangingQueen) {
+    Board board;
+    Engine engine;
+
+    board.set_position_fen("rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 1");
+
+    SearchResult result = engine.search(board, 2);
+
+    EXPECT_EQ(move_to_string(result.best_move), "f3h4");
+    EXPECT_GT(result.score, 500);
+}
+
+TEST(EngineSearchTest, QuietLineResolvesCaptures) {
+    Board board;
+    Engine engine;
+
+    const std::string fen = "rnb1kbnr/pppp1ppp/8/4p3/4P2q/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 1";
+    board.set_position_fen(fen);
+
+    Move line[MAX_SEARCH_PLY];
+    int score = 0;
+    int length = engine.quiet_line(board, line, score);
+
+    ASSERT_GE(length, 1);
+    EXPECT_EQ(move_to_string(line[0]), "f3h4");
+    EXPECT_GT(score, 500);
+    EXPECT_EQ(board.getFen(), fen) << "quiet_line should restore the board";
+
+    // The score is the static evaluation of the position at the end of the line
+    for(int i = 0; i < length; i++) board.make_move(line[i]);
+    int leaf = engine.evaluate_position(board);
+    EXPECT_EQ(length % 2 == 0 ? leaf : -leaf, score);
+}
+
+TEST(EngineSearchTest, TimeLimitStopsSearch) {
+    Board board;
+    Engine engine;
+
+    board.set_position_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+    auto start = std::chrono::steady_clock::now();
+    SearchResult result = engine.search(board, MAX_SEARCH_PLY, 50);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_LT(elapsed, 1000);
+    EXPECT_GE(result.depth, 1);
+    EXPECT_LT(result.depth, MAX_SEARCH_PLY);
+    EXPECT_NE(result.best_move.piece, Piece::NONE);
+    EXPECT_EQ(board.getFen(), "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+}
+
+TEST(EngineSearchTest, SanNotation) {
+    Board board;
+    Engine engine;
+
+    auto san_of = [&](const std::string& fen, const std::string& uci){
+        board.set_position_fen(fen);
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(board, moves);
+        for(int i = 0; i < count; i++){
+            if(move_to_string(moves[i]) == uci) return move_to_san(engine, board, moves[i]);
+        }
+        return std::string("illegal");
+    };
+
+    EXPECT_EQ(san_of("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "g1f3"), "Nf3");
+    EXPECT_EQ(san_of("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2", "e4d5"), "exd5");
+    EXPECT_EQ(san_of("4k3/8/8/8/8/5N2/8/1N2K3 w - - 0 1", "b1d2"), "Nbd2");
+    EXPECT_EQ(san_of("4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1", "e1g1"), "O-O");
+    EXPECT_EQ(san_of("4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1", "e1c1"), "O-O-O");
+    EXPECT_EQ(san_of("8/3P4/8/8/8/8/8/k3K3 w - - 0 1", "d7d8q"), "d8=Q");
+    EXPECT_EQ(san_of("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", "a1a8"), "Ra8#");
+    EXPECT_EQ(san_of("4k3/8/8/8/R7/8/8/R3K3 w - - 0 1", "a1a2"), "R1a2");
+}
+
+TEST(EngineSearchTest, RepetitionScoredAsDraw) {
+    Board board;
+    Engine engine;
+
+    // White is a queen down, but Nf3 repeats a position from the game so far
+    board.set_position_fen("4k2q/8/8/8/8/8/8/4K1N1 w - - 0 1");
+    Move out = {Piece::W_KNIGHT, 6, 21, Piece::NONE, Piece::NONE, false, false};
+    Move back = {Piece::W_KNIGHT, 21, 6, Piece::NONE, Piece::NONE, false, false};
+    Move king_out = {Piece::B_KING, 60, 59, Piece::NONE, Piece::NONE, false, false};
+    Move king_back = {Piece::B_KING, 59, 60, Piece::NONE, Piece::NONE, false, false};
+    board.make_move(out);
+    board.make_move(king_out);
+    board.make_move(back);
+    board.make_move(king_back);
+
+    SearchResult result = engine.search(board, 4);
+
+    EXPECT_EQ(result.score, 0);
+    EXPECT_EQ(move_to_string(result.best_move), "g1f3");
+}
+
+TEST(EngineSearchTest, NoMovesInCheckmate) {
+    Board board;
+    Engine engine;
+
+    // Fool's mate, white is mated
+    board.set_position_fen("rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3");
+
+    SearchResult result = engine.search(board, 3);
+
+    EXPECT_EQ(result.best_move.piece, Piece::NONE);
+    EXPECT_EQ(result.score, -MATE_SCORE);
+}
+
+TEST(EngineEvaluationTest, KingCentralizationInEndgame) {
+    Board board;
+    Engine engine;
+
+    // Pawn endgame: the centralized king should be preferred
+    board.set_position_fen("7k/pp6/8/8/3K4/8/PP6/8 w - - 0 1");
+    int central = engine.evaluate_position(board);
+
+    board.set_position_fen("7k/pp6/8/8/8/8/PP6/K7 w - - 0 1");
+    int corner = engine.evaluate_position(board);
+
+    EXPECT_GT(central, corner);
+
+    // With all the pieces on the board the king still wants to stay home
+    board.set_position_fen("rnbq1bnr/pppppppp/8/4k3/8/8/PPPPPPPP/RNBQKBNR w KQ - 0 1");
+    EXPECT_GT(engine.evaluate_position(board), 0);
+}
+
+TEST(EngineEvaluationTest, PawnStructurePenalties) {
+    Board board;
+    Engine engine;
+
+    // White has doubled, isolated c-pawns, black has a healthy chain
+    board.set_position_fen("4k3/1pp5/8/8/8/2P5/2P5/4K3 w - - 0 1");
+    int doubled = engine.evaluate_position(board);
+
+    board.set_position_fen("4k3/1pp5/8/8/8/8/1PP5/4K3 w - - 0 1");
+    int healthy = engine.evaluate_position(board);
+
+    EXPECT_LT(doubled, healthy);
+}
+
+TEST(EngineEvaluationTest, PassedPawnBonus) {
+    Board board;
+    Engine engine;
+
+    // Same material, but white's a-pawn on the 6th is passed
+    board.set_position_fen("4k3/7p/P7/8/8/8/8/4K3 w - - 0 1");
+    int passed = engine.evaluate_position(board);
+
+    board.set_position_fen("4k3/1p6/P7/8/8/8/8/4K3 w - - 0 1");
+    int blocked = engine.evaluate_position(board);
+
+    EXPECT_GT(passed, blocked);
+}
+
+TEST(EngineEvaluationTest, PawnHashMatchesFreshEvaluation) {
+    Board board;
+    Engine engine;
+
+    board.set_position_fen("r1bqkbnr/pp1ppppp/2n5/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int count = engine.generate_legal_moves(board, moves);
+
+    // The pawn key must follow every move so cached entries always match a fresh evaluation
+    for(int i = 0; i < count; i++){
+        board.make_move(moves[i]);
+        EXPECT_EQ(board.compute_pawn_key(), board.pawn_key);
+        EXPECT_EQ(engine.evaluate_position(board), Engine().evaluate_position(board));
+        board.undo_move();
+    }
+}
+
+TEST(EngineEvaluationTest, EvalCacheMatchesFreshEvaluation) {
+    Board board;
+    Engine engine;
+
+    board.set_position_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    reset_search_stats();
+    int first = engine.evaluate_position(board);
+    int second = engine.evaluate_position(board);
+    EXPECT_EQ(first, second);
+
+    SearchStats stats = get_search_stats();
+    if(stats_enabled){
+        EXPECT_EQ(stats.eval_cache_probes, 2u);
+        EXPECT_EQ(stats.eval_cache_hits, 1u);
+    }
+
+    // A search fills the cache, afterwards cached scores must still match a fresh engine
+    engine.search(board, 3);
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int count = engine.generate_legal_moves(board, moves);
+    for(int i = 0; i < count; i++){
+        board.make_move(moves[i]);
+        EXPECT_EQ(engine.evaluate_position(board), Engine().evaluate_position(board));
+        board.undo_move();
+    }
+}
+
+/*
+ * =============================================================================
+ * NNUE TESTS
+ * =============================================================================
+ */
+
+// Writes a network with small random weights so accumulator sums never overflow
+static std::string write_random_network(const std::string& name){
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream out(path, std::ios::binary);
+    std::mt19937 rng(1234);
+
+    auto write_values = [&](auto type_tag, size_t count, int range){
+        using T = decltype(type_tag);
+        std::uniform_int_distribution<int> dist(-range, range);
+        for(size_t i = 0; i < count; i++){
+            T value = static_cast<T>(dist(rng));
+            out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    };
+
+    uint32_t header[2] = {NNUE_MAGIC, NNUE_VERSION};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    write_values(int16_t{}, NNUE_HIDDEN, 64);
+    write_values(int16_t{}, static_cast<size_t>(NNUE_INPUTS) * NNUE_HIDDEN, 16);
+    write_values(int32_t{}, NNUE_L1, 1000);
+    write_values(int8_t{}, NNUE_L1 * 2 * NNUE_HIDDEN, 64);
+    write_values(int32_t{}, NNUE_L2, 1000);
+    write_values(int8_t{}, NNUE_L2 * NNUE_L1, 64);
+    write_values(int32_t{}, 1, 1000);
+    write_values(int8_t{}, NNUE_L2, 64);
+    return path;
+}
+
+static bool accumulator_matches_refresh(const Board& board){
+    nnue::Accumulator fresh;
+    nnue::refresh(fresh, board);
+    return std::memcmp(fresh.values, board.accumulator.values, sizeof(fresh.values)) == 0;
+}
+
+// Walks every line to the given depth checking the incremental accumulator against a refresh after make and undo
+static void check_accumulator_tree(Engine& engine, Board& board, int depth){
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int count = engine.generate_legal_moves(board, moves);
+
+    for(int i = 0; i < count; i++){
+        board.make_move(moves[i]);
+        ASSERT_TRUE(accumulator_matches_refresh(board)) << board.getFen() << " after " << move_to_string(moves[i]);
+        if(depth > 1) check_accumulator_tree(engine, board, depth - 1);
+        board.undo_move();
+        ASSERT_TRUE(accumulator_matches_refresh(board)) << board.getFen() << " after undoing " << move_to_string(moves[i]);
+    }
+}
+
+TEST(NnueTest, IncrementalAccumulatorMatchesRefresh) {
+    std::string path = write_random_network("dart_chess_test.nnue");
+    ASSERT_TRUE(nnue::load_network(path));
+
+    Engine engine;
+    // Castling both ways, en passant, promotions with and without capture, king bucket changes
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    };
+
+    for(const char* fen : fens){
+        Board board;
+        board.set_position_fen(fen);
+        engine.evaluate_position(board); // refreshes the stale accumulator
+        check_accumulator_tree(engine, board, 3);
+    }
+
+    nnue::unload_network();
+    std::filesystem::remove(path);
+}
+
+TEST(NnueTest, EvaluationUsesNetworkAndFallsBack) {
+    Board board;
+    Engine engine;
+    board.set_position_fen("r1bqkbnr/pp1ppppp/2n5/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    int pst_score = engine.evaluate_position(board);
+
+    std::string path = write_random_network("dart_chess_eval_test.nnue");
+    ASSERT_TRUE(nnue::load_network(path));
+    EXPECT_EQ(board.accumulator.network_id, 0u) << "Accumulator should be stale until first evaluation";
+
+    int nnue_score = engine.evaluate_position(board);
+    EXPECT_EQ(board.accumulator.network_id, nnue::network_id());
+    EXPECT_EQ(nnue_score, engine.evaluate_position(board));
+
+    // Reloading makes the accumulator stale again, the next evaluation refreshes it
+    ASSERT_TRUE(nnue::load_network(path));
+    EXPECT_NE(board.accumulator.network_id, nnue::network_id());
+    EXPECT_EQ(engine.evaluate_position(board), nnue_score);
+
+    nnue::unload_network();
+    EXPECT_FALSE(nnue::is_loaded());
+    EXPECT_EQ(engine.evaluate_position(board), pst_score);
+    std::filesystem::remove(path);
+}
+
+TEST(NnueTest, RejectsBadNetworkFiles) {
+    EXPECT_FALSE(nnue::load_network("/nonexistent/dart_chess.nnue"));
+
+    std::string path = (std::filesystem::temp_directory_path() / "dart_chess_bad.nnue").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        uint32_t header[2] = {NNUE_MAGIC, NNUE_VERSION};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header)); // truncated after the header
+    }
+    EXPECT_FALSE(nnue::load_network(path));
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        uint32_t header[2] = {0xDEADBEEF, NNUE_VERSION};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    }
+    EXPECT_FALSE(nnue::load_network(path));
+    EXPECT_FALSE(nnue::is_loaded());
+    std::filesystem::remove(path);
+}
+
+/*
+ * =============================================================================
+ * OPENING BOOK TESTS
+ * =============================================================================
+ */
+
+// Stand-in for the Polyglot Random64 table, which is not part of this repository
+static uint16_t polyglot_move(int from, int to, int promotion = 0){
+    return static_cast<uint16_t>(to | (from << 6) | (promotion << 12));
+}
+
+static void write_book(const std::string& path, std::vector<polyglot::BookEntry> entries){
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b){ return a.key < b.key; });
+    std::ofstream out(path, std::ios::binary);
+    auto write_big_endian = [&](uint64_t value, int bytes){
+        for(int i = bytes - 1; i >= 0; i--) out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+    };
+    for(const auto& entry : entries){
+        write_big_endian(entry.key, 8);
+        write_big_endian(entry.move, 2);
+        write_big_endian(entry.weight, 2);
+        write_big_endian(entry.learn, 4);
+    }
+}
+
+static void play_uci_moves(Engine& engine, Board& board, const std::string& moves){
+    std::istringstream in(moves);
+    std::string text;
+    while(in >> text){
+        Move legal[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(board, legal);
+        bool found = false;
+        for(int i = 0; i < count && !found; i++){
+            if(move_to_string(legal[i]) == text){
+                board.make_move(legal[i]);
+                found = true;
+            }
+        }
+        ASSERT_TRUE(found) << text;
+    }
+}
+
+// The test positions of the Polyglot book format, between them they use every part of the key
+TEST_F(EngineTestFixture, PolyglotKeyMatchesPublishedKeys) {
+    const std::pair<const char*, uint64_t> expected[] = {
+        {"", 0x463B96181691FC9CULL},
+        {"e2e4", 0x823C9B50FD114196ULL},
+        {"e2e4 d7d5", 0x0756B94461C50FB0ULL},
+        {"e2e4 d7d5 e4e5", 0x662FAFB965DB29D4ULL},
+        {"e2e4 d7d5 e4e5 f7f5", 0x22A48B5A8E47FF78ULL},
+        {"e2e4 d7d5 e4e5 f7f5 e1e2", 0x652A607CA3F242C1ULL},
+        {"e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00FDD303C946BDD9ULL},
+        {"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3C8123EA7B067637ULL},
+        {"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5C3F9B829B279560ULL},
+    };
+    for(const auto& [moves, key] : expected){
+        board = Board();
+        play_uci_moves(engine, board, moves);
+        EXPECT_EQ(polyglot::key(board), key) << moves;
+    }
+}
+
+TEST_F(EngineTestFixture, BookProbesAndPicksByWeight) {
+    uint64_t start_key = polyglot::key(board);
+
+    std::string path = (std::filesystem::temp_directory_path() / "dart_chess_book.bin").string();
+    write_book(path, {
+        {start_key, polyglot_move(12, 28), 3, 0},  // e2e4
+        {start_key, polyglot_move(11, 27), 1, 0},  // d2d4
+        {start_key, polyglot_move(12, 36), 50, 0}, // e2e5, not legal
+        {1, polyglot_move(12, 28), 1, 0},
+        {start_key - 1, polyglot_move(12, 28), 1, 0},
+        {start_key + 1, polyglot_move(12, 28), 1, 0},
+        {~0ULL, polyglot_move(12, 28), 1, 0},
+    });
+
+    polyglot::Book book;
+    ASSERT_TRUE(book.open(path));
+    EXPECT_EQ(book.size(), 7u);
+    EXPECT_EQ(book.probe(board).size(), 3u);
+
+    book.seed(7);
+    int e4 = 0, d4 = 0;
+    for(int i = 0; i < 400; i++){
+        Move move;
+        ASSERT_TRUE(book.pick(engine, board, move));
+        std::string text = move_to_string(move);
+        if(text == "e2e4") e4++;
+        else if(text == "d2d4") d4++;
+        else ADD_FAILURE() << "Picked " << text;
+    }
+    EXPECT_GT(d4, 0);
+    EXPECT_GT(e4, 2 * d4);
+
+    // A second book on the same file sees the same entries
+    polyglot::Book shared;
+    ASSERT_TRUE(shared.open(path));
+    EXPECT_EQ(shared.probe(board).size(), 3u);
+
+    Move move;
+    play_uci_moves(engine, board, "g1f3");
+    EXPECT_FALSE(book.pick(engine, board, move));
+
+    book.close();
+    shared.close();
+    std::filesystem::remove(path);
+}
+
+TEST_F(EngineTestFixture, BookDecodesCastlingAndPromotion) {
+    Move move;
+    board.set_position_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    ASSERT_TRUE(polyglot::decode_move(engine, board, polyglot_move(4, 7), move));
+    EXPECT_TRUE(move.is_castling);
+    EXPECT_EQ(move.to_square, 6);
+    ASSERT_TRUE(polyglot::decode_move(engine, board, polyglot_move(4, 0), move));
+    EXPECT_TRUE(move.is_castling);
+    EXPECT_EQ(move.to_square, 2);
+    EXPECT_FALSE(polyglot::decode_move(engine, board, polyglot_move(4, 5, 0) | 0x7000, move));
+
+    board.set_position_fen("8/P6k/8/8/8/8/8/K7 w - - 0 1");
+    ASSERT_TRUE(polyglot::decode_move(engine, board, polyglot_move(48, 56, 4), move));
+    EXPECT_EQ(move.promoted_piece, Piece::W_QUEEN);
+    ASSERT_TRUE(polyglot::decode_move(engine, board, polyglot_move(48, 56, 1), move));
+    EXPECT_EQ(move.promoted_piece, Piece::W_KNIGHT);
+    EXPECT_FALSE(polyglot::decode_move(engine, board, polyglot_move(48, 56), move));
+}
+
+TEST(PolyglotBookTest, RejectsMalformedFiles) {
+    polyglot::Book book;
+    EXPECT_FALSE(book.open("/nonexistent/book.bin"));
+    EXPECT_FALSE(book.is_open());
+
+    std::string path = (std::filesystem::temp_directory_path() / "dart_chess_bad_book.bin").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "not a whole entry";
+    }
+    EXPECT_FALSE(book.open(path));
+    EXPECT_EQ(book.size(), 0u);
+    std::filesystem::remove(path);
+}
+
+/*
+ * =============================================================================
+ * TABLEBASE TESTS
+ * =============================================================================
+ */
+
+// Stand-in source for up to four pieces: whoever has more queens wins, and the distance to
+// zeroing grows with the files of the winning queen and the losing king
+class QueenCountTablebase : public tablebase::Source {
+    public:
+        mutable int probes = 0;
+
+        int max_pieces() const override { return 4; }
+
+        bool probe_wdl(const Position& position, tablebase::WDL& out) const override {
+            probes++;
+            int balance = queen_balance(position);
+            out = balance > 0 ? tablebase::WDL::WIN : balance < 0 ? tablebase::WDL::LOSS : tablebase::WDL::DRAW;
+            return true;
+        }
+
+        bool probe_dtz(const Position& position, int& out) const override {
+            int balance = queen_balance(position);
+            bool white_wins = (balance > 0) == (position.sideToMove == Color::WHITE);
+            Bitboard queen = position.get_piece_bitboard(white_wins ? Piece::W_QUEEN : Piece::B_QUEEN);
+            Bitboard king = position.get_piece_bitboard(white_wins ? Piece::B_KING : Piece::W_KING);
+            int distance = 1 + std::countr_zero(queen) % 8 + std::countr_zero(king) % 8;
+            out = balance == 0 ? 0 : balance > 0 ? distance : -distance;
+            return true;
+        }
+
+    private:
+        //Queens of the side to move minus the opponent's
+        static int queen_balance(const Position& position) {
+            int white = std::popcount(position.get_piece_bitboard(Piece::W_QUEEN));
+            int black = std::popcount(position.get_piece_bitboard(Piece::B_QUEEN));
+            return position.sideToMove == Color::WHITE ? white - black : black - white;
+        }
+};
+
+TEST_F(EngineTestFixture, TablebaseCutsOffSearch) {
+    auto source = std::make_shared<QueenCountTablebase>();
+    tablebase::clear_sources();
+    tablebase::add_source(source);
+    EXPECT_EQ(tablebase::max_pieces(), 4);
+
+    // Five pieces, so the root is searched and the capture lands in the tables
+    board.set_position_fen("4k3/8/8/8/8/8/3q3P/3QK3 w - - 0 1");
+    SearchResult result = engine.search(board, 3);
+    EXPECT_EQ(result.score, TB_WIN_SCORE - 1);
+    EXPECT_EQ(result.best_move.captured_piece, Piece::B_QUEEN);
+    EXPECT_GT(source->probes, 0);
+
+    // Castling rights keep a position out of the tables
+    tablebase::WDL wdl;
+    board.set_position_fen("4k3/8/8/8/8/8/8/3QK2R w K - 0 1");
+    EXPECT_FALSE(tablebase::probe_wdl(board, wdl));
+
+    // A limit of zero turns probing off
+    source->probes = 0;
+    engine.tablebase_probe_limit = 0;
+    board.set_position_fen("4k3/8/8/8/8/8/3q3P/3QK3 w - - 0 1");
+    engine.search(board, 2);
+    EXPECT_EQ(source->probes, 0);
+
+    tablebase::clear_sources();
+    EXPECT_EQ(tablebase::max_pieces(), 0);
+}
+
+TEST_F(EngineTestFixture, TablebaseRanksRootMovesByDtz) {
+    tablebase::clear_sources();
+    tablebase::add_source(std::make_shared<QueenCountTablebase>());
+
+    // Every queen move wins, the stand-in DTZ is shortest with the queen on the a file, so Qa8
+    board.set_position_fen("8/8/8/8/8/1k6/8/K6Q w - - 0 1");
+    SearchResult result = engine.search(board, 5);
+    EXPECT_EQ(result.depth, 0);
+    EXPECT_EQ(result.score, TB_WIN_SCORE - 1);
+    EXPECT_EQ(result.best_move.piece, Piece::W_QUEEN);
+    EXPECT_EQ(result.best_move.to_square, 56);
+
+    // Being a queen down, black takes the king as far from the a file as it can get, to the c file
+    board.set_position_fen("8/8/8/8/8/1k6/8/K6Q b - - 0 1");
+    result = engine.search(board, 5);
+    EXPECT_EQ(result.score, -TB_WIN_SCORE + 1);
+    EXPECT_EQ(result.best_move.to_square % 8, 2);
+
+    tablebase::clear_sources();
+}
+
+TEST(GeneratedTablebaseTest, ParsesSignatures) {
+    egtb::Material material;
+    ASSERT_TRUE(egtb::parse_material("KvKQ", material));
+    EXPECT_EQ(material.name(), "KQvK") << "The stronger side is kept as white";
+    ASSERT_TRUE(egtb::parse_material("KPRvKR", material));
+    EXPECT_EQ(material.name(), "KRPvKR");
+    EXPECT_TRUE(material.has_pawns());
+    EXPECT_EQ(material.piece_count(), 5);
+
+    EXPECT_FALSE(egtb::parse_material("KvK", material));
+    EXPECT_FALSE(egtb::parse_material("KQK", material));
+    EXPECT_FALSE(egtb::parse_material("QvK", material));
+    EXPECT_FALSE(egtb::parse_material("KQRvKRB", material)) << "More than five pieces";
+
+    // KPvK reaches the four promotions and bare kings, which need no table
+    ASSERT_TRUE(egtb::parse_material("KPvK", material));
+    std::vector<std::string> names;
+    for(const egtb::Material& next : egtb::successors(material)) names.push_back(next.name());
+    EXPECT_EQ(names, (std::vector<std::string>{"KQvK", "KRvK", "KBvK", "KNvK"}));
+}
+
+class GeneratedTablebaseFixture : public EngineTestFixture {
+    protected:
+        static void SetUpTestSuite() {
+            directory = std::filesystem::temp_directory_path() / "dart_chess_generated_tables";
+            std::filesystem::remove_all(directory);
+            ASSERT_TRUE(egtb::generate("KRvK", directory.string(), 2, &log));
+            ASSERT_TRUE(egtb::generate("KPvK", directory.string(), 2, &log));
+        }
+
+        static void TearDownTestSuite() {
+            std::filesystem::remove_all(directory);
+        }
+
+        static inline std::filesystem::path directory;
+        static inline std::ostringstream log;
+};
+
+TEST_F(GeneratedTablebaseFixture, KnownMateDistances) {
+    // Every table KPvK reaches was written next to it
+    for(const char* name : {"KQvK", "KRvK", "KBvK", "KNvK", "KPvK"}){
+        EXPECT_TRUE(std::filesystem::exists(directory / (std::string(name) + ".dctb"))) << name;
+    }
+
+    // The longest mates are ten moves with a queen and sixteen with a rook
+    EXPECT_NE(log.str().find("KQvK: 59136 entries"), std::string::npos) << log.str();
+    EXPECT_NE(log.str().find("longest mate 10 moves"), std::string::npos) << log.str();
+    EXPECT_NE(log.str().find("longest mate 16 moves"), std::string::npos) << log.str();
+
+    egtb::GeneratedTables tables;
+    EXPECT_EQ(tables.load(directory.string()), 5);
+    EXPECT_EQ(tables.max_pieces(), 3);
+
+    auto probe = [&](const std::string& fen, tablebase::WDL expected_wdl, int expected_dtm){
+        board.set_position_fen(fen);
+        tablebase::WDL wdl;
+        int dtm;
+        ASSERT_TRUE(tables.probe_wdl(board, wdl)) << fen;
+        ASSERT_TRUE(tables.probe_dtm(board, dtm)) << fen;
+        EXPECT_EQ(wdl, expected_wdl) << fen;
+        EXPECT_EQ(dtm, expected_dtm) << fen;
+    };
+
+    probe("k7/2Q5/1K6/8/8/8/8/8 w - - 0 1", tablebase::WDL::WIN, 1);
+    probe("k7/1Q6/1K6/8/8/8/8/8 b - - 0 1", tablebase::WDL::LOSS, 0);
+    probe("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1", tablebase::WDL::DRAW, 0);   //stalemate
+    probe("8/8/8/8/8/8/1Q6/k6K b - - 0 1", tablebase::WDL::DRAW, 0);    //the queen hangs
+    probe("K7/2q5/1k6/8/8/8/8/8 b - - 0 1", tablebase::WDL::WIN, 1);    //colors swapped
+    probe("8/8/8/8/8/8/8/kB5K w - - 0 1", tablebase::WDL::DRAW, 0);
+
+    // King in front of the pawn on the sixth wins whoever moves, the rook pawn with the king in the corner draws
+    probe("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", tablebase::WDL::WIN, 11);
+    probe("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", tablebase::WDL::LOSS, -12);
+    probe("k7/8/8/8/8/8/P7/K7 w - - 0 1", tablebase::WDL::DRAW, 0);
+
+    // En passant squares are not in the tables
+    board.set_position_fen("8/8/8/8/3Pp3/8/8/K6k b - d3 0 1");
+    tablebase::WDL wdl;
+    EXPECT_FALSE(tables.probe_wdl(board, wdl));
+}
+
+TEST_F(GeneratedTablebaseFixture, SearchPlaysShortestMates) {
+    tablebase::clear_sources();
+    auto tables = std::make_shared<egtb::GeneratedTables>();
+    ASSERT_EQ(tables->load(directory.string()), 5);
+    tablebase::add_source(tables);
+
+    for(const char* fen : {"8/8/8/8/8/1k6/8/K6Q w - - 0 1", "8/8/3k4/8/8/8/8/R3K3 w - - 0 1", "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1"}){
+        board.set_position_fen(fen);
+        int dtm;
+        ASSERT_TRUE(tablebase::probe_dtm(board, dtm)) << fen;
+        ASSERT_GT(dtm, 0) << fen;
+
+        SearchResult result = engine.search(board, 4);
+        EXPECT_EQ(result.depth, 0) << fen;
+        EXPECT_EQ(result.score, TB_WIN_SCORE - 1) << fen;
+
+        // The reply is lost one move sooner, so the move keeps the shortest mate
+        board.make_move(result.best_move);
+        int after;
+        ASSERT_TRUE(tablebase::probe_dtm(board, after)) << fen;
+        EXPECT_EQ(after, -(dtm - 1)) << fen;
+    }
+
+    tablebase::clear_sources();
+}
+
+TEST(KpkBitbaseTest, MatchesGeneratedTable) {
+    namespace fs = std::filesystem;
+    fs::path directory = fs::temp_directory_path() / "dart_chess_kpk";
+    fs::remove_all(directory);
+    ASSERT_TRUE(egtb::generate("KPvK", directory.string(), 2));
+
+    egtb::GeneratedTables tables;
+    ASSERT_EQ(tables.load(directory.string()), 5);
+
+    // Every legal placement, both sides to move, against the independently generated table
+    int compared = 0;
+    for(int pawn = 8; pawn < 56; pawn++){
+        for(int white_king = 0; white_king < 64; white_king++){
+            for(int black_king = 0; black_king < 64; black_king++){
+                for(Color side : {Color::WHITE, Color::BLACK}){
+                    int wdl, moves;
+                    if(!tables.lookup({{Piece::W_PAWN, pawn}}, white_king, black_king, side, wdl, moves)) continue;
+
+                    bool white_wins = side == Color::WHITE ? wdl == 1 : wdl == 2;
+                    ASSERT_EQ(bitbase::kpk_win(white_king, pawn, black_king, side), white_wins)
+                        << "king " << white_king << " pawn " << pawn << " against " << black_king;
+                    compared++;
+                }
+            }
+        }
+    }
+    EXPECT_GT(compared, 300000);
+
+    fs::remove_all(directory);
+}
+
+TEST_F(EngineTestFixture, KpkResultsInEvaluationAndSearch) {
+    int result;
+    board.set_position_fen("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1");
+    ASSERT_TRUE(bitbase::probe_kpk(board, result));
+    EXPECT_EQ(result, -1);
+    EXPECT_LT(engine.evaluate_position(board), -400);
+
+    // Black's pawn, flipped to white's point of view
+    board.set_position_fen("8/8/8/8/4p3/4k3/8/4K3 b - - 0 1");
+    ASSERT_TRUE(bitbase::probe_kpk(board, result));
+    EXPECT_EQ(result, 1);
+
+    // Opposition holds and the rook pawn never gets out of the corner: a pawn up, but drawn
+    for(const char* fen : {"8/8/8/8/8/4k3/4P3/4K3 w - - 0 1", "k7/8/8/8/8/8/P7/K7 w - - 0 1"}){
+        board.set_position_fen(fen);
+        ASSERT_TRUE(bitbase::probe_kpk(board, result)) << fen;
+        EXPECT_EQ(result, 0) << fen;
+        EXPECT_EQ(engine.evaluate_position(board), 0) << fen;
+        EXPECT_EQ(engine.search(board, 6).score, 0) << fen;
+    }
+
+    board.set_position_fen("4k3/8/4K3/4P3/8/8/8/1R6 w - - 0 1");
+    EXPECT_FALSE(bitbase::probe_kpk(board, result));
+
+    // Pawns on the back ranks are outside the table
+    for(const char* fen : {"4P3/8/8/8/8/2k5/8/K7 w - - 0 1", "k7/8/8/8/8/8/8/K3P3 w - - 0 1", "k7/8/8/8/8/8/8/K3p3 b - - 0 1"}){
+        board.set_position_fen(fen);
+        EXPECT_FALSE(bitbase::probe_kpk(board, result)) << fen;
+    }
+}
+
+TEST(GeneratedTablebaseTest, RejectsBadFiles) {
+    namespace fs = std::filesystem;
+    fs::path directory = fs::temp_directory_path() / "dart_chess_bad_tables";
+    fs::create_directories(directory);
+
+    std::ofstream(directory / "KQvK.dctb", std::ios::binary) << "DCTB";
+    std::ofstream(directory / "KRvK.dctb", std::ios::binary) << std::string(64, 'x');
+    std::ofstream(directory / "notes.dctb", std::ios::binary) << std::string(64, 'x');
+
+    egtb::GeneratedTables tables;
+    EXPECT_EQ(tables.load(directory.string()), 0);
+    EXPECT_EQ(tables.load("/nonexistent/tables"), 0);
+    EXPECT_EQ(tables.max_pieces(), 0);
+    EXPECT_FALSE(egtb::generate("KQQQQvK", directory.string(), 1));
+
+    fs::remove_all(directory);
+}
+
+
+// Plays a mating line on a copy, false if a move is illegal or the line does not end in mate
+static bool line_ends_in_mate(Engine& engine, Position position, const std::vector<Move>& line) {
+    Move moves[MAX_NUMBER_OF_MOVES];
+    for(const Move& move : line){
+        int count = engine.generate_legal_moves(position, moves);
+        bool legal = std::any_of(moves, moves + count, [&](const Move& m){ return std::memcmp(&m, &move, sizeof(Move)) == 0; });
+        if(!legal) return false;
+        position.apply_move(move);
+    }
+    return engine.generate_legal_moves(position, moves) == 0 && position.is_in_check(position.sideToMove);
+}
+
+TEST_F(EngineTestFixture, MateSolverFindsShortestMates) {
+    mate::Solver solver(1);
+
+    board.set_position_fen("6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1");
+    mate::Result result = solver.solve(board.get_position(), 3);
+    EXPECT_EQ(result.status, mate::Status::MATE);
+    EXPECT_EQ(result.moves, 1);
+    ASSERT_EQ(result.line.size(), 1u);
+    EXPECT_EQ(move_to_string(result.line[0]), "a1a8");
+
+    // Morphy's problem, only the quiet Ra6 mates in two
+    board.set_position_fen("kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1");
+    result = solver.solve(board.get_position(), 2);
+    EXPECT_EQ(result.status, mate::Status::MATE);
+    EXPECT_EQ(result.moves, 2);
+    ASSERT_EQ(result.line.size(), 3u);
+    EXPECT_EQ(move_to_string(result.line[0]), "a1a6");
+    EXPECT_TRUE(line_ends_in_mate(engine, board.get_position(), result.line));
+
+    board.set_position_fen("8/8/8/8/8/2k5/8/K6Q w - - 0 1");
+    result = solver.solve(board.get_position(), 6);
+    EXPECT_EQ(result.status, mate::Status::MATE);
+    EXPECT_EQ(result.moves, 6);
+    EXPECT_EQ(result.line.size(), 11u);
+    EXPECT_TRUE(line_ends_in_mate(engine, board.get_position(), result.line));
+}
+
+TEST_F(EngineTestFixture, MateSolverReportsNoMateAndNodeLimit) {
+    mate::Solver solver(1);
+
+    board.set_position_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    mate::Result result = solver.solve(board.get_position(), 2);
+    EXPECT_EQ(result.status, mate::Status::NO_MATE);
+    EXPECT_TRUE(result.line.empty());
+
+    // Stalemate is not a mate, and a side without moves has none to give
+    board.set_position_fen("7k/5Q2/6K1/8/8/8/8/8 w - - 0 1");
+    result = solver.solve(board.get_position(), 1);
+    EXPECT_EQ(result.status, mate::Status::MATE);
+    board.set_position_fen("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    EXPECT_EQ(solver.solve(board.get_position(), 3).status, mate::Status::NO_MATE);
+
+    board.set_position_fen("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 0 1");
+    result = solver.solve(board.get_position(), 5, 50);
+    EXPECT_NE(result.status, mate::Status::NO_MATE);
+    solver.clear();
+    result = solver.solve(board.get_position(), 5, 50);
+    EXPECT_EQ(result.status, mate::Status::MATE); //Qxf7# is found on the first iteration
+    EXPECT_EQ(move_to_string(result.line[0]), "f3f7");
+    EXPECT_LE(result.nodes, 50u + MAX_NUMBER_OF_MOVES); //reading the line back keeps to the limit
+
+    board.set_position_fen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 1");
+    result = solver.solve(board.get_position(), 4, 200);
+    EXPECT_EQ(result.status, mate::Status::UNKNOWN);
+    EXPECT_LE(result.nodes, 201u);
+}
+
+TEST(MateSolverTest, SolvesPositionsInParallel) {
+    const char* fens[] = {
+        "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1",
+        "kbK5/pp6/1P6/8/8/8/8/R7 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "8/8/8/8/8/2k5/8/K6Q w - - 0 1",
+        "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1",
+    };
+    std::vector<Position> positions(5);
+    for(int i = 0; i < 5; i++) positions[i].set_position_fen(fens[i]);
+
+    std::vector<mate::Result> parallel = mate::solve_parallel(positions, 3, 0, 3);
+    ASSERT_EQ(parallel.size(), positions.size());
+
+    mate::Solver solver(1);
+    for(size_t i = 0; i < positions.size(); i++){
+        mate::Result single = solver.solve(positions[i], 3);
+        EXPECT_EQ(parallel[i].status, single.status) << fens[i];
+        EXPECT_EQ(parallel[i].moves, single.moves) << fens[i];
+    }
+    EXPECT_EQ(parallel[0].moves, 1);
+    EXPECT_EQ(parallel[1].moves, 2);
+    EXPECT_EQ(parallel[2].status, mate::Status::NO_MATE);
+}
+
+// Writes every event a PGN parse reports as a line of text
+class RecordingVisitor : public pgn::Visitor {
+    public:
+        std::vector<std::string> events;
+        int games = 0;
+        int moves = 0;
+
+        void begin_game() override { games++; }
+        void tag(std::string_view name, std::string_view value) override { events.push_back("tag " + std::string(name) + "=" + std::string(value)); }
+        void move(const Position&, const Move& move, int depth) override {
+            moves++;
+            events.push_back("move " + std::to_string(depth) + " " + move_to_string(move));
+        }
+        void comment(std::string_view text, int depth) override { events.push_back("comment " + std::to_string(depth) + " " + std::string(text)); }
+        void nag(int value, int depth) override { events.push_back("nag " + std::to_string(depth) + " " + std::to_string(value)); }
+        void begin_variation(int depth) override { events.push_back("( " + std::to_string(depth)); }
+        void end_variation(int depth) override { events.push_back(") " + std::to_string(depth)); }
+        void end_game(std::string_view result, bool error) override { events.push_back("end " + std::string(result) + (error ? " error" : "")); }
+};
+
+TEST(PgnTest, ReadsTagsCommentsNagsAndVariations) {
+    const char* text =
+        "[Event \"Test \\\"quoted\\\"\"]\n"
+        "[Result \"1-0\"]\n"
+        "\n"
+        "1. e4 {best by test} e5 2. Nf3 (2. f4 exf4 (2... d5) 3. Nf3) 2... Nc6 $1 3. Bb5!? ; to the end\n"
+        "a6 1-0\n"
+        "\n"
+        "[FEN \"4k3/8/8/8/8/8/8/R3K3 w Q - 0 1\"]\n"
+        "\n"
+        "1. 0-0-0 *\n";
+
+    pgn::Parser parser;
+    RecordingVisitor visitor;
+    EXPECT_EQ(parser.parse(text, visitor), 2u);
+
+    std::vector<std::string> expected = {
+        "tag Event=Test \\\"quoted\\\"", "tag Result=1-0",
+        "move 0 e2e4", "comment 0 best by test", "move 0 e7e5", "move 0 g1f3",
+        "( 1", "move 1 f2f4", "move 1 e5f4", "( 2", "move 2 d7d5", ") 2", "move 1 g1f3", ") 1",
+        "move 0 b8c6", "nag 0 1", "move 0 f1b5", "nag 0 5", "comment 0  to the end", "move 0 a7a6", "end 1-0",
+        "tag FEN=4k3/8/8/8/8/8/8/R3K3 w Q - 0 1", "move 0 e1c1", "end *",
+    };
+    EXPECT_EQ(visitor.events, expected);
+}
+
+TEST(PgnTest, DecodesSan) {
+    pgn::Parser parser;
+    Position position;
+    Move move;
+
+    position.set_position_fen("4k3/8/8/8/8/8/8/1N2KN2 w - - 0 1");
+    ASSERT_TRUE(parser.decode_san(position, "Nbd2", move));
+    EXPECT_EQ(move_to_string(move), "b1d2");
+    ASSERT_TRUE(parser.decode_san(position, "Nf1-d2", move));
+    EXPECT_EQ(move_to_string(move), "f1d2");
+    EXPECT_FALSE(parser.decode_san(position, "Nd2", move)) << "ambiguous";
+    EXPECT_FALSE(parser.decode_san(position, "Qh5", move));
+    EXPECT_FALSE(parser.decode_san(position, "Ne9", move));
+
+    position.set_position_fen("4k3/R7/8/8/8/8/8/R3K3 w - - 0 1");
+    ASSERT_TRUE(parser.decode_san(position, "R7a4+", move));
+    EXPECT_EQ(move_to_string(move), "a7a4");
+
+    position.set_position_fen("1n5k/P7/8/8/8/8/8/K7 w - - 0 1");
+    ASSERT_TRUE(parser.decode_san(position, "a8=Q+", move));
+    EXPECT_EQ(move.promoted_piece, Piece::W_QUEEN);
+    ASSERT_TRUE(parser.decode_san(position, "axb8N", move));
+    EXPECT_EQ(move_to_string(move), "a7b8n");
+    EXPECT_FALSE(parser.decode_san(position, "a8", move));
+
+    position.set_position_fen("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1");
+    ASSERT_TRUE(parser.decode_san(position, "O-O", move));
+    EXPECT_EQ(move_to_string(move), "e8g8");
+    ASSERT_TRUE(parser.decode_san(position, "0-0-0", move));
+    EXPECT_EQ(move_to_string(move), "e8c8");
+
+    position.set_position_fen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+    ASSERT_TRUE(parser.decode_san(position, "exd6", move));
+    EXPECT_TRUE(move.is_enpassant);
+}
+
+TEST(PgnTest, BadMovesEndTheirLineOnly) {
+    const char* text =
+        "1. e4 e5 (1... Ke5 2. d4) 2. Nf3 *\n"
+        "\n"
+        "1. e4 Qh4 2. d4 1-0\n"
+        "\n"
+        "[Event \"no result\"]\n"
+        "1. d4\n"
+        "[Event \"last\"]\n"
+        "1. c4";
+
+    pgn::Parser parser;
+    RecordingVisitor visitor;
+    EXPECT_EQ(parser.parse(text, visitor), 4u);
+
+    std::vector<std::string> expected = {
+        "move 0 e2e4", "move 0 e7e5", "( 1", ") 1", "move 0 g1f3", "end * error",
+        "move 0 e2e4", "end 1-0 error",
+        "tag Event=no result", "move 0 d2d4", "end ",
+        "tag Event=last", "move 0 c2c4", "end ",
+    };
+    EXPECT_EQ(visitor.events, expected);
+}
+
+TEST(PgnTest, ParsesChunksInParallel) {
+    const std::string games[] = {
+        "[Event \"a\"]\n[Result \"1-0\"]\n\n1. e4 e5 2. Bc4 Nc6 3. Qh5 Nf6 4. Qxf7# 1-0\n\n",
+        "[Event \"b\"]\r\n\r\n1. d4 {a [bracket]} d5 (1... Nf6 2. c4) 2. c4 e6 1/2-1/2\r\n\r\n",
+        "[Event \"c\"]\n[FEN \"6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1\"]\n\n1. Ra8# 1-0\n\n",
+    };
+    std::string text;
+    for(int i = 0; i < 60; i++) text += games[i % 3];
+
+    std::vector<std::string_view> pieces = pgn::split_games(text, 7);
+    EXPECT_GT(pieces.size(), 1u);
+    EXPECT_LE(pieces.size(), 7u);
+    size_t total = 0;
+    for(std::string_view piece : pieces){
+        EXPECT_EQ(piece.substr(0, 7), "[Event ");
+        total += piece.size();
+    }
+    EXPECT_EQ(total, text.size());
+
+    pgn::Parser parser;
+    RecordingVisitor serial;
+    EXPECT_EQ(parser.parse(text, serial), 60u);
+
+    std::vector<RecordingVisitor> visitors(7);
+    EXPECT_EQ(pgn::parse_parallel(text, 3, 7, [&](int piece) -> pgn::Visitor& { return visitors[piece]; }), 60u);
+    std::vector<std::string> events;
+    int moves = 0;
+    for(const RecordingVisitor& visitor : visitors){
+        events.insert(events.end(), visitor.events.begin(), visitor.events.end());
+        moves += visitor.moves;
+    }
+    EXPECT_EQ(moves, serial.moves);
+    EXPECT_EQ(events, serial.events);
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "dart_chess_games.pgn";
+    std::ofstream(path, std::ios::binary) << text;
+    RecordingVisitor from_file;
+    EXPECT_EQ(pgn::parse_file(path.string(), from_file), 60);
+    EXPECT_EQ(from_file.events, serial.events);
+    std::vector<RecordingVisitor> file_visitors(4);
+    EXPECT_EQ(pgn::parse_file_parallel(path.string(), 2, 4, [&](int piece) -> pgn::Visitor& { return file_visitors[piece]; }), 60);
+    std::filesystem::remove(path);
+
+    RecordingVisitor missing;
+    EXPECT_EQ(pgn::parse_file("/nonexistent/games.pgn", missing), -1);
+}
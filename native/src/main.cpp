@@ -1,13 +1,218 @@
 #include <iostream>
+#include <sstream>
+#include <algorithm>
 #include <board.h>
+#include <engine.h>
+#include <stats.h>
+#include <nnue.h>
+#include <book.h>
+#include <tablebase.h>
+#include <egtb.h>
+#include <mate.h>
 
-int main(){
-    std::cout << "Hello World" << std::endl;
+static const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+//Finds the legal move matching a uci string like e2e4 or e7e8q, returns false if there is none
+static bool parse_move(Engine& engine, Board& board, const std::string& text, Move& out){
+    Move moves[MAX_NUMBER_OF_MOVES];
+    int count = engine.generate_legal_moves(board, moves);
+
+    for(int i = 0; i < count; i++){
+        if(move_to_string(moves[i]) == text){
+            out = moves[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// position startpos [moves ...]
+// position fen <6 fields> [moves ...]
+static void handle_position(Engine& engine, Board& board, std::istringstream& args){
+    std::string token;
+    args >> token;
+
+    board = Board();
+    if(token == "fen"){
+        std::string fen, field;
+        for(int i = 0; i < 6 && args >> field; i++){
+            fen += (i > 0 ? " " : "") + field;
+        }
+        board.set_position_fen(fen);
+    } else {
+        board.set_position_fen(START_FEN);
+    }
+
+    args >> token; //"moves", if present
+    while(args >> token){
+        Move move;
+        if(!parse_move(engine, board, token, move)){
+            std::cout << "info string illegal move " << token << std::endl;
+            return;
+        }
+        board.make_move(move);
+    }
+}
+
+static void print_stats(){
+    if(!stats_enabled){
+        std::cout << "stats unavailable, rebuild with -DCHESS_STATS=ON" << std::endl;
+        return;
+    }
+
+    SearchStats stats = get_search_stats();
+    double first_move_rate = stats.beta_cutoffs == 0 ? 0.0 : 100.0 * stats.first_move_cutoffs / stats.beta_cutoffs;
+    double tt_hit_rate = stats.tt_probes == 0 ? 0.0 : 100.0 * stats.tt_hits / stats.tt_probes;
+    double pawn_hit_rate = stats.pawn_table_probes == 0 ? 0.0 : 100.0 * stats.pawn_table_hits / stats.pawn_table_probes;
+    double eval_hit_rate = stats.eval_cache_probes == 0 ? 0.0 : 100.0 * stats.eval_cache_hits / stats.eval_cache_probes;
+    double tablebase_hit_rate = stats.tablebase_probes == 0 ? 0.0 : 100.0 * stats.tablebase_hits / stats.tablebase_probes;
+
+    std::cout << "make_move calls:        " << stats.make_move_calls << "\n"
+              << "undo_move calls:        " << stats.undo_move_calls << "\n"
+              << "illegal moves rejected: " << stats.illegal_moves_rejected << "\n"
+              << "is_square_attacked:     " << stats.square_attacked_calls << "\n"
+              << "tt probes / hits:       " << stats.tt_probes << " / " << stats.tt_hits << " (" << tt_hit_rate << "%)\n"
+              << "beta cutoffs:           " << stats.beta_cutoffs << "\n"
+              << "first move cutoffs:     " << stats.first_move_cutoffs << " (" << first_move_rate << "%)\n"
+              << "pawn table probes/hits: " << stats.pawn_table_probes << " / " << stats.pawn_table_hits << " (" << pawn_hit_rate << "%)\n"
+              << "eval cache probes/hits: " << stats.eval_cache_probes << " / " << stats.eval_cache_hits << " (" << eval_hit_rate << "%)\n"
+              << "tablebase probes/hits:  " << stats.tablebase_probes << " / " << stats.tablebase_hits << " (" << tablebase_hit_rate << "%)" << std::endl;
+}
 
+int main(){
     Board board = Board();
-    board.set_position_fen("rnbqkbnr/pp1ppppp/8/2p5/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2");
+    Engine engine = Engine();
+    polyglot::Book book;
+    bool own_book = false;
+    std::string line;
+
+    while(std::getline(std::cin, line)){
+        std::istringstream args(line);
+        std::string command;
+        args >> command;
+
+        try {
+            if(command == "uci"){
+                std::cout << "id name Dart-Chess\n"
+                          << "option name EvalFile type string default <empty>\n"
+                          << "option name OwnBook type check default false\n"
+                          << "option name BookFile type string default <empty>\n"
+                          << "option name TablebasePath type string default <empty>\n"
+                          << "option name TablebaseProbeLimit type spin default 7 min 0 max 7\n"
+                          << "uciok" << std::endl;
+            } else if(command == "setoption"){
+                // setoption name EvalFile value <path>
+                std::string token, name, value;
+                args >> token >> name >> token;
+                std::getline(args >> std::ws, value);
+
+                if(name == "EvalFile"){
+                    bool loaded = nnue::load_network(value);
+                    std::cout << "info string " << (loaded ? "loaded network " : "failed to load network ") << value << std::endl;
+                } else if(name == "OwnBook"){
+                    own_book = value == "true";
+                } else if(name == "BookFile"){
+                    bool opened = book.open(value);
+                    std::cout << "info string " << (opened ? "opened book " : "failed to open book ") << value << std::endl;
+                } else if(name == "TablebasePath"){
+                    // A directory of .dctb tables written by tools/tbgen
+                    auto tables = std::make_shared<egtb::GeneratedTables>();
+                    int loaded = tables->load(value);
+                    if(loaded > 0) tablebase::add_source(tables);
+                    std::cout << "info string loaded " << loaded << " generated tables, up to " << tables->max_pieces() << " pieces" << std::endl;
+                } else if(name == "TablebaseProbeLimit"){
+                    // Most pieces at which the generated tables are probed, 0 turns probing off
+                    engine.tablebase_probe_limit = std::clamp(std::stoi(value), 0, 7);
+                }
+            } else if(command == "isready"){
+                std::cout << "readyok" << std::endl;
+            } else if(command == "ucinewgame"){
+                board = Board();
+                engine.clear_transposition_table();
+            } else if(command == "position"){
+                handle_position(engine, board, args);
+            } else if(command == "go"){
+                // go [depth N] [movetime MS] [wtime MS btime MS winc MS binc MS]
+                std::string token;
+                int depth = 0;
+                int movetime = 0;
+                int time_left[2] = {0, 0};
+                int increment[2] = {0, 0};
+                while(args >> token){
+                    if(token == "depth") args >> depth;
+                    else if(token == "movetime") args >> movetime;
+                    else if(token == "wtime") args >> time_left[0];
+                    else if(token == "btime") args >> time_left[1];
+                    else if(token == "winc") args >> increment[0];
+                    else if(token == "binc") args >> increment[1];
+                }
+
+                //With a clock, spend a slice of the remaining time and search as deep as it allows
+                int side = static_cast<int>(board.sideToMove);
+                if(movetime == 0 && time_left[side] > 0){
+                    movetime = std::max(1, time_left[side] / 30 + increment[side] * 3 / 4);
+                    movetime = std::min(movetime, std::max(1, time_left[side] - 50));
+                }
+                if(depth == 0) depth = movetime > 0 ? MAX_SEARCH_PLY : 5;
+
+                Move book_move;
+                if(own_book && book.pick(engine, board, book_move)){
+                    std::cout << "info string book move" << std::endl;
+                    std::cout << "bestmove " << move_to_string(book_move) << std::endl;
+                    continue;
+                }
+
+                SearchResult result = engine.search(board, depth, movetime);
+                std::cout << "info depth " << result.depth << " score cp " << result.score << " nodes " << result.nodes << std::endl;
+                std::cout << "bestmove " << (result.best_move.piece == Piece::NONE ? "0000" : move_to_string(result.best_move)) << std::endl;
+            } else if(command == "perft"){
+                // perft N [threads T]
+                int depth = 1;
+                int threads = 0;
+                std::string token;
+                args >> depth;
+                if(args >> token && token == "threads") args >> threads;
+
+                if(threads > 0){
+                    std::cout << "Nodes searched: " << parallel_perft(board.get_position(), depth, threads) << std::endl;
+                } else {
+                    engine.perft_divide(board, depth);
+                }
+            } else if(command == "mate"){
+                // mate N [nodes X]
+                int moves = 1;
+                uint64_t nodes = 0;
+                std::string token;
+                args >> moves;
+                if(args >> token && token == "nodes") args >> nodes;
 
-    board.print_board(std::cout);
+                mate::Solver solver;
+                mate::Result result = solver.solve(board.get_position(), moves, nodes);
+                if(result.status == mate::Status::MATE){
+                    std::cout << "mate in " << result.moves << " nodes " << result.nodes << " pv";
+                    for(const Move& move : result.line) std::cout << " " << move_to_string(move);
+                    std::cout << std::endl;
+                } else if(result.status == mate::Status::NO_MATE){
+                    std::cout << "no mate in " << moves << " nodes " << result.nodes << std::endl;
+                } else {
+                    std::cout << "mate search stopped at the node limit, nodes " << result.nodes << std::endl;
+                }
+            } else if(command == "stats"){
+                std::string token;
+                if(args >> token && token == "reset") reset_search_stats();
+                else print_stats();
+            } else if(command == "d"){
+                board.print_board(std::cout);
+                std::cout << board.getFen() << std::endl;
+            } else if(command == "quit"){
+                break;
+            } else if(!command.empty()){
+                std::cout << "Unknown command: " << command << std::endl;
+            }
+        } catch(const std::exception& e){
+            std::cout << "info string error " << e.what() << std::endl;
+        }
+    }
 
     return 0;
-}
\ No newline at end of file
+}
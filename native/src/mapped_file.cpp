@@ -0,0 +1,73 @@
+#include "mapped_file.h"
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#if defined(_WIN32)
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    owned.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    bytes = owned.data();
+    length = owned.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        ::close(fd);
+        return false;
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    if(length > 0){
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if(mapped == MAP_FAILED){
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        bytes = static_cast<const unsigned char*>(mapped);
+    }
+    ::close(fd); //the mapping stays valid
+#endif
+
+    opened = true;
+    return true;
+}
+
+void MappedFile::close() {
+#if !defined(_WIN32)
+    if(bytes != nullptr) munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+    owned.clear();
+}
+
+bool MappedFile::is_open() const {
+    return opened;
+}
+
+const unsigned char* MappedFile::data() const {
+    return bytes;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
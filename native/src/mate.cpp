@@ -0,0 +1,230 @@
+#include "mate.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace mate {
+
+    namespace {
+        //Proof and disproof numbers saturate here, a node at INFINITE is decided
+        constexpr uint32_t INFINITE = 1u << 28;
+
+        uint32_t saturating_add(uint32_t a, uint32_t b) {
+            return std::min(INFINITE, a + b);
+        }
+    }
+
+    Solver::Solver(size_t hash_mb) {
+        size_t entries = std::max<size_t>(2, (hash_mb << 20) / sizeof(Entry));
+        size_t size = 2;
+        while(size * 2 <= entries) size *= 2;
+        table.resize(size);
+        clear();
+    }
+
+    void Solver::clear() {
+        //Empty slots answer like a node nobody looked at yet
+        std::fill(table.begin(), table.end(), Entry{0, Numbers{1, 1}, 0});
+    }
+
+    uint64_t Solver::entry_key(const Position& position, int moves_left) {
+        return position.zobrist_key ^ (static_cast<uint64_t>(moves_left) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    Solver::Numbers Solver::lookup(uint64_t key) const {
+        const Entry* bucket = &table[key & (table.size() - 2)];
+        for(int i = 0; i < 2; i++){
+            if(bucket[i].key == key) return bucket[i].numbers;
+        }
+        return Numbers{1, 1};
+    }
+
+    void Solver::store(uint64_t key, Numbers numbers, uint64_t work) {
+        //Two slots per bucket, on a collision the entry with less work behind it goes
+        Entry* bucket = &table[key & (table.size() - 2)];
+        Entry* slot = &bucket[0];
+        if(bucket[0].key != key && (bucket[1].key == key || bucket[0].work > bucket[1].work)) slot = &bucket[1];
+        *slot = Entry{key, numbers, static_cast<uint32_t>(std::min<uint64_t>(work, UINT32_MAX))};
+    }
+
+    int Solver::children(const Position& position, int moves_left, bool attacker, Move* moves) {
+        if(!attacker || moves_left > 1) return engine.generate_legal_moves(position, moves);
+
+        //Only a check can mate on the attacker's last move
+        Move checks[MAX_NUMBER_OF_MOVES];
+        int check_count = engine.generate_checks(position, checks);
+        int count = 0;
+        for(int i = 0; i < check_count; i++){
+            if(position.is_legal(checks[i])) moves[count++] = checks[i];
+        }
+        return count;
+    }
+
+    Solver::Numbers Solver::search(const Position& position, int moves_left, bool attacker, uint32_t phi_threshold, uint32_t delta_threshold) {
+        uint64_t start_nodes = nodes++;
+        uint64_t key = entry_key(position, moves_left);
+
+        //Terminal nodes, (INFINITE, 0) means the side to move fails and (0, INFINITE) that it succeeds
+        constexpr Numbers FAILS{INFINITE, 0}, SUCCEEDS{0, INFINITE};
+        if(attacker && moves_left == 0){
+            store(key, FAILS, 1);
+            return FAILS;
+        }
+
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = children(position, moves_left, attacker, moves);
+        if(count == 0){
+            bool mated = !attacker && position.is_in_check(position.sideToMove);
+            Numbers result = attacker || mated ? FAILS : SUCCEEDS; //stalemate succeeds for the defender
+            store(key, result, 1);
+            return result;
+        }
+        if(!attacker && moves_left == 0){
+            store(key, SUCCEEDS, 1); //the defender survived the last attacker move
+            return SUCCEEDS;
+        }
+
+        //Children's numbers are kept here as well as in the table, so losing them to replacement can not
+        //undo the progress a child search made
+        int child_moves_left = attacker ? moves_left - 1 : moves_left;
+        Numbers child_numbers[MAX_NUMBER_OF_MOVES];
+        for(int i = 0; i < count; i++){
+            Position child = position;
+            child.apply_move(moves[i]);
+            child_numbers[i] = lookup(entry_key(child, child_moves_left));
+        }
+
+        while(true){
+            //phi is the smallest child delta, delta the sum of the child phis
+            uint32_t delta = 0;
+            uint32_t best_delta = INFINITE, second_delta = INFINITE, best_phi = 0;
+            int best = 0;
+            for(int i = 0; i < count; i++){
+                delta = saturating_add(delta, child_numbers[i].phi);
+                if(child_numbers[i].delta < best_delta){
+                    second_delta = best_delta;
+                    best_delta = child_numbers[i].delta;
+                    best_phi = child_numbers[i].phi;
+                    best = i;
+                } else if(child_numbers[i].delta < second_delta){
+                    second_delta = child_numbers[i].delta;
+                }
+            }
+            Numbers result{best_delta, delta};
+
+            if(result.phi >= phi_threshold || result.delta >= delta_threshold || out_of_nodes()){
+                store(key, result, nodes - start_nodes);
+                return result;
+            }
+
+            //The best child may grow until the second best would take over, or until this node's delta reaches its threshold
+            uint32_t child_phi_threshold = delta_threshold - (delta - best_phi);
+            uint32_t child_delta_threshold = std::min(phi_threshold, second_delta + 1);
+
+            Position child = position;
+            child.apply_move(moves[best]);
+            child_numbers[best] = search(child, child_moves_left, !attacker, child_phi_threshold, child_delta_threshold);
+        }
+    }
+
+    Status Solver::prove(const Position& position, int moves) {
+        Numbers root = search(position, moves, true, INFINITE, INFINITE);
+        if(root.phi == 0) return Status::MATE;
+        if(root.delta == 0) return Status::NO_MATE;
+        return Status::UNKNOWN;
+    }
+
+    bool Solver::out_of_nodes() const {
+        return node_limit != 0 && nodes >= node_limit;
+    }
+
+    Result Solver::solve(const Position& position, int moves, uint64_t limit) {
+        Result result;
+        result.status = Status::NO_MATE;
+        nodes = 0;
+        node_limit = limit;
+
+        for(int n = 1; n <= moves; n++){
+            Status status = prove(position, n);
+            if(status == Status::NO_MATE) continue;
+
+            result.status = status;
+            if(status == Status::MATE){
+                result.moves = n;
+                //The line is read back from the table, nodes it lost to replacement are searched again
+                //within what is left of the node limit
+                extract_line(position, n, true, result.line);
+            }
+            break;
+        }
+
+        result.nodes = nodes;
+        return result;
+    }
+
+    void Solver::extract_line(const Position& position, int moves_left, bool attacker, std::vector<Move>& line) {
+        //Whether the attacker forces mate from here, searching again if the table does not know
+        auto attacker_wins = [this](const Position& node, int left, bool attacker_to_move){
+            Numbers numbers = lookup(entry_key(node, left));
+            if(numbers.phi != 0 && numbers.delta != 0) numbers = search(node, left, attacker_to_move, INFINITE, INFINITE);
+            return attacker_to_move ? numbers.phi == 0 : numbers.delta == 0;
+        };
+
+        if(out_of_nodes()) return;
+
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = children(position, moves_left, attacker, moves);
+
+        if(attacker){
+            for(int i = 0; i < count; i++){
+                Position child = position;
+                child.apply_move(moves[i]);
+                if(attacker_wins(child, moves_left - 1, false)){
+                    line.push_back(moves[i]);
+                    extract_line(child, moves_left - 1, false, line);
+                    return;
+                }
+            }
+            return;
+        }
+
+        //Every defence loses, play the one that holds out longest
+        int best = -1, best_length = 0;
+        for(int i = 0; i < count; i++){
+            Position child = position;
+            child.apply_move(moves[i]);
+            int length = 1;
+            while(length < moves_left && !attacker_wins(child, length, true)) length++;
+            if(length > best_length){
+                best_length = length;
+                best = i;
+            }
+        }
+        if(best < 0 || out_of_nodes()) return; //mated, or the lengths are not known
+
+        Position child = position;
+        child.apply_move(moves[best]);
+        line.push_back(moves[best]);
+        extract_line(child, best_length, true, line);
+    }
+
+    std::vector<Result> solve_parallel(const std::vector<Position>& positions, int moves, uint64_t node_limit, int threads) {
+        std::vector<Result> results(positions.size());
+        std::atomic<size_t> next_position{0};
+        std::vector<std::thread> workers;
+
+        int worker_count = std::max(1, std::min(threads, static_cast<int>(positions.size())));
+        for(int t = 0; t < worker_count; t++){
+            workers.emplace_back([&]{
+                Solver solver;
+                size_t i;
+                while((i = next_position++) < positions.size()){
+                    results[i] = solver.solve(positions[i], moves, node_limit);
+                }
+            });
+        }
+        for(auto& worker : workers) worker.join();
+
+        return results;
+    }
+}
@@ -0,0 +1,255 @@
+#include "nnue.h"
+#include "board.h"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+    struct Network {
+        alignas(32) int16_t ft_bias[NNUE_HIDDEN];
+        alignas(32) int16_t ft_weights[NNUE_INPUTS][NNUE_HIDDEN];
+        int32_t l1_bias[NNUE_L1];
+        alignas(32) int8_t l1_weights[NNUE_L1][2 * NNUE_HIDDEN];
+        int32_t l2_bias[NNUE_L2];
+        int8_t l2_weights[NNUE_L2][NNUE_L1];
+        int32_t out_bias;
+        int8_t out_weights[NNUE_L2];
+    };
+
+    std::unique_ptr<Network> network;
+    uint32_t current_network_id = 0;
+    uint32_t next_network_id = 1;
+
+    //King bucket by square relative to the perspective: back two ranks split by wing, the rest split by wing
+    constexpr int king_bucket(int relative_square) {
+        return (relative_square / 8 >= 2 ? 2 : 0) + (relative_square % 8 >= 4 ? 1 : 0);
+    }
+
+    inline int orient(int perspective, int square) {
+        return perspective == 0 ? square : square ^ 56;
+    }
+
+    inline int feature_index(int perspective, int king_square, Piece piece, int square) {
+        int piece_index = (static_cast<int>(colorOf(piece)) == perspective ? 0 : 6) + static_cast<int>(typeOf(piece));
+        return king_bucket(orient(perspective, king_square)) * 768 + piece_index * 64 + orient(perspective, square);
+    }
+
+    inline int king_square(const Position& board, int perspective) {
+        return std::countr_zero(board.get_piece_bitboard(perspective == 0 ? Piece::W_KING : Piece::B_KING));
+    }
+
+    template<typename T>
+    bool read_array(std::ifstream& in, T* data, size_t count) {
+        in.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(sizeof(T) * count));
+        return static_cast<bool>(in);
+    }
+
+    // accumulator += sum(added rows) - sum(removed rows), one pass over the accumulator
+    void apply_rows(int16_t* acc, const int16_t* const* added, int n_added, const int16_t* const* removed, int n_removed) {
+#if defined(__AVX2__)
+        for(int i = 0; i < NNUE_HIDDEN; i += 16){
+            __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i));
+            for(int a = 0; a < n_added; a++) v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(added[a] + i)));
+            for(int r = 0; r < n_removed; r++) v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(removed[r] + i)));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(acc + i), v);
+        }
+#elif defined(__SSE2__)
+        for(int i = 0; i < NNUE_HIDDEN; i += 8){
+            __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(acc + i));
+            for(int a = 0; a < n_added; a++) v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(added[a] + i)));
+            for(int r = 0; r < n_removed; r++) v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(removed[r] + i)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(acc + i), v);
+        }
+#elif defined(__ARM_NEON)
+        for(int i = 0; i < NNUE_HIDDEN; i += 8){
+            int16x8_t v = vld1q_s16(acc + i);
+            for(int a = 0; a < n_added; a++) v = vaddq_s16(v, vld1q_s16(added[a] + i));
+            for(int r = 0; r < n_removed; r++) v = vsubq_s16(v, vld1q_s16(removed[r] + i));
+            vst1q_s16(acc + i, v);
+        }
+#else
+        for(int i = 0; i < NNUE_HIDDEN; i++){
+            int16_t v = acc[i];
+            for(int a = 0; a < n_added; a++) v += added[a][i];
+            for(int r = 0; r < n_removed; r++) v -= removed[r][i];
+            acc[i] = v;
+        }
+#endif
+    }
+
+    void refresh_perspective(nnue::Accumulator& accumulator, const Position& board, int perspective) {
+        int16_t* acc = accumulator.values[perspective];
+        std::copy(network->ft_bias, network->ft_bias + NNUE_HIDDEN, acc);
+
+        int king = king_square(board, perspective);
+        for(int p = W_PAWN; p < NONE; p++){
+            Bitboard pieces = board.get_piece_bitboard(static_cast<Piece>(p));
+            while(pieces != 0){
+                int square = std::countr_zero(pieces);
+                pieces &= pieces - 1;
+                const int16_t* row = network->ft_weights[feature_index(perspective, king, static_cast<Piece>(p), square)];
+                apply_rows(acc, &row, 1, nullptr, 0);
+            }
+        }
+    }
+
+    // clamp(int16, 0, 127) packed to bytes, the input of the first dense layer
+    void clipped_relu(const int16_t* in, uint8_t* out, int count) {
+        for(int i = 0; i < count; i++){
+            out[i] = static_cast<uint8_t>(std::clamp<int>(in[i], 0, 127));
+        }
+    }
+
+    int32_t dot_u8_i8(const uint8_t* input, const int8_t* weights, int count) {
+#if defined(__AVX2__)
+        //maddubs saturates at int16, inputs are at most 127 so pairs stay below 2 * 127 * 128
+        __m256i sum = _mm256_setzero_si256();
+        const __m256i ones = _mm256_set1_epi16(1);
+        for(int i = 0; i < count; i += 32){
+            __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        return _mm_cvtsi128_si32(half);
+#else
+        int32_t sum = 0;
+        for(int i = 0; i < count; i++){
+            sum += static_cast<int32_t>(input[i]) * weights[i];
+        }
+        return sum;
+#endif
+    }
+}
+
+namespace nnue {
+
+    bool load_network(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return false;
+
+        uint32_t header[2];
+        if(!read_array(in, header, 2) || header[0] != NNUE_MAGIC || header[1] != NNUE_VERSION) return false;
+
+        auto loaded = std::make_unique<Network>();
+        bool ok = read_array(in, loaded->ft_bias, NNUE_HIDDEN)
+            && read_array(in, &loaded->ft_weights[0][0], static_cast<size_t>(NNUE_INPUTS) * NNUE_HIDDEN)
+            && read_array(in, loaded->l1_bias, NNUE_L1)
+            && read_array(in, &loaded->l1_weights[0][0], NNUE_L1 * 2 * NNUE_HIDDEN)
+            && read_array(in, loaded->l2_bias, NNUE_L2)
+            && read_array(in, &loaded->l2_weights[0][0], NNUE_L2 * NNUE_L1)
+            && read_array(in, &loaded->out_bias, 1)
+            && read_array(in, loaded->out_weights, NNUE_L2);
+
+        if(!ok) return false;
+
+        network = std::move(loaded);
+        current_network_id = next_network_id++;
+        return true;
+    }
+
+    void unload_network() {
+        network.reset();
+        current_network_id = 0;
+    }
+
+    bool is_loaded() {
+        return network != nullptr;
+    }
+
+    uint32_t network_id() {
+        return current_network_id;
+    }
+
+    void refresh(Accumulator& accumulator, const Position& board) {
+        if(network == nullptr) return;
+
+        refresh_perspective(accumulator, board, 0);
+        refresh_perspective(accumulator, board, 1);
+        accumulator.network_id = current_network_id;
+    }
+
+    void update(Accumulator& accumulator, const Position& board, const Move& move, bool undo) {
+        //A stale accumulator stays stale, evaluation refreshes it on demand
+        if(network == nullptr || accumulator.network_id != current_network_id) return;
+
+        Piece piece = static_cast<Piece>(move.piece);
+        Piece rook = colorOf(piece) == Color::WHITE ? Piece::W_ROOK : Piece::B_ROOK;
+
+        //Feature changes going forward, swapped below when undoing
+        Piece removed_pieces[3];
+        int removed_squares[3];
+        Piece added_pieces[2];
+        int added_squares[2];
+        int n_removed = 0, n_added = 0;
+
+        removed_pieces[n_removed] = piece; removed_squares[n_removed++] = move.from_square;
+        added_pieces[n_added] = move.promoted_piece != Piece::NONE ? move.promoted_piece : piece;
+        added_squares[n_added++] = move.to_square;
+
+        if(move.captured_piece != Piece::NONE){
+            int captured_square = move.to_square;
+            if(move.is_enpassant) captured_square += colorOf(piece) == Color::WHITE ? -8 : 8;
+            removed_pieces[n_removed] = move.captured_piece; removed_squares[n_removed++] = captured_square;
+        }
+
+        if(move.is_castling){
+            bool kingside = move.to_square > move.from_square;
+            removed_pieces[n_removed] = rook; removed_squares[n_removed++] = kingside ? move.from_square + 3 : move.from_square - 4;
+            added_pieces[n_added] = rook; added_squares[n_added++] = kingside ? move.from_square + 1 : move.from_square - 1;
+        }
+
+        for(int perspective = 0; perspective < 2; perspective++){
+            bool own_king_moved = (piece == Piece::W_KING && perspective == 0) || (piece == Piece::B_KING && perspective == 1);
+            if(own_king_moved && king_bucket(orient(perspective, move.from_square)) != king_bucket(orient(perspective, move.to_square))){
+                refresh_perspective(accumulator, board, perspective);
+                continue;
+            }
+
+            int king = king_square(board, perspective);
+            const int16_t* added_rows[3];
+            const int16_t* removed_rows[3];
+            for(int i = 0; i < n_added; i++) added_rows[i] = network->ft_weights[feature_index(perspective, king, added_pieces[i], added_squares[i])];
+            for(int i = 0; i < n_removed; i++) removed_rows[i] = network->ft_weights[feature_index(perspective, king, removed_pieces[i], removed_squares[i])];
+
+            if(undo){
+                apply_rows(accumulator.values[perspective], removed_rows, n_removed, added_rows, n_added);
+            } else {
+                apply_rows(accumulator.values[perspective], added_rows, n_added, removed_rows, n_removed);
+            }
+        }
+    }
+
+    int evaluate(const Accumulator& accumulator, int side_to_move) {
+        alignas(32) uint8_t input[2 * NNUE_HIDDEN];
+        clipped_relu(accumulator.values[side_to_move], input, NNUE_HIDDEN);
+        clipped_relu(accumulator.values[side_to_move ^ 1], input + NNUE_HIDDEN, NNUE_HIDDEN);
+
+        uint8_t hidden1[NNUE_L1];
+        for(int i = 0; i < NNUE_L1; i++){
+            int32_t sum = network->l1_bias[i] + dot_u8_i8(input, network->l1_weights[i], 2 * NNUE_HIDDEN);
+            hidden1[i] = static_cast<uint8_t>(std::clamp(sum >> 6, 0, 127));
+        }
+
+        uint8_t hidden2[NNUE_L2];
+        for(int i = 0; i < NNUE_L2; i++){
+            int32_t sum = network->l2_bias[i] + dot_u8_i8(hidden1, network->l2_weights[i], NNUE_L1);
+            hidden2[i] = static_cast<uint8_t>(std::clamp(sum >> 6, 0, 127));
+        }
+
+        int32_t output = network->out_bias + dot_u8_i8(hidden2, network->out_weights, NNUE_L2);
+        return output / NNUE_OUTPUT_SCALE;
+    }
+}
@@ -0,0 +1,350 @@
+#include "pgn.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace pgn {
+
+    namespace {
+        constexpr std::string_view PIECE_LETTERS = "PNBRQK"; //indexed by PieceType
+
+        bool is_space(char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        bool ends_token(char c) {
+            return is_space(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == ';' || c == '$';
+        }
+
+        bool is_result(std::string_view token) {
+            return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+        }
+
+        //Move suffix annotations as their NAG, 0 if the suffix is not one of them
+        int suffix_nag(std::string_view suffix) {
+            static constexpr std::string_view suffixes[] = {"!", "?", "!!", "??", "!?", "?!"};
+            for(int i = 0; i < 6; i++){
+                if(suffix == suffixes[i]) return i + 1;
+            }
+            return 0;
+        }
+
+        bool at_line_start(std::string_view text, size_t i) {
+            return i == 0 || text[i - 1] == '\n';
+        }
+
+        //A '[' opening a line after an empty line, at or after from
+        size_t next_game_start(std::string_view text, size_t from) {
+            size_t i = from;
+            while((i = text.find("\n[", i)) != std::string_view::npos){
+                size_t line_end = i; //the '\n' ending the previous line
+                size_t before = line_end;
+                if(before > 0 && text[before - 1] == '\r') before--;
+                if(before == 0 || text[before - 1] == '\n') return i + 1;
+                i++;
+            }
+            return text.size();
+        }
+
+        //One line of play, the main line at depth 0 and a variation above it
+        struct Line {
+            Position current;
+            Position before_last; //where the last move was played from, variations branch off here
+            bool has_move;
+            bool error;
+        };
+    }
+
+    uint64_t Parser::parse(std::string_view text, Visitor& visitor) {
+        static const Position start_position = []{
+            Position position;
+            position.set_position_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+            return position;
+        }();
+
+        Line lines[MAX_VARIATION_DEPTH + 1];
+        int depth = 0;
+        int skipped = 0; //nesting of variations that are passed over
+        bool in_game = false, movetext = false, game_error = false;
+        uint64_t games = 0;
+
+        auto begin_game = [&]{
+            visitor.begin_game();
+            lines[0] = Line{start_position, start_position, false, false};
+            depth = 0;
+            skipped = 0;
+            in_game = true;
+            movetext = false;
+            game_error = false;
+        };
+        auto end_game = [&](std::string_view result){
+            visitor.end_game(result, game_error);
+            in_game = false;
+            games++;
+        };
+
+        size_t i = 0, n = text.size();
+        while(i < n){
+            char c = text[i];
+            if(is_space(c)){
+                i++;
+                continue;
+            }
+            if(c == '%' && at_line_start(text, i)){
+                size_t end = text.find('\n', i);
+                i = end == std::string_view::npos ? n : end + 1;
+                continue;
+            }
+
+            if(c == '['){
+                if(in_game && movetext) end_game("");
+                if(!in_game){
+                    if(visitor.done()) break;
+                    begin_game();
+                }
+
+                //[Name "value"], the value keeps its escapes
+                size_t name_start = ++i;
+                while(i < n && !is_space(text[i]) && text[i] != '"' && text[i] != ']') i++;
+                std::string_view name = text.substr(name_start, i - name_start);
+                while(i < n && is_space(text[i]) && text[i] != '\n') i++;
+
+                std::string_view value;
+                if(i < n && text[i] == '"'){
+                    size_t value_start = ++i;
+                    while(i < n && text[i] != '"' && text[i] != '\n'){
+                        i += text[i] == '\\' && i + 1 < n ? 2 : 1;
+                    }
+                    value = text.substr(value_start, std::min(i, n) - value_start);
+                }
+                while(i < n && text[i] != ']' && text[i] != '\n') i++;
+                if(i < n && text[i] == ']') i++;
+
+                visitor.tag(name, value);
+                if(name == "FEN"){
+                    try {
+                        lines[0].current.set_position_fen(std::string(value));
+                        lines[0].before_last = lines[0].current;
+                    } catch(const std::exception&){
+                        lines[0].error = true;
+                        game_error = true;
+                    }
+                }
+                continue;
+            }
+
+            if(!in_game){
+                if(visitor.done()) break;
+                begin_game();
+            }
+            movetext = true;
+
+            if(c == '{' || c == ';'){
+                size_t end = text.find(c == '{' ? '}' : '\n', i + 1);
+                if(end == std::string_view::npos) end = n;
+                if(skipped == 0) visitor.comment(text.substr(i + 1, end - i - 1), depth);
+                i = end + 1;
+                continue;
+            }
+
+            if(c == '('){
+                i++;
+                if(skipped > 0 || depth == MAX_VARIATION_DEPTH || !lines[depth].has_move){
+                    skipped++;
+                    continue;
+                }
+                depth++;
+                lines[depth] = Line{lines[depth - 1].before_last, lines[depth - 1].before_last, false, false};
+                visitor.begin_variation(depth);
+                continue;
+            }
+
+            if(c == ')'){
+                i++;
+                if(skipped > 0){
+                    skipped--;
+                } else if(depth > 0){
+                    visitor.end_variation(depth);
+                    depth--;
+                }
+                continue;
+            }
+
+            if(c == '$'){
+                int value = 0;
+                for(i++; i < n && text[i] >= '0' && text[i] <= '9'; i++) value = value * 10 + (text[i] - '0');
+                if(skipped == 0) visitor.nag(value, depth);
+                continue;
+            }
+
+            if(c == ']' || c == '}'){
+                i++; //stray
+                continue;
+            }
+
+            size_t token_start = i;
+            while(i < n && !ends_token(text[i])) i++;
+            std::string_view token = text.substr(token_start, i - token_start);
+
+            if(is_result(token)){
+                end_game(token);
+                continue;
+            }
+
+            //Move numbers, glued to the move or not: 12. 12... 12.e4
+            size_t digits = 0;
+            while(digits < token.size() && token[digits] >= '0' && token[digits] <= '9') digits++;
+            if(digits > 0 && (digits == token.size() || token[digits] == '.')){
+                token.remove_prefix(digits);
+                while(!token.empty() && token.front() == '.') token.remove_prefix(1);
+            }
+
+            size_t suffix_start = std::min(token.find_first_of("!?"), token.size());
+            std::string_view suffix = token.substr(suffix_start);
+            token = token.substr(0, suffix_start);
+            if(skipped > 0) continue;
+
+            Line& line = lines[depth];
+            if(!token.empty() && !line.error){
+                Move move;
+                if(decode_san(line.current, token, move)){
+                    visitor.move(line.current, move, depth);
+                    line.before_last = line.current;
+                    line.current.apply_move(move);
+                    line.has_move = true;
+                } else {
+                    line.error = true;
+                    game_error = true;
+                }
+            }
+            if(int nag = suffix_nag(suffix)) visitor.nag(nag, depth);
+        }
+
+        if(in_game) end_game("");
+        return games;
+    }
+
+    bool Parser::decode_san(const Position& position, std::string_view san, Move& out) {
+        while(!san.empty() && (san.back() == '+' || san.back() == '#')) san.remove_suffix(1);
+        if(san.empty()) return false;
+
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(position, moves);
+
+        if(san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0"){
+            bool kingside = san.size() == 3;
+            for(int i = 0; i < count; i++){
+                if(moves[i].is_castling && (moves[i].to_square > moves[i].from_square) == kingside){
+                    out = moves[i];
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t type = static_cast<size_t>(PieceType::PAWN);
+        size_t letter = PIECE_LETTERS.find(san.front());
+        if(letter != std::string_view::npos){
+            type = letter;
+            san.remove_prefix(1);
+        }
+
+        //e8=Q or e8Q
+        size_t promotion = std::string_view::npos;
+        size_t equals = san.find('=');
+        if(equals != std::string_view::npos){
+            if(equals + 1 >= san.size()) return false;
+            promotion = PIECE_LETTERS.find(san[equals + 1]);
+            san = san.substr(0, equals);
+        } else if(type == static_cast<size_t>(PieceType::PAWN) && san.size() > 2 && PIECE_LETTERS.find(san.back()) != std::string_view::npos){
+            promotion = PIECE_LETTERS.find(san.back());
+            san.remove_suffix(1);
+        }
+        if(promotion == 0 || promotion == static_cast<size_t>(PieceType::KING)) return false;
+
+        if(san.size() < 2) return false;
+        char to_file = san[san.size() - 2], to_rank = san[san.size() - 1];
+        if(to_file < 'a' || to_file > 'h' || to_rank < '1' || to_rank > '8') return false;
+        int to = (to_rank - '1') * 8 + (to_file - 'a');
+
+        //Whatever comes before the destination narrows down the origin: Nbd2, R1e2, Qh4xe1, Ng1-f3
+        int from_file = -1, from_rank = -1;
+        for(char c : san.substr(0, san.size() - 2)){
+            if(c >= 'a' && c <= 'h') from_file = c - 'a';
+            else if(c >= '1' && c <= '8') from_rank = c - '1';
+            else if(c != 'x' && c != '-' && c != ':') return false;
+        }
+
+        int matches = 0;
+        for(int i = 0; i < count; i++){
+            const Move& move = moves[i];
+            if(move.to_square != to || move.is_castling) continue;
+            if(static_cast<size_t>(typeOf(static_cast<Piece>(move.piece))) != type) continue;
+            if(from_file >= 0 && move.from_square % 8 != from_file) continue;
+            if(from_rank >= 0 && move.from_square / 8 != from_rank) continue;
+
+            bool promotes = move.promoted_piece != Piece::NONE;
+            if(promotes != (promotion != std::string_view::npos)) continue;
+            if(promotes && static_cast<size_t>(typeOf(move.promoted_piece)) != promotion) continue;
+
+            out = move;
+            matches++;
+        }
+        return matches == 1;
+    }
+
+    int64_t parse_file(const std::string& path, Visitor& visitor) {
+        MappedFile file;
+        if(!file.open(path)) return -1;
+
+        Parser parser;
+        std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+        return static_cast<int64_t>(parser.parse(text, visitor));
+    }
+
+    std::vector<std::string_view> split_games(std::string_view text, int parts) {
+        std::vector<std::string_view> pieces;
+        size_t start = 0;
+        for(int part = 1; part < parts; part++){
+            size_t target = text.size() / parts * part;
+            if(target <= start) continue;
+
+            size_t cut = next_game_start(text, target);
+            if(cut >= text.size()) break;
+            pieces.push_back(text.substr(start, cut - start));
+            start = cut;
+        }
+        pieces.push_back(text.substr(start));
+        return pieces;
+    }
+
+    uint64_t parse_parallel(std::string_view text, int threads, int pieces, const std::function<Visitor&(int piece)>& visitor_for) {
+        std::vector<std::string_view> chunks = split_games(text, std::max(1, pieces));
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<uint64_t> games{0};
+        std::vector<std::thread> workers;
+
+        int worker_count = std::max(1, std::min(threads, static_cast<int>(chunks.size())));
+        for(int t = 0; t < worker_count; t++){
+            workers.emplace_back([&]{
+                Parser parser;
+                size_t i;
+                while((i = next_chunk++) < chunks.size()){
+                    games += parser.parse(chunks[i], visitor_for(static_cast<int>(i)));
+                }
+            });
+        }
+        for(auto& worker : workers) worker.join();
+
+        return games;
+    }
+
+    int64_t parse_file_parallel(const std::string& path, int threads, int pieces, const std::function<Visitor&(int piece)>& visitor_for) {
+        MappedFile file;
+        if(!file.open(path)) return -1;
+
+        std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+        return static_cast<int64_t>(parse_parallel(text, threads, pieces, visitor_for));
+    }
+}
@@ -0,0 +1,60 @@
+#include "tablebase.h"
+#include "board.h"
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+namespace {
+
+    std::vector<std::shared_ptr<tablebase::Source>> sources;
+    int largest_source = 0;
+
+    bool probeable(const Position& position) {
+        if(position.castlingRightsState != 0) return false;
+        return std::popcount(position.occupancy) <= largest_source;
+    }
+}
+
+namespace tablebase {
+
+    void add_source(std::shared_ptr<Source> source) {
+        largest_source = std::max(largest_source, source->max_pieces());
+        sources.push_back(std::move(source));
+    }
+
+    void clear_sources() {
+        sources.clear();
+        largest_source = 0;
+    }
+
+    int max_pieces() {
+        return largest_source;
+    }
+
+    bool probe_wdl(const Position& position, WDL& out) {
+        if(!probeable(position)) return false;
+
+        for(const auto& source : sources){
+            if(source->probe_wdl(position, out)) return true;
+        }
+        return false;
+    }
+
+    bool probe_dtz(const Position& position, int& out) {
+        if(!probeable(position)) return false;
+
+        for(const auto& source : sources){
+            if(source->probe_dtz(position, out)) return true;
+        }
+        return false;
+    }
+
+    bool probe_dtm(const Position& position, int& out) {
+        if(!probeable(position)) return false;
+
+        for(const auto& source : sources){
+            if(source->probe_dtm(position, out)) return true;
+        }
+        return false;
+    }
+}
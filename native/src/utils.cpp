@@ -1,6 +1,10 @@
 #include "utils.h"
 #include <sstream>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 std::vector<std::string> splitString(const std::string& s, char delimiter) {
     std::vector<std::string> tokens;
     std::string token;
@@ -12,126 +16,55 @@ std::vector<std::string> splitString(const std::string& s, char delimiter) {
     return tokens;
 }
 
-int rankOf(int square){ return square / 8;}
-int fileOf(int square){ return square % 8;}
-
-const std::array<int, 8> knight_offsets = {17, 15, 10, 6, -17, -15, -10, -6}; 
-const std::array<int, 2> pawn_attack_offsets = {-1, 1}; 
-const std::array<int, 4> diagonal_offsets = {9, 7, -9, -7};
-const std::array<int, 4> rook_offsets = {8, -8, 1, -1}; // up, down, right, left
-
-const std::array<int, 16> direction_offsets = {8,-8,-1,1,7,-7,9,-9, 6, 10, 15, 17, -6, -10, -15, -17}; 
-
-
-const Piece charToPiece[CHAR_MAP_SIZE] {
-    ['P'] = W_PAWN,
-    ['N'] = W_KNIGHT,
-    ['B'] = W_BISHOP,
-    ['R'] = W_ROOK,
-    ['Q'] = W_QUEEN,
-    ['K'] = W_KING,
-    ['p'] = B_PAWN,
-    ['n'] = B_KNIGHT,
-    ['b'] = B_BISHOP,
-    ['r'] = B_ROOK,
-    ['q'] = B_QUEEN,
-    ['k'] = B_KING
-};
+constinit const std::array<int, 8> knight_offsets = {17, 15, 10, 6, -17, -15, -10, -6}; 
+constinit const std::array<int, 2> pawn_attack_offsets = {-1, 1}; 
+constinit const std::array<int, 4> diagonal_offsets = {9, 7, -9, -7};
+constinit const std::array<int, 4> rook_offsets = {8, -8, 1, -1}; // up, down, right, left
+
+constinit const std::array<int, 16> direction_offsets = {8,-8,-1,1,7,-7,9,-9, 6, 10, 15, 17, -6, -10, -15, -17}; 
+
+
+constinit const std::array<Piece, CHAR_MAP_SIZE> charToPiece = []{
+    std::array<Piece, CHAR_MAP_SIZE> result{};
+    result['P'] = W_PAWN;
+    result['N'] = W_KNIGHT;
+    result['B'] = W_BISHOP;
+    result['R'] = W_ROOK;
+    result['Q'] = W_QUEEN;
+    result['K'] = W_KING;
+    result['p'] = B_PAWN;
+    result['n'] = B_KNIGHT;
+    result['b'] = B_BISHOP;
+    result['r'] = B_ROOK;
+    result['q'] = B_QUEEN;
+    result['k'] = B_KING;
+    return result;
+}();
 
-const char pieceToChar[CHAR_MAP_SIZE] {
-    [W_PAWN] = 'P',
-    [W_KNIGHT] = 'N',
-    [W_BISHOP] = 'B',
-    [W_ROOK] = 'R',
-    [W_QUEEN] = 'Q',
-    [W_KING] = 'K',
-    [B_PAWN] = 'p',
-    [B_KNIGHT] = 'n',
-    [B_BISHOP] = 'b',
-    [B_ROOK] = 'r',
-    [B_QUEEN] = 'q',
-    [B_KING] = 'k'
+//Indexed by Piece (W_PAWN..B_KING), the rest of the table is zero
+constinit const char pieceToChar[CHAR_MAP_SIZE] {
+    'P', 'N', 'B', 'R', 'Q', 'K',
+    'p', 'n', 'b', 'r', 'q', 'k'
 };
 
-Bitboard compute_knight_attacks(int square)
-{
-    int rank = rankOf(square);
-    int file = fileOf(square);
-    uint64_t attacks = 0ULL;
-
-    for (int j = 0; j < 8; j++) {
-        int attacked_square = square + knight_offsets[j];
-
-        // Quick board boundary check
-        if (attacked_square < 0 || attacked_square >= 64) continue;
-
-        int targetRank = rankOf(attacked_square);
-        int targetFile = fileOf(attacked_square);
-
-        // Make sure knight move doesn’t wrap around the board
-        if (std::abs(targetRank - rank) > 2 || std::abs(targetFile - file) > 2) continue;
-
-        attacks |= (1ULL << attacked_square);
-    }
-
-    return static_cast<Bitboard>(attacks);
-}
-
-Bitboard compute_king_attacks(int square){
-    int rank = rankOf(square);
-    int file = fileOf(square);
-    uint64_t attacks = 0ULL;
-
-    for (int dr = -1; dr <= 1; dr++) {
-        for (int df = -1; df <= 1; df++) {
-            if (dr == 0 && df == 0) continue;
-            int r = rank + dr;
-            int f = file + df;
-            if (r >= 0 && r < 8 && f >= 0 && f < 8) {
-                attacks |= (1ULL << (r * 8 + f));
-            }
-        }
-    }
-    return static_cast<Bitboard>(attacks);
-}
-
-Bitboard compute_pawn_attacks(int square, Color color)
-{
-    int rank = rankOf(square);
-    int file = fileOf(square);
-    uint64_t attacks = 0ULL;
-
-    int forward = color == Color::WHITE ? 1 : -1;
-
-    for (int df : pawn_attack_offsets) {
-        int r = rank + forward;
-        int f = file + df;
-        if (r >= 0 && r < 8 && f >= 0 && f < 8) {
-            attacks |= (1ULL << (r * 8 + f));
-        }
-    }
-
-    return static_cast<Bitboard>(attacks);
-}
-
-const std::array<Bitboard, 64> knight_moves = []{
-    std::array<Bitboard, 64> result;
+constinit const std::array<Bitboard, 64> knight_moves = []{
+    std::array<Bitboard, 64> result{};
     for(int i = 0; i < 64; i++){
         result[i] = compute_knight_attacks(i);
     }
     return result;
 }();
 
-const std::array<Bitboard, 64> king_moves = []{
-    std::array<Bitboard, 64> result;
+constinit const std::array<Bitboard, 64> king_moves = []{
+    std::array<Bitboard, 64> result{};
     for(int i = 0; i < 64; i++){
         result[i] = compute_king_attacks(i);
     }
     return result;
 }();
 
-const std::array<Bitboard, 128> pawn_attacks = []{
-    std::array<Bitboard, 128> result;
+constinit const std::array<Bitboard, 128> pawn_attacks = []{
+    std::array<Bitboard, 128> result{};
     for(int i = 0; i < 64; i++){
         result[i] = compute_pawn_attacks(i, Color::WHITE);
         result[i + 64] = compute_pawn_attacks(i, Color::BLACK);
@@ -139,8 +72,8 @@ const std::array<Bitboard, 128> pawn_attacks = []{
     return result;
 }();
 
-const std::array<std::array<int,8>, 64> num_squares_to_edge = []{
-    std::array<std::array<int,8>, 64> data;
+constinit const std::array<std::array<int,8>, 64> num_squares_to_edge = []{
+    std::array<std::array<int,8>, 64> data{};
 
     for (int file = 0; file < 8; file++) {
       for (int rank = 0; rank < 8; rank++) {
@@ -170,9 +103,87 @@ const std::array<std::array<int,8>, 64> num_squares_to_edge = []{
     return data;
 }();
 
+//Walks from a towards b one king step at a time, the step is only valid if it reaches b in a straight line
+constinit const std::array<std::array<Bitboard, 64>, 64> between_masks = []{
+    std::array<std::array<Bitboard, 64>, 64> result{};
+    for(int a = 0; a < 64; a++){
+        for(int b = 0; b < 64; b++){
+            int ranks = rankOf(b) - rankOf(a), files = fileOf(b) - fileOf(a);
+            if(a == b || (ranks != 0 && files != 0 && ranks != files && ranks != -files)) continue;
 
-const std::array<std::array<Bitboard, 4>, 64> rook_ray_masks = []{
-    std::array<std::array<Bitboard, 4>, 64> result;
+            int step = (ranks > 0 ? 8 : ranks < 0 ? -8 : 0) + (files > 0 ? 1 : files < 0 ? -1 : 0);
+            for(int square = a + step; square != b; square += step) result[a][b] |= 1ULL << square;
+        }
+    }
+    return result;
+}();
+
+constinit const std::array<std::array<Bitboard, 64>, 64> line_masks = []{
+    std::array<std::array<Bitboard, 64>, 64> result{};
+    for(int a = 0; a < 64; a++){
+        for(int b = 0; b < 64; b++){
+            int ranks = rankOf(b) - rankOf(a), files = fileOf(b) - fileOf(a);
+            if(a == b || (ranks != 0 && files != 0 && ranks != files && ranks != -files)) continue;
+
+            int dr = ranks > 0 ? 1 : ranks < 0 ? -1 : 0, df = files > 0 ? 1 : files < 0 ? -1 : 0;
+            for(int sign = -1; sign <= 1; sign += 2){
+                for(int r = rankOf(a), f = fileOf(a); r >= 0 && r < 8 && f >= 0 && f < 8; r += sign * dr, f += sign * df){
+                    result[a][b] |= 1ULL << (r * 8 + f);
+                }
+            }
+        }
+    }
+    return result;
+}();
+
+constinit const std::array<Bitboard, 8> file_masks = []{
+    std::array<Bitboard, 8> result{};
+    for(int file = 0; file < 8; file++){
+        result[file] = A_FILE_MASK << file;
+    }
+    return result;
+}();
+
+//The tables below are only const, so initialisers that need adjacent files compute them through this instead of reading the table
+static constexpr Bitboard adjacent_files(int file){
+    return (file > 0 ? A_FILE_MASK << (file - 1) : 0ULL) | (file < 7 ? A_FILE_MASK << (file + 1) : 0ULL);
+}
+
+constinit const std::array<Bitboard, 8> adjacent_file_masks = []{
+    std::array<Bitboard, 8> result{};
+    for(int file = 0; file < 8; file++){
+        result[file] = adjacent_files(file);
+    }
+    return result;
+}();
+
+constinit const std::array<std::array<Bitboard, 64>, 2> passed_pawn_masks = []{
+    std::array<std::array<Bitboard, 64>, 2> result{};
+    for(int square = 0; square < 64; square++){
+        int rank = rankOf(square);
+        int file = fileOf(square);
+        Bitboard files = (A_FILE_MASK << file) | adjacent_files(file);
+
+        for(int r = rank + 1; r < 8; r++) result[0][square] |= files & (0xFFULL << (r * 8));
+        for(int r = rank - 1; r >= 0; r--) result[1][square] |= files & (0xFFULL << (r * 8));
+    }
+    return result;
+}();
+
+constinit const std::array<std::array<Bitboard, 64>, 2> pawn_support_masks = []{
+    std::array<std::array<Bitboard, 64>, 2> result{};
+    for(int square = 0; square < 64; square++){
+        int rank = rankOf(square);
+        Bitboard files = adjacent_files(fileOf(square));
+
+        for(int r = rank; r >= 0; r--) result[0][square] |= files & (0xFFULL << (r * 8));
+        for(int r = rank; r < 8; r++) result[1][square] |= files & (0xFFULL << (r * 8));
+    }
+    return result;
+}();
+
+constinit const std::array<std::array<Bitboard, 4>, 64> rook_ray_masks = []{
+    std::array<std::array<Bitboard, 4>, 64> result{};
     for(int file = 0; file < 8; file++){
         for(int rank = 0; rank < 8; rank++){
             int squareIndex = rank * 8 + file;
@@ -200,8 +211,8 @@ const std::array<std::array<Bitboard, 4>, 64> rook_ray_masks = []{
     return result;
 }();
 
-const std::array<std::array<Bitboard, 4>, 64> bishop_ray_masks = []{
-    std::array<std::array<Bitboard, 4>, 64> result;
+constinit const std::array<std::array<Bitboard, 4>, 64> bishop_ray_masks = []{
+    std::array<std::array<Bitboard, 4>, 64> result{};
     for (int rank = 0; rank < 8; rank++) {
         for (int file = 0; file < 8; file++) {
             int squareIndex = rank * 8 + file;
@@ -232,8 +243,8 @@ const std::array<std::array<Bitboard, 4>, 64> bishop_ray_masks = []{
     return result;
 }();
 
-const std::array<std::array<int, 64>, 6> piece_square_table = []{
-    std::array<std::array<int, 64>, 6> pst;
+constinit const std::array<std::array<int, 64>, 6> piece_square_table = []{
+    std::array<std::array<int, 64>, 6> pst{};
     
     std::array<int, 64> pawn_array = {
         // Pawns on 1st/8th rank are impossible (would be promoted)
@@ -299,14 +310,89 @@ const std::array<std::array<int, 64>, 6> piece_square_table = []{
     std::array<int, 64> king_middlegame_array = {
         // King should castle and stay safe (corners/edges)
         // Heavy penalty for center exposure
-        20000, 20050, 20030, 20000, 20000, 20030, 20050, 20000,
-        20000, 20000, 20000, 20000, 20000, 20000, 20000, 20000,
-        19980, 19980, 19980, 19980, 19980, 19980, 19980, 19980,
-        19970, 19970, 19970, 19970, 19970, 19970, 19970, 19970,
-        19960, 19960, 19960, 19960, 19960, 19960, 19960, 19960,
+        // Rank 8 is on top like the other tables, so the castled squares go on the bottom row
+        19950, 19950, 19950, 19950, 19950, 19950, 19950, 19950,
         19950, 19950, 19950, 19950, 19950, 19950, 19950, 19950,
         19950, 19950, 19950, 19950, 19950, 19950, 19950, 19950,
-        19950, 19970, 19960, 19940, 19940, 19940, 19970, 19950
+        19960, 19960, 19960, 19960, 19960, 19960, 19960, 19960,
+        19970, 19970, 19970, 19970, 19970, 19970, 19970, 19970,
+        19980, 19980, 19980, 19980, 19980, 19980, 19980, 19980,
+        20000, 20000, 20000, 20000, 20000, 20000, 20000, 20000,
+        20000, 20050, 20030, 20000, 20000, 20030, 20050, 20000
+    };
+
+    pst[static_cast<int>(PieceType::PAWN)] = pawn_array;
+    pst[static_cast<int>(PieceType::KNIGHT)] = knight_array;
+    pst[static_cast<int>(PieceType::BISHOP)] = bishop_array;
+    pst[static_cast<int>(PieceType::ROOK)] = rook_array;
+    pst[static_cast<int>(PieceType::QUEEN)] = queen_array;
+    pst[static_cast<int>(PieceType::KING)] = king_middlegame_array;
+    
+    return pst;
+
+}();
+
+constinit const std::array<std::array<int, 64>, 6> piece_square_table_eg = []{
+    std::array<std::array<int, 64>, 6> pst{};
+
+    std::array<int, 64> pawn_array = {
+        // Passed pawns decide endgames, so advancement matters much more than the center
+        0,   0,   0,   0,   0,   0,   0,   0,
+        200, 200, 200, 200, 200, 200, 200, 200,
+        160, 160, 160, 160, 160, 160, 160, 160,
+        135, 135, 135, 135, 135, 135, 135, 135,
+        120, 120, 120, 120, 120, 120, 120, 120,
+        110, 110, 110, 110, 110, 110, 110, 110,
+        105, 105, 105, 105, 105, 105, 105, 105,
+        0,   0,   0,   0,   0,   0,   0,   0
+    };
+
+    std::array<int, 64> knight_array = {
+        // Knights are short range, the rim is even worse with fewer pieces around
+        280, 285, 290, 290, 290, 290, 285, 280,
+        285, 295, 300, 300, 300, 300, 295, 285,
+        290, 300, 310, 315, 315, 310, 300, 290,
+        290, 300, 315, 320, 320, 315, 300, 290,
+        290, 300, 315, 320, 320, 315, 300, 290,
+        290, 300, 310, 315, 315, 310, 300, 290,
+        285, 295, 300, 300, 300, 300, 295, 285,
+        280, 285, 290, 290, 290, 290, 285, 280
+    };
+
+    std::array<int, 64> bishop_array = {
+        // Bishops gain on open boards, mild preference for long diagonals
+        315, 320, 320, 320, 320, 320, 320, 315,
+        320, 325, 325, 325, 325, 325, 325, 320,
+        320, 325, 330, 330, 330, 330, 325, 320,
+        320, 325, 330, 335, 335, 330, 325, 320,
+        320, 325, 330, 335, 335, 330, 325, 320,
+        320, 325, 330, 330, 330, 330, 325, 320,
+        320, 325, 325, 325, 325, 325, 325, 320,
+        315, 320, 320, 320, 320, 320, 320, 315
+    };
+
+    std::array<int, 64> rook_array = {
+        // Rooks are worth more once the board opens up, 7th rank still matters
+        510, 510, 510, 510, 510, 510, 510, 510,
+        520, 520, 520, 520, 520, 520, 520, 520,
+        510, 510, 510, 510, 510, 510, 510, 510,
+        510, 510, 510, 510, 510, 510, 510, 510,
+        510, 510, 510, 510, 510, 510, 510, 510,
+        510, 510, 510, 510, 510, 510, 510, 510,
+        510, 510, 510, 510, 510, 510, 510, 510,
+        510, 510, 510, 510, 510, 510, 510, 510
+    };
+
+    std::array<int, 64> queen_array = {
+        // Centralized queen covers both wings and helps hunt the king
+        890, 900, 900, 905, 905, 900, 900, 890,
+        900, 905, 910, 910, 910, 910, 905, 900,
+        900, 910, 915, 915, 915, 915, 910, 900,
+        905, 910, 915, 920, 920, 915, 910, 905,
+        905, 910, 915, 920, 920, 915, 910, 905,
+        900, 910, 915, 915, 915, 915, 910, 900,
+        900, 905, 910, 910, 910, 910, 905, 900,
+        890, 900, 900, 905, 905, 900, 900, 890
     };
 
     std::array<int, 64> king_endgame_array = {
@@ -326,12 +412,53 @@ const std::array<std::array<int, 64>, 6> piece_square_table = []{
     pst[static_cast<int>(PieceType::BISHOP)] = bishop_array;
     pst[static_cast<int>(PieceType::ROOK)] = rook_array;
     pst[static_cast<int>(PieceType::QUEEN)] = queen_array;
-    pst[static_cast<int>(PieceType::KING)] = king_middlegame_array;
-    
+    pst[static_cast<int>(PieceType::KING)] = king_endgame_array;
+
     return pst;
 
 }();
 
+// SplitMix64, fixed seed so keys are the same on every run and platform
+static constexpr uint64_t next_random(uint64_t& state){
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//All keys come from one stream, drawn in the order pieces, castling, en passant, side
+struct ZobristKeys {
+    std::array<std::array<uint64_t, 64>, 12> pieces{};
+    std::array<uint64_t, 16> castling{};
+    std::array<uint64_t, 8> en_passant{};
+    uint64_t side = 0;
+};
+
+static constexpr ZobristKeys zobrist_keys = []{
+    ZobristKeys keys;
+    uint64_t seed = 0x5EED0C4E55ULL;
+
+    for(auto& piece : keys.pieces){
+        for(auto& key : piece){
+            key = next_random(seed);
+        }
+    }
+    keys.castling[0] = 0ULL; //no rights left hashes to nothing
+    for(int i = 1; i < 16; i++){
+        keys.castling[i] = next_random(seed);
+    }
+    for(auto& key : keys.en_passant){
+        key = next_random(seed);
+    }
+    keys.side = next_random(seed);
+    return keys;
+}();
+
+constinit const std::array<std::array<uint64_t, 64>, 12> zobrist_pieces = zobrist_keys.pieces;
+constinit const std::array<uint64_t, 16> zobrist_castling = zobrist_keys.castling;
+constinit const std::array<uint64_t, 8> zobrist_en_passant = zobrist_keys.en_passant;
+constinit const uint64_t zobrist_side = zobrist_keys.side;
+
 Bitboard get_bishop_attacks(int square, Bitboard occupied){
     uint64_t attacks = 0ULL;
     
@@ -374,6 +501,97 @@ Bitboard get_queen_attacks(int square, Bitboard occupied){
     return get_bishop_attacks(square, occupied) | get_rook_attacks(square, occupied);
 }
 
+Bitboard pawn_attack_map(Bitboard pawns, Color color){
+    if(color == Color::WHITE) return ((pawns << 7) & ~H_FILE_MASK) | ((pawns << 9) & ~A_FILE_MASK);
+    return ((pawns >> 9) & ~H_FILE_MASK) | ((pawns >> 7) & ~A_FILE_MASK);
+}
+
+Bitboard knight_attack_map(Bitboard knights){
+    constexpr Bitboard not_ab = ~(A_FILE_MASK | (A_FILE_MASK << 1));
+    constexpr Bitboard not_gh = ~(H_FILE_MASK | (H_FILE_MASK >> 1));
+
+    Bitboard east_one = (knights << 1) & ~A_FILE_MASK;
+    Bitboard west_one = (knights >> 1) & ~H_FILE_MASK;
+    Bitboard east_two = (knights << 2) & not_ab;
+    Bitboard west_two = (knights >> 2) & not_gh;
+
+    Bitboard one = east_one | west_one;
+    Bitboard two = east_two | west_two;
+    return (one << 16) | (one >> 16) | (two << 8) | (two >> 8);
+}
+
+Bitboard king_attack_map(Bitboard kings){
+    Bitboard sides = ((kings << 1) & ~A_FILE_MASK) | ((kings >> 1) & ~H_FILE_MASK);
+    Bitboard row = sides | kings;
+    return sides | (row << 8) | (row >> 8);
+}
+
+#if defined(__AVX2__)
+
+//Left shifting lanes are north, east, north east and north west, right shifting lanes south, west,
+//south west and south east. The masks stop fills and the final step from wrapping around the board.
+Bitboard slider_attack_map(Bitboard orthogonal, Bitboard diagonal, Bitboard occupied){
+    const __m256i empty = _mm256_set1_epi64x(static_cast<long long>(~occupied));
+    const __m256i left_wrap = _mm256_setr_epi64x(-1LL, ~A_FILE_MASK, ~A_FILE_MASK, ~H_FILE_MASK);
+    const __m256i right_wrap = _mm256_setr_epi64x(-1LL, ~H_FILE_MASK, ~H_FILE_MASK, ~A_FILE_MASK);
+    const __m256i steps = _mm256_setr_epi64x(8, 1, 9, 7);
+
+    auto fill = [&](__m256i generator, __m256i wrap, bool left){
+        auto shift = [left](__m256i bits, __m256i amount){
+            return left ? _mm256_sllv_epi64(bits, amount) : _mm256_srlv_epi64(bits, amount);
+        };
+
+        __m256i propagator = _mm256_and_si256(empty, wrap);
+        __m256i amount = steps;
+        for(int i = 0; i < 3; i++){
+            generator = _mm256_or_si256(generator, _mm256_and_si256(propagator, shift(generator, amount)));
+            propagator = _mm256_and_si256(propagator, shift(propagator, amount));
+            amount = _mm256_add_epi64(amount, amount);
+        }
+        return _mm256_and_si256(shift(generator, steps), wrap);
+    };
+
+    const __m256i sliders = _mm256_setr_epi64x(static_cast<long long>(orthogonal), static_cast<long long>(orthogonal),
+                                               static_cast<long long>(diagonal), static_cast<long long>(diagonal));
+    __m256i attacks = _mm256_or_si256(fill(sliders, left_wrap, true), fill(sliders, right_wrap, false));
+
+    __m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    return static_cast<Bitboard>(_mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1));
+}
+
+#else
+
+namespace {
+    //One direction of the occluded fill, shift is positive for left shifts
+    Bitboard occluded_attacks(Bitboard generator, Bitboard empty, int shift, Bitboard wrap){
+        auto step = [shift](Bitboard bits, int times){
+            return shift > 0 ? bits << (shift * times) : bits >> (-shift * times);
+        };
+
+        Bitboard propagator = empty & wrap;
+        generator |= propagator & step(generator, 1);
+        propagator &= step(propagator, 1);
+        generator |= propagator & step(generator, 2);
+        propagator &= step(propagator, 2);
+        generator |= propagator & step(generator, 4);
+        return step(generator, 1) & wrap;
+    }
+}
+
+Bitboard slider_attack_map(Bitboard orthogonal, Bitboard diagonal, Bitboard occupied){
+    Bitboard empty = ~occupied;
+    return occluded_attacks(orthogonal, empty, 8, ~0ULL)
+         | occluded_attacks(orthogonal, empty, -8, ~0ULL)
+         | occluded_attacks(orthogonal, empty, 1, ~A_FILE_MASK)
+         | occluded_attacks(orthogonal, empty, -1, ~H_FILE_MASK)
+         | occluded_attacks(diagonal, empty, 9, ~A_FILE_MASK)
+         | occluded_attacks(diagonal, empty, 7, ~H_FILE_MASK)
+         | occluded_attacks(diagonal, empty, -7, ~A_FILE_MASK)
+         | occluded_attacks(diagonal, empty, -9, ~H_FILE_MASK);
+}
+
+#endif
+
 int pop_lsb(Bitboard &bitboard)
 {
     int square = std::countr_zero(bitboard);
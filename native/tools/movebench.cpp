@@ -0,0 +1,107 @@
+// Make/undo micro benchmark.
+//
+// usage: movebench [--seconds S] [fen]...
+//
+// Generates the legal moves of each position once, then plays and takes back every one of them in
+// a loop for the given time (default 2 seconds per position, the usual perft test positions when
+// no FEN is given). Reports nanoseconds per make_move + undo_move pair and per apply_move on a
+// copy, so changes to the move making code can be compared build against build.
+
+#include <board.h>
+#include <engine.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    const char* default_positions[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    };
+
+    struct Options {
+        double seconds = 2.0;
+        std::vector<std::string> fens;
+    };
+
+    bool parse_options(int argc, char** argv, Options& options) {
+        for(int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            if(arg == "--seconds" && i + 1 < argc) options.seconds = std::stod(argv[++i]);
+            else if(arg[0] != '-') options.fens.push_back(arg);
+            else return false;
+        }
+        if(options.fens.empty()) options.fens.assign(std::begin(default_positions), std::end(default_positions));
+        return options.seconds > 0;
+    }
+
+    //Runs body in rounds until the time is up, returns nanoseconds per call of body
+    template<typename Body>
+    double time_per_call(double seconds, int calls_per_round, Body body) {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        auto limit = start + std::chrono::duration<double>(seconds);
+        uint64_t rounds = 0;
+        while(clock::now() < limit){
+            for(int i = 0; i < 64; i++) body();
+            rounds += 64;
+        }
+        double elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        return elapsed / static_cast<double>(rounds * calls_per_round);
+    }
+}
+
+int main(int argc, char** argv){
+    Options options;
+    if(!parse_options(argc, argv, options)){
+        std::cerr << "usage: movebench [--seconds S] [fen]..." << std::endl;
+        return 1;
+    }
+
+    Engine engine;
+    double total_make_undo = 0, total_apply = 0;
+    uint64_t checksum = 0;
+
+    std::cout << std::fixed << std::setprecision(1);
+    for(const std::string& fen : options.fens){
+        Board board;
+        board.set_position_fen(fen);
+
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(board, moves);
+        if(count == 0) continue;
+
+        double make_undo = time_per_call(options.seconds / 2, count, [&]{
+            for(int i = 0; i < count; i++){
+                board.make_move(moves[i]);
+                checksum += board.zobrist_key;
+                board.undo_move();
+            }
+        });
+
+        const Position& root = board.get_position();
+        double apply = time_per_call(options.seconds / 2, count, [&]{
+            for(int i = 0; i < count; i++){
+                Position child = root;
+                child.apply_move(moves[i]);
+                checksum += child.zobrist_key;
+            }
+        });
+
+        total_make_undo += make_undo;
+        total_apply += apply;
+        std::cout << std::setw(6) << make_undo << " ns make+undo  " << std::setw(6) << apply << " ns copy+apply  "
+                  << count << " moves  " << fen << std::endl;
+    }
+
+    double positions = static_cast<double>(options.fens.size());
+    std::cout << "average " << total_make_undo / positions << " ns make+undo, " << total_apply / positions
+              << " ns copy+apply (checksum " << (checksum & 0xFFFF) << ")" << std::endl;
+    return 0;
+}
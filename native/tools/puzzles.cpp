@@ -0,0 +1,290 @@
+// Puzzle miner.
+//
+// usage: puzzles <games.pgn | positions.epd> [--out file] [--threads N] [--depth D] [--win CP] [--gap CP]
+//                [--skip-plies N] [--limit N]
+//
+// Takes the main line positions of every game in a PGN file (read with pgn.h from a memory mapping),
+// or one position per line of any other file (FEN or EPD, opcodes ignored), and searches each
+// position to a shallow depth (default 6) on a worker pool.
+// A position is kept when it has a single winning move: the best move scores at least --win
+// centipawns (default 200) and every other move scores at most --gap (default 250) below it and
+// below --win, checked with null window searches. Plain recaptures and the first --skip-plies plies
+// of each game (default 10) are left out.
+//
+// Output is CSV, one puzzle per line:
+//   fen,solution,san,rating,score,game,ply
+// solution is the move in UCI notation and rating a rough difficulty hint from the solution alone.
+// game and ply locate the position in the input (ply 0 for EPD lines). Positions per second per
+// core are reported at the end.
+
+#include <board.h>
+#include <engine.h>
+#include <pgn.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    constexpr size_t BATCH_POSITIONS = 1 << 12;
+
+    struct Options {
+        std::string input;
+        std::string output = "puzzles.csv";
+        int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        int depth = 6;
+        int win = 200;
+        int gap = 250;
+        int skip_plies = 10;
+        uint64_t limit = 0; //positions, 0 for all
+    };
+
+    bool parse_options(int argc, char** argv, Options& options) {
+        for(int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if(arg == "--out" && has_value) options.output = argv[++i];
+            else if(arg == "--threads" && has_value) options.threads = std::max(1, std::stoi(argv[++i]));
+            else if(arg == "--depth" && has_value) options.depth = std::max(1, std::stoi(argv[++i]));
+            else if(arg == "--win" && has_value) options.win = std::stoi(argv[++i]);
+            else if(arg == "--gap" && has_value) options.gap = std::max(1, std::stoi(argv[++i]));
+            else if(arg == "--skip-plies" && has_value) options.skip_plies = std::max(0, std::stoi(argv[++i]));
+            else if(arg == "--limit" && has_value) options.limit = std::stoull(argv[++i]);
+            else if(arg[0] != '-' && options.input.empty()) options.input = arg;
+            else return false;
+        }
+        return !options.input.empty();
+    }
+
+    /*  *   *   *   *  */
+    /*      INPUT      */
+    /*  *   *   *   *  */
+
+    // A 6 field FEN from a FEN or EPD line, empty if the line has fewer than 4 fields
+    std::string line_to_fen(const std::string& line) {
+        std::istringstream fields(line);
+        std::vector<std::string> parts;
+        std::string part;
+        while(parts.size() < 6 && fields >> part){
+            if(parts.size() >= 4 && !std::all_of(part.begin(), part.end(), [](unsigned char c){ return std::isdigit(c); })) break;
+            parts.push_back(part);
+        }
+        if(parts.size() < 4) return "";
+        if(parts.size() == 4) parts.push_back("0");
+        if(parts.size() == 5) parts.push_back("1");
+
+        std::string fen = parts[0];
+        for(size_t i = 1; i < parts.size(); i++) fen += " " + parts[i];
+        return fen;
+    }
+
+    /*  *   *   *   *  */
+    /*     ANALYSIS    */
+    /*  *   *   *   *  */
+
+    struct Candidate {
+        Position position;
+        uint64_t game;
+        int ply;
+        uint8_t recapture_square; //where the previous move captured, NO_SQUARE if it did not
+    };
+
+    struct Puzzle {
+        bool found = false;
+        Move solution{};
+        std::string san;
+        int score = 0;
+        int rating = 0;
+    };
+
+    // Rough difficulty from the solution alone: quiet moves and long mates are harder to see than
+    // checks and captures, and more legal moves mean more to choose from
+    int rating_hint(const Position& position, const Move& solution, int score, int legal_moves) {
+        int rating = 1000;
+        if(!position.gives_check(solution)) rating += 250;
+        if(solution.captured_piece == Piece::NONE) rating += 300;
+        if(score >= MATE_SCORE - MAX_SEARCH_PLY) rating += 150 * ((MATE_SCORE - score + 1) / 2 - 1);
+        rating += 10 * std::max(0, legal_moves - 20);
+        return std::clamp(rating, 600, 2800);
+    }
+
+    Puzzle examine(Engine& engine, Board& board, const Candidate& candidate, const Options& options) {
+        Puzzle puzzle;
+        board.set_position(candidate.position);
+
+        Move moves[MAX_NUMBER_OF_MOVES];
+        int count = engine.generate_legal_moves(board, moves);
+        if(count < 2) return puzzle; //a forced move is no puzzle
+
+        SearchResult best = engine.search(board, options.depth);
+        if(best.best_move.piece == Piece::NONE || best.score < options.win) return puzzle;
+        if(best.best_move.to_square == candidate.recapture_square) return puzzle;
+
+        //Every other move has to stay below the win threshold and a gap below the best one
+        int bound = std::min(best.score - options.gap, options.win) + 1;
+        if(engine.other_move_reaches(board, best.best_move, options.depth, bound)) return puzzle;
+
+        puzzle.found = true;
+        puzzle.solution = best.best_move;
+        puzzle.san = move_to_san(engine, board, best.best_move);
+        puzzle.score = best.score;
+        puzzle.rating = rating_hint(board, best.best_move, best.score, count);
+        return puzzle;
+    }
+
+    struct Totals {
+        uint64_t games = 0;
+        uint64_t positions = 0;
+        uint64_t puzzles = 0;
+        uint64_t bad_games = 0; //games cut short by a move or FEN that could not be read
+    };
+
+    // Searches a batch on the worker pool and writes its puzzles in input order
+    void flush(std::vector<Candidate>& batch, const Options& options, std::vector<std::unique_ptr<Engine>>& engines,
+               std::vector<std::unique_ptr<Board>>& boards, std::ostream& out, Totals& totals) {
+        std::vector<Puzzle> puzzles(batch.size());
+        std::atomic<size_t> next_index{0};
+        std::vector<std::thread> workers;
+        for(int t = 0; t < options.threads; t++){
+            workers.emplace_back([&, t]{
+                size_t i;
+                while((i = next_index++) < batch.size()){
+                    puzzles[i] = examine(*engines[t], *boards[t], batch[i], options);
+                }
+            });
+        }
+        for(auto& worker : workers) worker.join();
+
+        for(size_t i = 0; i < batch.size(); i++){
+            if(!puzzles[i].found) continue;
+            out << batch[i].position.getFen() << "," << move_to_string(puzzles[i].solution) << "," << puzzles[i].san << ","
+                << puzzles[i].rating << "," << puzzles[i].score << "," << batch[i].game << "," << batch[i].ply << "\n";
+            totals.puzzles++;
+        }
+        totals.positions += batch.size();
+        batch.clear();
+    }
+
+    // Turns the main line of every game into candidates, the opening plies left out
+    class CandidateCollector : public pgn::Visitor {
+        public:
+            CandidateCollector(const Options& options, Totals& totals, std::function<void(const Candidate&)> add, std::function<bool()> full)
+                : options(options), totals(totals), add(std::move(add)), full(std::move(full)) {}
+
+            bool done() const override { return full(); }
+
+            void begin_game() override {
+                totals.games++;
+                ply = 0;
+                recapture_square = NO_SQUARE;
+            }
+
+            void move(const Position& position, const Move& move, int depth) override {
+                if(depth != 0 || full()) return;
+                if(ply >= options.skip_plies) add(Candidate{position, totals.games, ply, recapture_square});
+                recapture_square = move.captured_piece != Piece::NONE ? move.to_square : NO_SQUARE;
+                ply++;
+            }
+
+            void end_game(std::string_view, bool error) override {
+                if(error) totals.bad_games++;
+            }
+
+        private:
+            const Options& options;
+            Totals& totals;
+            std::function<void(const Candidate&)> add;
+            std::function<bool()> full;
+            int ply = 0;
+            uint8_t recapture_square = NO_SQUARE;
+    };
+}
+
+int main(int argc, char** argv){
+    Options options;
+    if(!parse_options(argc, argv, options)){
+        std::cerr << "usage: puzzles <games.pgn | positions.epd> [--out file] [--threads N] [--depth D] [--win CP] [--gap CP] "
+                     "[--skip-plies N] [--limit N]" << std::endl;
+        return 1;
+    }
+
+    std::ofstream out(options.output);
+    if(!out){
+        std::cerr << "cannot write " << options.output << std::endl;
+        return 1;
+    }
+    out << "fen,solution,san,rating,score,game,ply\n";
+
+    //Boards carry a long move history, so they live on the heap once per thread
+    std::vector<std::unique_ptr<Engine>> engines;
+    std::vector<std::unique_ptr<Board>> boards;
+    for(int t = 0; t < options.threads; t++){
+        engines.push_back(std::make_unique<Engine>());
+        boards.push_back(std::make_unique<Board>());
+    }
+
+    Totals totals;
+    std::vector<Candidate> batch;
+    batch.reserve(BATCH_POSITIONS);
+    auto start = std::chrono::steady_clock::now();
+    auto limit_reached = [&]{ return options.limit != 0 && totals.positions + batch.size() >= options.limit; };
+    auto add = [&](const Candidate& candidate){
+        batch.push_back(candidate);
+        if(batch.size() == BATCH_POSITIONS){
+            flush(batch, options, engines, boards, out, totals);
+            std::cout << "\r" << totals.positions << " positions, " << totals.puzzles << " puzzles" << std::flush;
+        }
+    };
+
+    //Games are read from the memory mapped file, positions are handed to the workers a batch at a time
+    bool pgn = options.input.size() >= 4 && options.input.compare(options.input.size() - 4, 4, ".pgn") == 0;
+    if(pgn){
+        CandidateCollector collector(options, totals, add, limit_reached);
+        if(pgn::parse_file(options.input, collector) < 0){
+            std::cerr << "cannot open " << options.input << std::endl;
+            return 1;
+        }
+    } else {
+        std::ifstream in(options.input);
+        if(!in){
+            std::cerr << "cannot open " << options.input << std::endl;
+            return 1;
+        }
+        std::string line;
+        Position position;
+        while(!limit_reached() && std::getline(in, line)){
+            std::string fen = line_to_fen(line);
+            if(fen.empty()) continue;
+            totals.games++;
+            try {
+                position.set_position_fen(fen);
+            } catch(const std::exception&){
+                totals.bad_games++;
+                continue;
+            }
+            add(Candidate{position, totals.games, 0, NO_SQUARE});
+        }
+    }
+    flush(batch, options, engines, boards, out, totals);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double per_second = totals.positions / std::max(seconds, 1e-9);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "\r" << totals.positions << " positions from " << totals.games << (pgn ? " games" : " lines") << ", "
+              << totals.puzzles << " puzzles written to " << options.output << std::endl;
+    if(totals.bad_games > 0) std::cout << totals.bad_games << (pgn ? " games stopped at a move or FEN" : " lines") << " that could not be read" << std::endl;
+    std::cout << seconds << " s, " << per_second << " positions/s, " << per_second / options.threads
+              << " positions/s per thread" << std::endl;
+    return 0;
+}
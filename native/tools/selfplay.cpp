@@ -0,0 +1,549 @@
+// Self-play match runner with SPRT early stopping.
+//
+// usage: selfplay --engine <spec> --engine <spec> [options]
+//
+//   engine spec: comma separated key=value pairs
+//     name=<label>          name used in the PGN and the report
+//     lib=<path>            play with another build of libchess_bridge instead of this one
+//     network=<path>        NNUE network to load (in-process engines share the one from --network)
+//     nnue=on|off           in-process engines only, off forces the PST evaluation
+//     depth=<plies>         maximum search depth (default: limited by time only)
+//
+//   --book <file>           FEN/EPD openings, one per line, each played twice with colors swapped
+//   --games <n>             maximum number of games (default 1000)
+//   --concurrency <n>       games played at the same time (default: hardware threads)
+//   --tc <base+inc>         time control in seconds, e.g. 10+0.1 (default 10+0.1)
+//   --sprt elo0=0,elo1=5,alpha=0.05,beta=0.05
+//   --network <path>        NNUE network for in-process engines
+//   --pgn <file>            where to write the games (default selfplay.pgn)
+//
+// The first engine is the one being tested: W/D/L, Elo and the SPRT are reported from its side.
+
+#include <board.h>
+#include <engine.h>
+#include <nnue.h>
+#include <chess_bridge.h>
+#include <dlfcn.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    constexpr int MAX_GAME_PLIES = 400;
+    constexpr int RESIGN_SCORE = 1000;    //both engines agree one side is this far ahead...
+    constexpr int RESIGN_PLIES = 8;       //...for this many plies in a row
+    constexpr int DRAW_SCORE = 10;        //both engines see a dead even position...
+    constexpr int DRAW_PLIES = 16;        //...for this many plies in a row...
+    constexpr int DRAW_MIN_PLY = 80;      //...after this many plies
+
+    struct EngineConfig {
+        std::string name;
+        std::string library;
+        std::string network;
+        bool use_nnue = true;
+        int depth = MAX_SEARCH_PLY;
+    };
+
+    struct Options {
+        std::vector<EngineConfig> engines;
+        std::string book;
+        std::string pgn = "selfplay.pgn";
+        std::string network;
+        int games = 1000;
+        int concurrency = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        int base_ms = 10000;
+        int increment_ms = 100;
+        std::string tc_text = "10+0.1";
+        double elo0 = 0.0, elo1 = 5.0, alpha = 0.05, beta = 0.05;
+    };
+
+    /*  *   *   *   *   *  */
+    /*       PLAYERS       */
+    /*  *   *   *   *   *  */
+
+    // Something that can follow a game and pick moves, either this build or a dlopen'd bridge library
+    class Player {
+        public:
+            virtual ~Player() = default;
+            virtual void new_game(const std::string& fen) = 0;
+            virtual void play(const Move& move) = 0;
+            virtual SearchResult think(int depth, int time_ms) = 0;
+    };
+
+    class InProcessPlayer : public Player {
+        public:
+            explicit InProcessPlayer(const EngineConfig& config) : use_nnue(config.use_nnue) {}
+
+            void new_game(const std::string& fen) override {
+                engine = std::make_unique<Engine>();
+                engine->use_nnue = use_nnue;
+                board.set_position_fen(fen);
+            }
+
+            void play(const Move& move) override {
+                Move played = move;
+                board.make_move(played);
+            }
+
+            SearchResult think(int depth, int time_ms) override { return engine->search(board, depth, time_ms); }
+
+        private:
+            bool use_nnue;
+            std::unique_ptr<Engine> engine;
+            Board board;
+    };
+
+    // Entry points of one libchess_bridge build, loaded once and shared by every game thread
+    struct BridgeLibrary {
+        void* handle = nullptr;
+        decltype(&engine_create) create_engine;
+        decltype(&engine_destroy) destroy_engine;
+        decltype(&board_create_from_fen) create_board;
+        decltype(&board_destroy) destroy_board;
+        decltype(&board_make_move) make_move;
+        decltype(&engine_search) search;
+        decltype(&chess_load_network) load_network;
+
+        explicit BridgeLibrary(const std::string& path) {
+            //RTLD_LOCAL keeps two builds with the same symbol names apart
+            handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if(handle == nullptr) throw std::runtime_error("cannot load " + path + ": " + dlerror());
+
+            create_engine = symbol<decltype(create_engine)>("engine_create");
+            destroy_engine = symbol<decltype(destroy_engine)>("engine_destroy");
+            create_board = symbol<decltype(create_board)>("board_create_from_fen");
+            destroy_board = symbol<decltype(destroy_board)>("board_destroy");
+            make_move = symbol<decltype(make_move)>("board_make_move");
+            search = symbol<decltype(search)>("engine_search");
+            load_network = symbol<decltype(load_network)>("chess_load_network");
+        }
+
+        ~BridgeLibrary() { dlclose(handle); }
+
+        template<typename T>
+        T symbol(const char* name) {
+            void* address = dlsym(handle, name);
+            if(address == nullptr) throw std::runtime_error(std::string("library is missing ") + name);
+            return reinterpret_cast<T>(address);
+        }
+    };
+
+    class LibraryPlayer : public Player {
+        public:
+            explicit LibraryPlayer(const BridgeLibrary& library) : lib(library) {}
+
+            ~LibraryPlayer() override { release(); }
+
+            void new_game(const std::string& fen) override {
+                release();
+                engine = lib.create_engine();
+                board = lib.create_board(fen.c_str());
+            }
+
+            void play(const Move& move) override {
+                CMove cmove{move.piece, move.from_square, move.to_square, static_cast<uint8_t>(move.captured_piece),
+                            static_cast<uint8_t>(move.promoted_piece), move.is_enpassant, move.is_castling};
+                lib.make_move(board, &cmove);
+            }
+
+            SearchResult think(int depth, int time_ms) override {
+                CSearchResult out{};
+                lib.search(engine, board, depth, time_ms, &out);
+
+                SearchResult result{};
+                result.best_move = Move{out.best_move.piece, out.best_move.from_square, out.best_move.to_square,
+                                        static_cast<Piece>(out.best_move.captured_piece), static_cast<Piece>(out.best_move.promoted_piece),
+                                        out.best_move.is_enpassant != 0, out.best_move.is_castling != 0};
+                result.score = out.score;
+                result.depth = out.depth;
+                result.nodes = out.nodes;
+                return result;
+            }
+
+        private:
+            const BridgeLibrary& lib;
+            ChessEngineHandle engine = nullptr;
+            ChessBoardHandle board = nullptr;
+
+            void release() {
+                if(engine != nullptr) lib.destroy_engine(engine);
+                if(board != nullptr) lib.destroy_board(board);
+                engine = nullptr;
+                board = nullptr;
+            }
+    };
+
+    /*  *   *   *   *   *  */
+    /*        GAMES        */
+    /*  *   *   *   *   *  */
+
+    enum class Outcome { WHITE_WINS, BLACK_WINS, DRAW };
+
+    struct GameRecord {
+        int round;
+        int white; //index into Options::engines
+        std::string fen;
+        std::vector<std::string> san_moves;
+        Outcome outcome;
+        std::string termination;
+    };
+
+    GameRecord play_game(int round, int white, const std::string& fen, Player* players[2], const Options& options) {
+        GameRecord record{round, white, fen, {}, Outcome::DRAW, ""};
+
+        Engine referee;
+        Board board;
+        board.set_position_fen(fen);
+        players[0]->new_game(fen);
+        players[1]->new_game(fen);
+
+        int clock[2] = {options.base_ms, options.base_ms};
+        int resign_count = 0, draw_count = 0;
+        bool resign_white_ahead = false;
+
+        auto finish = [&](Outcome outcome, const std::string& termination){
+            record.outcome = outcome;
+            record.termination = termination;
+            return record;
+        };
+
+        for(int ply = 0; ; ply++){
+            Move legal[MAX_NUMBER_OF_MOVES];
+            int legal_count = referee.generate_legal_moves(board, legal);
+            Color side = board.sideToMove;
+            Outcome loss = side == Color::WHITE ? Outcome::BLACK_WINS : Outcome::WHITE_WINS;
+
+            if(legal_count == 0) return board.is_in_check(side) ? finish(loss, "checkmate") : finish(Outcome::DRAW, "stalemate");
+            if(board.half_move_clock >= 100) return finish(Outcome::DRAW, "fifty move rule");
+            if(board.is_repetition(2)) return finish(Outcome::DRAW, "threefold repetition");
+            if(board.is_insufficient_material()) return finish(Outcome::DRAW, "insufficient material");
+            if(ply >= MAX_GAME_PLIES) return finish(Outcome::DRAW, "adjudication: maximum length");
+
+            //Players get a slice of their clock, the engines do not manage time themselves
+            int side_index = static_cast<int>(side);
+            int player_index = side == Color::WHITE ? 0 : 1;
+            int budget = std::max(1, std::min(clock[side_index] / 20 + options.increment_ms * 3 / 4, clock[side_index] - 10));
+            int depth = player_index == 0 ? options.engines[white].depth : options.engines[1 - white].depth;
+
+            auto start = std::chrono::steady_clock::now();
+            SearchResult result = players[player_index]->think(depth, budget);
+            int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+
+            clock[side_index] -= elapsed;
+            if(clock[side_index] < 0) return finish(loss, "time forfeit");
+            clock[side_index] += options.increment_ms;
+
+            const Move* chosen = std::find_if(legal, legal + legal_count, [&](const Move& m){ return same_move(m, result.best_move); });
+            if(chosen == legal + legal_count) return finish(loss, "illegal move " + move_to_string(result.best_move));
+            Move move = *chosen;
+
+            //Score adjudication, both engines have to agree
+            int white_score = side == Color::WHITE ? result.score : -result.score;
+            bool white_ahead = white_score > 0;
+            if(std::abs(white_score) < RESIGN_SCORE) resign_count = 0;
+            else if(resign_count > 0 && white_ahead == resign_white_ahead) resign_count++;
+            else { resign_count = 1; resign_white_ahead = white_ahead; }
+            draw_count = std::abs(white_score) <= DRAW_SCORE ? draw_count + 1 : 0;
+            if(resign_count >= RESIGN_PLIES) return finish(resign_white_ahead ? Outcome::WHITE_WINS : Outcome::BLACK_WINS, "adjudication: resign");
+            if(draw_count >= DRAW_PLIES && ply >= DRAW_MIN_PLY) return finish(Outcome::DRAW, "adjudication: draw");
+
+            record.san_moves.push_back(move_to_san(referee, board, move));
+
+            board.make_move(move);
+            players[0]->play(move);
+            players[1]->play(move);
+        }
+    }
+
+    std::string pgn_result(Outcome outcome) {
+        return outcome == Outcome::WHITE_WINS ? "1-0" : outcome == Outcome::BLACK_WINS ? "0-1" : "1/2-1/2";
+    }
+
+    void write_pgn(std::ostream& out, const GameRecord& game, const Options& options) {
+        std::time_t now = std::time(nullptr);
+        char date[16];
+        std::strftime(date, sizeof(date), "%Y.%m.%d", std::localtime(&now));
+
+        out << "[Event \"selfplay\"]\n"
+            << "[Site \"local\"]\n"
+            << "[Date \"" << date << "\"]\n"
+            << "[Round \"" << game.round << "\"]\n"
+            << "[White \"" << options.engines[game.white].name << "\"]\n"
+            << "[Black \"" << options.engines[1 - game.white].name << "\"]\n"
+            << "[Result \"" << pgn_result(game.outcome) << "\"]\n"
+            << "[TimeControl \"" << options.base_ms / 1000.0 << "+" << options.increment_ms / 1000.0 << "\"]\n"
+            << "[Termination \"" << game.termination << "\"]\n";
+        if(game.fen != START_FEN){
+            out << "[SetUp \"1\"]\n[FEN \"" << game.fen << "\"]\n";
+        }
+        out << "\n";
+
+        //Move numbers continue from the opening position
+        std::istringstream fields(game.fen);
+        std::string skip, side;
+        int move_number = 1;
+        fields >> skip >> side >> skip >> skip >> skip >> move_number;
+        bool white_to_move = side == "w";
+
+        int column = 0;
+        for(size_t i = 0; i < game.san_moves.size(); i++){
+            std::string token;
+            if(white_to_move) token = std::to_string(move_number) + ". ";
+            else if(i == 0) token = std::to_string(move_number) + "... ";
+            token += game.san_moves[i];
+
+            if(column + token.size() > 79){ out << "\n"; column = 0; }
+            else if(column > 0){ out << " "; column++; }
+            out << token;
+            column += static_cast<int>(token.size());
+
+            if(!white_to_move) move_number++;
+            white_to_move = !white_to_move;
+        }
+        out << (column > 0 ? " " : "") << pgn_result(game.outcome) << "\n\n";
+    }
+
+    /*  *   *   *   *   *  */
+    /*      STATISTICS     */
+    /*  *   *   *   *   *  */
+
+    struct Tally {
+        int wins = 0, draws = 0, losses = 0; //from the first engine's side
+
+        int games() const { return wins + draws + losses; }
+        double score() const { return (wins + 0.5 * draws) / games(); }
+
+        // Variance of a single game's score
+        double variance() const {
+            double s = score();
+            return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+        }
+    };
+
+    double elo_to_score(double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+    double score_to_elo(double score) {
+        score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+        return -400.0 * std::log10(1.0 / score - 1.0);
+    }
+
+    // Generalized SPRT log likelihood ratio with the normal approximation of the trinomial. Half a game
+    // is added to each outcome, so a one-sided result like 40-0 still has a variance and can stop the test.
+    double log_likelihood_ratio(const Tally& tally, double elo0, double elo1) {
+        if(tally.games() == 0) return 0.0;
+        double wins = tally.wins + 0.5, draws = tally.draws + 0.5, losses = tally.losses + 0.5;
+        double games = wins + draws + losses;
+        double score = (wins + 0.5 * draws) / games;
+        double variance = (wins * (1 - score) * (1 - score) + draws * (0.5 - score) * (0.5 - score) + losses * score * score) / games;
+        if(variance == 0.0) return 0.0;
+
+        double s0 = elo_to_score(elo0), s1 = elo_to_score(elo1);
+        return tally.games() * (s1 - s0) * (2 * score - s0 - s1) / (2 * variance);
+    }
+
+    void report(const Tally& tally, const Options& options, double llr) {
+        double se = std::sqrt(tally.variance() / tally.games());
+        double elo = score_to_elo(tally.score());
+        double error = (score_to_elo(tally.score() + 1.96 * se) - score_to_elo(tally.score() - 1.96 * se)) / 2.0;
+
+        std::cout << "Score of " << options.engines[0].name << " vs " << options.engines[1].name << ": "
+                  << tally.wins << " - " << tally.losses << " - " << tally.draws
+                  << " [" << std::fixed << std::setprecision(3) << tally.score() << "] " << tally.games() << "\n"
+                  << "Elo difference: " << std::setprecision(1) << elo << " +/- " << error << " (95%)\n"
+                  << "LLR: " << std::setprecision(2) << llr << " (" << std::log(options.beta / (1 - options.alpha))
+                  << ", " << std::log((1 - options.beta) / options.alpha) << ") [" << options.elo0 << ", " << options.elo1 << "]"
+                  << std::defaultfloat << std::endl;
+    }
+
+    /*  *   *   *   *   *  */
+    /*       OPTIONS       */
+    /*  *   *   *   *   *  */
+
+    std::map<std::string, std::string> parse_pairs(const std::string& spec) {
+        std::map<std::string, std::string> pairs;
+        std::istringstream in(spec);
+        std::string item;
+        while(std::getline(in, item, ',')){
+            size_t eq = item.find('=');
+            if(eq == std::string::npos) throw std::invalid_argument("expected key=value in " + spec);
+            pairs[item.substr(0, eq)] = item.substr(eq + 1);
+        }
+        return pairs;
+    }
+
+    EngineConfig parse_engine(const std::string& spec) {
+        EngineConfig config;
+        for(const auto& [key, value] : parse_pairs(spec)){
+            if(key == "name") config.name = value;
+            else if(key == "lib") config.library = value;
+            else if(key == "network") config.network = value;
+            else if(key == "nnue") config.use_nnue = value != "off";
+            else if(key == "depth") config.depth = std::clamp(std::stoi(value), 1, MAX_SEARCH_PLY);
+            else throw std::invalid_argument("unknown engine option " + key);
+        }
+        return config;
+    }
+
+    bool parse_options(int argc, char** argv, Options& options) {
+        for(int i = 1; i + 1 < argc; i += 2){
+            std::string arg = argv[i];
+            std::string value = argv[i + 1];
+            if(arg == "--engine") options.engines.push_back(parse_engine(value));
+            else if(arg == "--book") options.book = value;
+            else if(arg == "--games") options.games = std::stoi(value);
+            else if(arg == "--concurrency") options.concurrency = std::max(1, std::stoi(value));
+            else if(arg == "--pgn") options.pgn = value;
+            else if(arg == "--network") options.network = value;
+            else if(arg == "--tc"){
+                size_t plus = value.find('+');
+                options.base_ms = static_cast<int>(std::stod(value.substr(0, plus)) * 1000);
+                options.increment_ms = plus == std::string::npos ? 0 : static_cast<int>(std::stod(value.substr(plus + 1)) * 1000);
+                options.tc_text = value;
+            } else if(arg == "--sprt"){
+                for(const auto& [key, number] : parse_pairs(value)){
+                    if(key == "elo0") options.elo0 = std::stod(number);
+                    else if(key == "elo1") options.elo1 = std::stod(number);
+                    else if(key == "alpha") options.alpha = std::stod(number);
+                    else if(key == "beta") options.beta = std::stod(number);
+                    else throw std::invalid_argument("unknown sprt option " + key);
+                }
+            } else return false;
+        }
+        if(argc % 2 == 0 || options.engines.size() != 2) return false;
+
+        for(size_t i = 0; i < options.engines.size(); i++){
+            if(options.engines[i].name.empty()) options.engines[i].name = "engine" + std::to_string(i + 1);
+        }
+        return true;
+    }
+
+    // Openings as 6 field FENs, EPD opcodes after the 4th field are dropped
+    std::vector<std::string> load_book(const std::string& path) {
+        if(path.empty()) return {START_FEN};
+
+        std::ifstream in(path);
+        if(!in) throw std::runtime_error("cannot open " + path);
+
+        std::vector<std::string> openings;
+        std::string line;
+        while(std::getline(in, line)){
+            std::istringstream fields(line);
+            std::vector<std::string> parts;
+            std::string part;
+            while(parts.size() < 6 && fields >> part){
+                if(parts.size() >= 4 && !std::all_of(part.begin(), part.end(), [](unsigned char c){ return std::isdigit(c); })) break;
+                parts.push_back(part);
+            }
+            if(parts.size() < 4) continue;
+            if(parts.size() == 4) parts.push_back("0");
+            if(parts.size() == 5) parts.push_back("1");
+
+            std::string fen = parts[0];
+            for(size_t i = 1; i < parts.size(); i++) fen += " " + parts[i];
+            openings.push_back(fen);
+        }
+        if(openings.empty()) throw std::runtime_error("no openings in " + path);
+        return openings;
+    }
+}
+
+int main(int argc, char** argv){
+    Options options;
+    try {
+        if(!parse_options(argc, argv, options)){
+            std::cerr << "usage: selfplay --engine name=new[,lib=path][,network=path][,nnue=on|off][,depth=N] --engine name=base,...\n"
+                      << "                [--book file] [--games N] [--concurrency N] [--tc 10+0.1]\n"
+                      << "                [--sprt elo0=0,elo1=5,alpha=0.05,beta=0.05] [--network path] [--pgn file]" << std::endl;
+            return 1;
+        }
+
+        if(!options.network.empty() && !nnue::load_network(options.network)){
+            throw std::runtime_error("cannot load network " + options.network);
+        }
+
+        //One library instance per distinct path, shared by every game thread
+        std::map<std::string, std::unique_ptr<BridgeLibrary>> libraries;
+        for(const EngineConfig& config : options.engines){
+            if(config.library.empty()) continue;
+            auto& library = libraries[config.library];
+            if(!library) library = std::make_unique<BridgeLibrary>(config.library);
+            if(!config.network.empty() && !library->load_network(config.network.c_str())){
+                throw std::runtime_error("cannot load network " + config.network + " into " + config.library);
+            }
+        }
+
+        std::vector<std::string> openings = load_book(options.book);
+        std::ofstream pgn(options.pgn);
+        if(!pgn) throw std::runtime_error("cannot write " + options.pgn);
+
+        std::atomic<int> next_game{0};
+        std::atomic<bool> stop{false};
+        std::mutex results_mutex;
+        Tally tally;
+        const double lower = std::log(options.beta / (1 - options.alpha));
+        const double upper = std::log((1 - options.beta) / options.alpha);
+
+        auto worker = [&]{
+            std::unique_ptr<Player> players[2];
+            for(int i = 0; i < 2; i++){
+                const EngineConfig& config = options.engines[i];
+                if(config.library.empty()) players[i] = std::make_unique<InProcessPlayer>(config);
+                else players[i] = std::make_unique<LibraryPlayer>(*libraries[config.library]);
+            }
+
+            int game;
+            while(!stop && (game = next_game++) < options.games){
+                //Each opening is played twice in a row with the colors swapped
+                int white = game % 2;
+                const std::string& fen = openings[(game / 2) % openings.size()];
+                Player* seats[2] = {players[white].get(), players[1 - white].get()};
+
+                GameRecord record = play_game(game + 1, white, fen, seats, options);
+
+                std::lock_guard<std::mutex> lock(results_mutex);
+                write_pgn(pgn, record, options);
+
+                bool first_is_white = white == 0;
+                if(record.outcome == Outcome::DRAW) tally.draws++;
+                else if((record.outcome == Outcome::WHITE_WINS) == first_is_white) tally.wins++;
+                else tally.losses++;
+
+                double llr = log_likelihood_ratio(tally, options.elo0, options.elo1);
+                if(tally.games() % 10 == 0) report(tally, options, llr);
+                if(llr <= lower || llr >= upper) stop = true;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(int i = 0; i < options.concurrency; i++) threads.emplace_back(worker);
+        for(auto& thread : threads) thread.join();
+
+        if(tally.games() == 0) return 0;
+
+        double llr = log_likelihood_ratio(tally, options.elo0, options.elo1);
+        report(tally, options, llr);
+        if(llr >= upper) std::cout << "SPRT: H1 accepted (" << options.engines[0].name << " gains elo1 rather than elo0)" << std::endl;
+        else if(llr <= lower) std::cout << "SPRT: H0 accepted (" << options.engines[0].name << " gains elo0 rather than elo1)" << std::endl;
+        else std::cout << "SPRT: inconclusive after " << tally.games() << " games" << std::endl;
+    } catch(const std::exception& e){
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
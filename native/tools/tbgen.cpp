@@ -0,0 +1,62 @@
+// Endgame tablebase generator.
+//
+// usage: tbgen <signature>... [--out directory] [--threads N]
+//
+// Each signature names the material, kings included, like KQvK or KRPvKR (at most five pieces).
+// Tables are generated with retrograde analysis and written as <signature>.dctb, together with
+// every smaller table the signature can reach by captures and promotions. Tables already in the
+// output directory are reused. Point the engine at the directory with "setoption name
+// TablebasePath value <directory>".
+
+#include <egtb.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    struct Options {
+        std::vector<std::string> signatures;
+        std::string output = "tables";
+        int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    };
+
+    bool parse_options(int argc, char** argv, Options& options) {
+        for(int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if(arg == "--out" && has_value) options.output = argv[++i];
+            else if(arg == "--threads" && has_value) options.threads = std::max(1, std::stoi(argv[++i]));
+            else if(arg[0] != '-') options.signatures.push_back(arg);
+            else return false;
+        }
+        return !options.signatures.empty();
+    }
+}
+
+int main(int argc, char** argv){
+    Options options;
+    if(!parse_options(argc, argv, options)){
+        std::cerr << "usage: tbgen <signature>... [--out directory] [--threads N]" << std::endl;
+        return 1;
+    }
+
+    for(const std::string& signature : options.signatures){
+        egtb::Material material;
+        if(!egtb::parse_material(signature, material)){
+            std::cerr << "invalid signature " << signature << ", expected something like KRPvKR with at most "
+                      << egtb::MAX_PIECES << " pieces" << std::endl;
+            return 1;
+        }
+
+        if(!egtb::generate(signature, options.output, options.threads, &std::cout)){
+            std::cerr << "failed to generate " << material.name() << " in " << options.output << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "tables written to " << options.output << std::endl;
+    return 0;
+}
@@ -0,0 +1,369 @@
+// Texel tuner for the middlegame/endgame piece square tables.
+//
+// usage: tune <positions-file> [--epochs N] [--threads N] [--rate R] [--limit N] [--output path]
+//
+// Each line of the positions file is a FEN (4 or 6 fields) followed by a label:
+//   a game result  1-0 | 0-1 | 1/2-1/2 | 1.0 | 0.5 | 0.0   (brackets, quotes and ';' are ignored)
+//   or a score     an integer in centipawns from white's point of view ([35] after a 4 field FEN,
+//                  a bare number there would be read as the halfmove clock)
+//
+// Every position is resolved with a quiescence search first so the tables are fitted on quiet
+// positions. The leaf's pieces are stored as sparse features and the rest of the evaluation
+// (pawn structure, king proximity) as a constant offset, so an epoch only walks flat arrays.
+
+#include <board.h>
+#include <engine.h>
+#include <utils.h>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    constexpr int TABLE_PARAMS = 6 * 64;
+    constexpr int NUM_PARAMS = 2 * TABLE_PARAMS; //middlegame tables then endgame tables
+    constexpr uint16_t BLACK_FEATURE = 0x8000;
+    constexpr size_t BATCH_LINES = 1 << 16;
+
+    const char* table_names[6] = {"pawn_array", "knight_array", "bishop_array", "rook_array", "queen_array", "king_array"};
+
+    struct Options {
+        std::string input;
+        std::string output = "tuned_pst.txt";
+        int epochs = 500;
+        int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        double rate = 1.0;
+        size_t limit = 0; //0 = whole file
+    };
+
+    // Structure of arrays so an epoch streams through memory once
+    struct Dataset {
+        std::vector<float> targets;        //expected score for white, 0..1
+        std::vector<float> offsets;        //untuned part of the evaluation, white's point of view
+        std::vector<uint8_t> phases;       //game phase of the quiet position, 0..MAX_GAME_PHASE
+        std::vector<uint32_t> feature_start{0};
+        std::vector<uint16_t> features;    //table index (type * 64 + table square), BLACK_FEATURE set for black pieces
+
+        size_t size() const { return targets.size(); }
+
+        void append(const Dataset& other) {
+            uint32_t base = static_cast<uint32_t>(features.size());
+            targets.insert(targets.end(), other.targets.begin(), other.targets.end());
+            offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+            phases.insert(phases.end(), other.phases.begin(), other.phases.end());
+            for(size_t i = 1; i < other.feature_start.size(); i++) feature_start.push_back(base + other.feature_start[i]);
+            features.insert(features.end(), other.features.begin(), other.features.end());
+        }
+    };
+
+    double sigmoid(double score, double k) {
+        return 1.0 / (1.0 + std::pow(10.0, -k * score / 400.0));
+    }
+
+    // Splits a dataset line into a 6 field FEN and a label, returns false if the label is not understood
+    bool parse_line(const std::string& line, std::string& fen, float& target) {
+        std::istringstream in(line);
+        std::vector<std::string> fields;
+        std::string token;
+        while(fields.size() < 6 && in >> token){
+            bool counter = std::all_of(token.begin(), token.end(), [](unsigned char c){ return std::isdigit(c); });
+            if(fields.size() >= 4 && !counter) break;
+            fields.push_back(token);
+            token.clear();
+        }
+        if(fields.size() < 4) return false;
+        if(fields.size() == 4) fields.push_back("0");
+        if(fields.size() == 5) fields.push_back("1");
+
+        //Labels come as 1-0, [1.0], "1/2-1/2"; or c9 "0-1"; (EPD opcode) or a plain centipawn score
+        std::string label;
+        do {
+            if(token == "c9" || token == "ce") continue;
+            label += token;
+        } while(in >> token);
+        label.erase(std::remove_if(label.begin(), label.end(), [](char c){ return c == '[' || c == ']' || c == '"' || c == ';'; }), label.end());
+        if(label.empty()) return false;
+
+        try {
+            if(label == "1-0") target = 1.0f;
+            else if(label == "0-1") target = 0.0f;
+            else if(label == "1/2-1/2") target = 0.5f;
+            else if(label.find('.') != std::string::npos) target = std::stof(label);
+            else target = static_cast<float>(sigmoid(std::stoi(label), 1.0));
+        } catch(const std::exception&){
+            return false;
+        }
+
+        fen = fields[0];
+        for(size_t i = 1; i < fields.size(); i++) fen += " " + fields[i];
+        return target >= 0.0f && target <= 1.0f;
+    }
+
+    // Quiescence-resolves one position and appends its features, returns false on a bad FEN or no quiet leaf
+    bool extract(Engine& engine, Board& board, const std::string& fen, float target, Dataset& out) {
+        try {
+            board.set_position_fen(fen);
+        } catch(const std::exception&){
+            return false;
+        }
+
+        Move line[MAX_SEARCH_PLY];
+        int score = 0;
+        int length = engine.quiet_line(board, line, score);
+        for(int i = 0; i < length; i++) board.make_move(line[i]);
+
+        int phase = std::min(board.game_phase, MAX_GAME_PHASE);
+        int white_eval = board.sideToMove == Color::WHITE ? engine.evaluate_position(board) : -engine.evaluate_position(board);
+
+        double mg = 0.0, eg = 0.0;
+        for(int p = W_PAWN; p < NONE; p++){
+            Piece piece = static_cast<Piece>(p);
+            Color color = colorOf(piece);
+            int type = static_cast<int>(typeOf(piece));
+            Bitboard pieces = board.get_piece_bitboard(piece);
+            int sign = color == Color::WHITE ? 1 : -1;
+
+            while(pieces != 0){
+                int square = pop_lsb(pieces);
+                int table_square = color == Color::WHITE ? flip_array[square] : square;
+                out.features.push_back(static_cast<uint16_t>(type * 64 + table_square) | (color == Color::WHITE ? 0 : BLACK_FEATURE));
+                mg += sign * piece_square_table[type][table_square];
+                eg += sign * piece_square_table_eg[type][table_square];
+            }
+        }
+
+        for(int i = length - 1; i >= 0; i--) board.undo_move();
+
+        double linear = (mg * phase + eg * (MAX_GAME_PHASE - phase)) / MAX_GAME_PHASE;
+        out.targets.push_back(target);
+        out.offsets.push_back(static_cast<float>(white_eval - linear));
+        out.phases.push_back(static_cast<uint8_t>(phase));
+        out.feature_start.push_back(static_cast<uint32_t>(out.features.size()));
+        return true;
+    }
+
+    // Reads the file in batches so only one batch of text is in memory, each batch is split across the threads
+    Dataset load_dataset(const Options& options) {
+        std::ifstream in(options.input);
+        if(!in) throw std::runtime_error("cannot open " + options.input);
+
+        Dataset dataset;
+        std::vector<std::string> lines;
+        lines.reserve(BATCH_LINES);
+        size_t skipped = 0, total = 0;
+
+        std::vector<Engine> engines(options.threads);
+        std::vector<Board> boards(options.threads);
+
+        auto flush = [&]{
+            std::vector<Dataset> shards(options.threads);
+            std::vector<size_t> shard_skipped(options.threads, 0);
+            std::vector<std::thread> workers;
+            for(int t = 0; t < options.threads; t++){
+                workers.emplace_back([&, t]{
+                    std::string fen;
+                    float target;
+                    for(size_t i = t; i < lines.size(); i += options.threads){
+                        if(!parse_line(lines[i], fen, target) || !extract(engines[t], boards[t], fen, target, shards[t])) shard_skipped[t]++;
+                    }
+                });
+            }
+            for(auto& worker : workers) worker.join();
+            for(int t = 0; t < options.threads; t++){
+                dataset.append(shards[t]);
+                skipped += shard_skipped[t];
+            }
+            lines.clear();
+        };
+
+        std::string line;
+        while(std::getline(in, line)){
+            if(line.empty()) continue;
+            lines.push_back(std::move(line));
+            total++;
+            if(lines.size() == BATCH_LINES){
+                flush();
+                std::cout << "\rloaded " << dataset.size() << " positions" << std::flush;
+            }
+            if(options.limit != 0 && total >= options.limit) break;
+        }
+        flush();
+
+        std::cout << "\rloaded " << dataset.size() << " positions, skipped " << skipped << std::endl;
+        return dataset;
+    }
+
+    // Mean squared error over the dataset, with the gradient of every parameter when gradient is not null
+    double evaluate_error(const Dataset& data, const std::vector<double>& params, double k, int threads, std::vector<double>* gradient) {
+        std::vector<double> errors(threads, 0.0);
+        std::vector<std::vector<double>> gradients(threads, std::vector<double>(gradient ? NUM_PARAMS : 0, 0.0));
+        std::vector<std::thread> workers;
+        size_t chunk = (data.size() + threads - 1) / threads;
+
+        for(int t = 0; t < threads; t++){
+            workers.emplace_back([&, t]{
+                size_t begin = t * chunk;
+                size_t end = std::min(data.size(), begin + chunk);
+                double error = 0.0;
+                for(size_t i = begin; i < end; i++){
+                    double mg_weight = data.phases[i] / static_cast<double>(MAX_GAME_PHASE);
+                    double eg_weight = 1.0 - mg_weight;
+                    double eval = data.offsets[i];
+                    for(uint32_t f = data.feature_start[i]; f < data.feature_start[i + 1]; f++){
+                        uint16_t feature = data.features[f];
+                        int index = feature & ~BLACK_FEATURE;
+                        double sign = feature & BLACK_FEATURE ? -1.0 : 1.0;
+                        eval += sign * (mg_weight * params[index] + eg_weight * params[TABLE_PARAMS + index]);
+                    }
+
+                    double predicted = sigmoid(eval, k);
+                    double diff = data.targets[i] - predicted;
+                    error += diff * diff;
+
+                    if(gradient){
+                        //d(error)/d(eval), the constant factor of the sigmoid derivative is folded into the learning rate
+                        double slope = -2.0 * diff * predicted * (1.0 - predicted);
+                        for(uint32_t f = data.feature_start[i]; f < data.feature_start[i + 1]; f++){
+                            uint16_t feature = data.features[f];
+                            int index = feature & ~BLACK_FEATURE;
+                            double sign = feature & BLACK_FEATURE ? -slope : slope;
+                            gradients[t][index] += sign * mg_weight;
+                            gradients[t][TABLE_PARAMS + index] += sign * eg_weight;
+                        }
+                    }
+                }
+                errors[t] = error;
+            });
+        }
+        for(auto& worker : workers) worker.join();
+
+        double total = 0.0;
+        for(int t = 0; t < threads; t++){
+            total += errors[t];
+            if(gradient){
+                for(int p = 0; p < NUM_PARAMS; p++) (*gradient)[p] += gradients[t][p];
+            }
+        }
+        return total / std::max<size_t>(1, data.size());
+    }
+
+    // Scaling constant K of the sigmoid that best fits the current tables, found by ternary search
+    double fit_k(const Dataset& data, const std::vector<double>& params, int threads) {
+        double low = 0.05, high = 3.0;
+        for(int i = 0; i < 40; i++){
+            double a = low + (high - low) / 3.0;
+            double b = high - (high - low) / 3.0;
+            if(evaluate_error(data, params, a, threads, nullptr) < evaluate_error(data, params, b, threads, nullptr)) high = b;
+            else low = a;
+        }
+        return (low + high) / 2.0;
+    }
+
+    // Adam, the tables have very different feature frequencies so a per-parameter step size converges much faster
+    void tune(const Dataset& data, std::vector<double>& params, double k, const Options& options) {
+        std::vector<double> m(NUM_PARAMS, 0.0), v(NUM_PARAMS, 0.0);
+        const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+
+        for(int epoch = 1; epoch <= options.epochs; epoch++){
+            auto start = std::chrono::steady_clock::now();
+            std::vector<double> gradient(NUM_PARAMS, 0.0);
+            double error = evaluate_error(data, params, k, options.threads, &gradient);
+
+            for(int p = 0; p < NUM_PARAMS; p++){
+                double g = gradient[p] / data.size();
+                m[p] = beta1 * m[p] + (1.0 - beta1) * g;
+                v[p] = beta2 * v[p] + (1.0 - beta2) * g * g;
+                double m_hat = m[p] / (1.0 - std::pow(beta1, epoch));
+                double v_hat = v[p] / (1.0 - std::pow(beta2, epoch));
+                params[p] -= options.rate * m_hat / (std::sqrt(v_hat) + epsilon);
+            }
+
+            if(epoch == 1 || epoch % 10 == 0 || epoch == options.epochs){
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::cout << "epoch " << epoch << " error " << std::setprecision(8) << error << " (" << std::setprecision(3) << seconds << "s)" << std::endl;
+            }
+        }
+    }
+
+    // Writes the tables in the layout of utils.cpp so they can be pasted over the hand-typed ones
+    void write_tables(const std::vector<double>& params, const std::string& path) {
+        std::ofstream out(path);
+        if(!out) throw std::runtime_error("cannot write " + path);
+
+        for(int table = 0; table < 2; table++){
+            out << "// " << (table == 0 ? "piece_square_table (middlegame)" : "piece_square_table_eg (endgame)") << "\n";
+            for(int type = 0; type < 6; type++){
+                out << "std::array<int, 64> " << table_names[type] << " = {\n";
+                for(int row = 0; row < 8; row++){
+                    out << "    ";
+                    for(int col = 0; col < 8; col++){
+                        int value = static_cast<int>(std::lround(params[table * TABLE_PARAMS + type * 64 + row * 8 + col]));
+                        out << std::setw(4) << value << (row == 7 && col == 7 ? "" : ",");
+                    }
+                    out << "\n";
+                }
+                out << "};\n";
+            }
+            out << "\n";
+        }
+    }
+
+    bool parse_options(int argc, char** argv, Options& options) {
+        for(int i = 1; i < argc; i++){
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if(arg == "--epochs" && has_value) options.epochs = std::stoi(argv[++i]);
+            else if(arg == "--threads" && has_value) options.threads = std::max(1, std::stoi(argv[++i]));
+            else if(arg == "--rate" && has_value) options.rate = std::stod(argv[++i]);
+            else if(arg == "--limit" && has_value) options.limit = std::stoull(argv[++i]);
+            else if(arg == "--output" && has_value) options.output = argv[++i];
+            else if(options.input.empty() && arg[0] != '-') options.input = arg;
+            else return false;
+        }
+        return !options.input.empty();
+    }
+}
+
+int main(int argc, char** argv){
+    Options options;
+    if(!parse_options(argc, argv, options)){
+        std::cerr << "usage: tune <positions-file> [--epochs N] [--threads N] [--rate R] [--limit N] [--output path]" << std::endl;
+        return 1;
+    }
+
+    try {
+        Dataset data = load_dataset(options);
+        if(data.size() == 0){
+            std::cerr << "no usable positions in " << options.input << std::endl;
+            return 1;
+        }
+
+        std::vector<double> params(NUM_PARAMS);
+        for(int type = 0; type < 6; type++){
+            for(int square = 0; square < 64; square++){
+                params[type * 64 + square] = piece_square_table[type][square];
+                params[TABLE_PARAMS + type * 64 + square] = piece_square_table_eg[type][square];
+            }
+        }
+
+        double k = fit_k(data, params, options.threads);
+        std::cout << "K = " << k << ", initial error " << evaluate_error(data, params, k, options.threads, nullptr) << std::endl;
+
+        tune(data, params, k, options);
+        write_tables(params, options.output);
+        std::cout << "wrote " << options.output << std::endl;
+    } catch(const std::exception& e){
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}